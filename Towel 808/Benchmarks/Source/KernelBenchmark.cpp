@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+    Timing of the interpolation kernels on their own.
+  ==============================================================================
+*/
+
+#include "KernelBenchmark.h"
+#include "../../Source/SampleKernels.h"
+
+namespace
+{
+    const juce::StringArray qualityNames { "linear", "hermite", "sinc" };
+
+    constexpr double sampleRate = 44100.0;
+    constexpr int chunkSize = 64;
+}
+
+//==============================================================================
+juce::Array<KernelBenchmark::Result> KernelBenchmark::run (double secondsPerRun, int numRuns)
+{
+    auto increment = std::pow (2.0, 7.0 / 12.0);
+    auto numSamples = juce::roundToInt (secondsPerRun * sampleRate);
+
+    // Noise for the whole run, with silence either side for the widest kernel
+    auto margin = SampleKernels::maxKernelSpan;
+    auto numSourceFrames = juce::roundToInt (numSamples * increment) + 1;
+    juce::HeapBlock<float> source ((size_t) (numSourceFrames + 2 * margin), true);
+    juce::Random random (1);
+
+    for (int i = 0; i < numSourceFrames; ++i)
+        source[margin + i] = random.nextFloat() * 2.0f - 1.0f;
+
+    juce::HeapBlock<float> output ((size_t) numSamples);
+    int indices[chunkSize];
+    float fractions[chunkSize];
+
+    juce::Array<Result> results;
+
+    for (int quality = SampleKernels::linear; quality <= SampleKernels::sinc; ++quality)
+    {
+        juce::Array<double> runSeconds;
+
+        for (int runIndex = -1; runIndex < numRuns; ++runIndex)
+        {
+            auto position = 0.0;
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int done = 0; done < numSamples; done += chunkSize)
+            {
+                auto numThisTime = juce::jmin (chunkSize, numSamples - done);
+                auto base = (int) position;
+
+                SampleKernels::computePositions (position - base, increment, indices, fractions, numThisTime);
+                SampleKernels::interpolate ((SampleKernels::Quality) quality, source + margin + base, indices, fractions,
+                                            output + done, numThisTime, increment);
+
+                position += numThisTime * increment;
+            }
+
+            auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+            if (runIndex >= 0)   // the first run only warms up
+                runSeconds.add (elapsed);
+        }
+
+        runSeconds.sort();
+
+        Result result;
+        result.quality = quality;
+        result.nsPerSample = runSeconds[runSeconds.size() / 2] * 1.0e9 / numSamples;
+        result.relative = results.isEmpty() ? 1.0 : result.nsPerSample / results.getFirst().nsPerSample;
+        results.add (result);
+    }
+
+    return results;
+}
+
+juce::String KernelBenchmark::toCsv (const juce::Array<Result>& results)
+{
+    juce::String csv ("quality,ns_per_sample,relative\n");
+
+    for (auto& r : results)
+        csv << qualityNames[r.quality] << ',' << juce::String (r.nsPerSample, 3) << ','
+            << juce::String (r.relative, 2) << '\n';
+
+    return csv;
+}
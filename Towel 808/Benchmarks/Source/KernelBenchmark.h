@@ -0,0 +1,35 @@
+/*
+  ==============================================================================
+    Timing of the interpolation kernels on their own.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Times each interpolator outside the plugin: one voice and one channel of
+    noise, played a fifth above its root in 64-sample chunks the way
+    MySamplerVoice does. The cost includes working out the positions but not
+    the envelope or mixing, so it shows what the quality choice alone costs.
+
+    Each tier keeps the median of several runs, after one untimed warm-up run.
+*/
+class KernelBenchmark
+{
+public:
+    struct Result
+    {
+        int quality;
+        double nsPerSample;
+
+        // Cost relative to linear interpolation
+        double relative;
+    };
+
+    static juce::Array<Result> run (double secondsPerRun, int numRuns);
+
+    static juce::String toCsv (const juce::Array<Result>& results);
+};
@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+    Command-line entry point for the Towel 808 benchmarks.
+  ==============================================================================
+*/
+
+#include <iostream>
+#include <JuceHeader.h>
+#include "KernelBenchmark.h"
+#include "ProcessorBenchmark.h"
+
+namespace
+{
+    const char* const options =
+        "  --samples-dir <folder>  Samples to use (default: the bundled Towel Tuned 808s)\n"
+        "  --sample <name>         Sample to play (default: the first one)\n"
+        "  --rates <list>          Host sample rates (default 44100,48000,88200,96000,176400,192000)\n"
+        "  --blocks <list>         Block sizes (default 16,32,...,4096)\n"
+        "  --voices <list>         Notes started at once (default 1,2,4,8,16,32,64)\n"
+        "  --quality <list>        linear, hermite and/or sinc (default linear)\n"
+        "  --saturation <list>     off, 1x, 2x and/or 4x: the Tape curve at 12 dB of drive,\n"
+        "                          oversampled by that much (default off)\n"
+        "  --lanes <list>          on and/or off (default off)\n"
+        "  --threads <list>        Voice threads on and/or off (default off)\n"
+        "  --compact <list>        16-bit sample storage on and/or off (default off)\n"
+        "  --cut <list>            on and/or off (default off,on)\n"
+        "  --envelopes <list>      fast, default and/or slow (default all three)\n"
+        "  --seconds <s>           Audio rendered per run (default 0.5)\n"
+        "  --runs <n>              Timed runs per measurement, median kept (default 5)\n"
+        "  --quick                 A small sweep for a fast check\n"
+        "  --format <csv|json>     Output format (default csv)\n"
+        "  --output <file>         Write the results to a file instead of stdout\n"
+        "Lists are comma-separated.\n";
+
+    const char* const kernelOptions =
+        "  --seconds <s>           Audio rendered per run (default 1)\n"
+        "  --runs <n>              Timed runs per interpolator, median kept (default 5)\n";
+
+    juce::StringArray getList (const juce::ArgumentList& args, const juce::String& option, const juce::String& defaultList)
+    {
+        auto list = juce::StringArray::fromTokens (args.containsOption (option) ? args.getValueForOption (option)
+                                                                                 : defaultList, ",", "");
+        list.trim();
+        list.removeEmptyStrings();
+
+        if (list.isEmpty())
+            juce::ConsoleApplication::fail (option + " needs at least one value");
+
+        return list;
+    }
+
+    juce::Array<bool> getSwitchList (const juce::ArgumentList& args, const juce::String& option, const juce::String& defaultList)
+    {
+        juce::Array<bool> values;
+
+        for (auto& item : getList (args, option, defaultList))
+        {
+            if (item != "on" && item != "off")
+                juce::ConsoleApplication::fail (option + " takes on and/or off");
+
+            values.add (item == "on");
+        }
+
+        return values;
+    }
+
+    juce::Array<int> getIntList (const juce::ArgumentList& args, const juce::String& option, const juce::String& defaultList,
+                                 int minimum, int maximum)
+    {
+        juce::Array<int> values;
+
+        for (auto& item : getList (args, option, defaultList))
+        {
+            auto value = item.getIntValue();
+
+            if (! item.containsOnly ("0123456789") || value < minimum || value > maximum)
+                juce::ConsoleApplication::fail (option + " values must be between " + juce::String (minimum)
+                                                + " and " + juce::String (maximum));
+
+            values.add (value);
+        }
+
+        return values;
+    }
+
+    // The benchmark binary is built inside the repository, so look for the
+    // bundled samples in the folders above it before falling back to the
+    // plugin's own location
+    juce::File findBundledSamples()
+    {
+        auto folder = juce::File::getSpecialLocation (juce::File::currentExecutableFile).getParentDirectory();
+
+        for (; ! folder.isRoot(); folder = folder.getParentDirectory())
+        {
+            auto samples = folder.getChildFile ("Towel Tuned 808s");
+
+            if (samples.isDirectory())
+                return samples;
+        }
+
+        return juce::File::getSpecialLocation (juce::File::userMusicDirectory).getChildFile ("Towel Tuned 808s");
+    }
+
+    ProcessorBenchmark::Settings parseSettings (const juce::ArgumentList& args)
+    {
+        ProcessorBenchmark::Settings settings;
+        auto quick = args.containsOption ("--quick");
+
+        settings.samplesDirectory = args.containsOption ("--samples-dir") ? args.getExistingFolderForOption ("--samples-dir")
+                                                                          : findBundledSamples();
+
+        juce::Array<juce::File> sampleFiles;
+        settings.samplesDirectory.findChildFiles (sampleFiles, juce::File::findFiles, false, "*.wav");
+        sampleFiles.sort();
+
+        if (sampleFiles.isEmpty())
+            juce::ConsoleApplication::fail ("No samples in " + settings.samplesDirectory.getFullPathName());
+
+        settings.sampleName = args.containsOption ("--sample") ? args.getValueForOption ("--sample")
+                                                               : sampleFiles.getFirst().getFileNameWithoutExtension();
+
+        for (auto rate : getIntList (args, "--rates", quick ? "48000,96000" : "44100,48000,88200,96000,176400,192000",
+                                     8000, 384000))
+            settings.sampleRates.add ((double) rate);
+
+        settings.blockSizes = getIntList (args, "--blocks", quick ? "64,512,4096" : "16,32,64,128,256,512,1024,2048,4096",
+                                          1, 65536);
+        settings.voiceCounts = getIntList (args, "--voices", quick ? "1,16,64" : "1,2,4,8,16,32,64", 1, 64);
+
+        for (auto& name : getList (args, "--quality", "linear"))
+        {
+            auto quality = juce::StringArray { "linear", "hermite", "sinc" }.indexOf (name);
+
+            if (quality < 0)
+                juce::ConsoleApplication::fail ("--quality takes linear, hermite and/or sinc");
+
+            settings.qualities.add (quality);
+        }
+
+        for (auto& name : getList (args, "--saturation", "off"))
+        {
+            auto saturation = juce::StringArray { "off", "1x", "2x", "4x" }.indexOf (name);
+
+            if (saturation < 0)
+                juce::ConsoleApplication::fail ("--saturation takes off, 1x, 2x and/or 4x");
+
+            settings.saturationModes.add (saturation - 1);
+        }
+
+        settings.laneModes = getSwitchList (args, "--lanes", "off");
+        settings.threadModes = getSwitchList (args, "--threads", "off");
+        settings.compactModes = getSwitchList (args, "--compact", "off");
+        settings.cutModes = getSwitchList (args, "--cut", quick ? "off" : "off,on");
+
+        settings.envelopeNames = getList (args, "--envelopes", quick ? "default" : "fast,default,slow");
+
+        for (auto& name : settings.envelopeNames)
+            if (name != "fast" && name != "default" && name != "slow")
+                juce::ConsoleApplication::fail ("--envelopes takes fast, default and/or slow");
+
+        if (args.containsOption ("--seconds"))
+            settings.secondsPerRun = juce::jlimit (0.01, 60.0, args.getValueForOption ("--seconds").getDoubleValue());
+
+        if (args.containsOption ("--runs"))
+            settings.numRuns = juce::jlimit (1, 1000, args.getValueForOption ("--runs").getIntValue());
+
+        return settings;
+    }
+
+    void runBenchmarks (const juce::ArgumentList& args)
+    {
+        auto settings = parseSettings (args);
+        auto format = args.containsOption ("--format") ? args.getValueForOption ("--format") : juce::String ("csv");
+
+        if (format != "csv" && format != "json")
+            juce::ConsoleApplication::fail ("--format takes csv or json");
+
+        // Progress goes to stderr so stdout stays machine-readable
+        auto results = ProcessorBenchmark (settings).run ([] (const ProcessorBenchmark::Result& r)
+        {
+            std::cerr << r.sampleRate << " Hz, " << r.blockSize << " samples, " << r.numVoices << " voices: "
+                      << juce::String (r.nsPerVoiceSample, 2) << " ns/voice-sample, "
+                      << juce::String (r.realTimeFactor, 1) << "x real time" << std::endl;
+        });
+
+        auto text = format == "json" ? ProcessorBenchmark::toJson (results) : ProcessorBenchmark::toCsv (results);
+
+        if (args.containsOption ("--output"))
+        {
+            auto file = args.getFileForOption ("--output");
+
+            if (! file.replaceWithText (text))
+                juce::ConsoleApplication::fail ("Couldn't write " + file.getFullPathName());
+        }
+        else
+        {
+            std::cout << text << std::endl;
+        }
+    }
+
+    void runKernelBenchmarks (const juce::ArgumentList& args)
+    {
+        auto seconds = args.containsOption ("--seconds") ? juce::jlimit (0.01, 60.0, args.getValueForOption ("--seconds").getDoubleValue())
+                                                         : 1.0;
+        auto numRuns = args.containsOption ("--runs") ? juce::jlimit (1, 1000, args.getValueForOption ("--runs").getIntValue())
+                                                      : 5;
+
+        std::cout << KernelBenchmark::toCsv (KernelBenchmark::run (seconds, numRuns)) << std::endl;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor's parameters and threads expect JUCE to be initialised
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand ("--help|-h", "Towel 808 processBlock benchmarks", false);
+
+    app.addCommand ({ "--kernels",
+                      "--kernels [options]",
+                      "Times each interpolator on its own, for one voice and channel",
+                      kernelOptions,
+                      runKernelBenchmarks });
+
+    app.addDefaultCommand ({ "run",
+                             "[options]",
+                             "Times processBlock across the requested settings",
+                             options,
+                             runBenchmarks });
+
+    return app.findAndRunCommand (argc, argv);
+}
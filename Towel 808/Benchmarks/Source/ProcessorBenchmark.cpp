@@ -0,0 +1,227 @@
+/*
+  ==============================================================================
+    Timing sweeps over the plugin's processBlock.
+  ==============================================================================
+*/
+
+#include "ProcessorBenchmark.h"
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+    const juce::StringArray qualityNames { "linear", "hermite", "sinc" };
+
+    juce::String getSaturationName (int saturation)
+    {
+        return saturation < 0 ? juce::String ("off") : juce::String (1 << saturation) + "x";
+    }
+
+    void setParameter (NewProjectAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        if (auto* parameter = processor.apvts.getParameter (parameterID))
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    const ProcessorBenchmark::Envelope* findEnvelope (const juce::String& name)
+    {
+        for (auto& envelope : ProcessorBenchmark::envelopes)
+            if (name == envelope.name)
+                return &envelope;
+
+        return nullptr;
+    }
+
+    // Spreads the notes over the octave below the root, then over MIDI
+    // channels, so no two share a note and channel (which would retrigger)
+    juce::MidiBuffer makeNoteOns (int numVoices)
+    {
+        juce::MidiBuffer midi;
+
+        for (int i = 0; i < numVoices; ++i)
+            midi.addEvent (juce::MidiMessage::noteOn (1 + i / 13, 60 - i % 13, (juce::uint8) 100), 0);
+
+        return midi;
+    }
+}
+
+const ProcessorBenchmark::Envelope ProcessorBenchmark::envelopes[3] =
+{
+    { "fast",    0.01f, 0.01f, 1.0f, 0.01f },
+    { "default", 0.1f,  0.5f,  0.8f, 0.5f  },
+    { "slow",    5.0f,  5.0f,  0.5f, 5.0f  }
+};
+
+//==============================================================================
+ProcessorBenchmark::ProcessorBenchmark (const Settings& settingsToUse)
+    : settings (settingsToUse)
+{
+}
+
+juce::Array<ProcessorBenchmark::Result> ProcessorBenchmark::run (std::function<void (const Result&)> onResult)
+{
+    juce::Array<Result> results;
+
+    NewProjectAudioProcessor processor;
+    processor.setNonRealtime (true);
+
+    if (settings.samplesDirectory != juce::File())
+        processor.setSamplesDirectory (settings.samplesDirectory);
+
+    for (auto sampleRate : settings.sampleRates)
+    {
+        for (auto blockSize : settings.blockSizes)
+        for (auto compact : settings.compactModes)
+        {
+            // Changing the storage reloads the sample, so it is the outer loop
+            processor.setCompactStorageEnabled (compact);
+            processor.setPlayConfigDetails (0, 2, sampleRate, blockSize);
+            processor.loadSample (settings.sampleName);
+            processor.prepareToPlay (sampleRate, blockSize);
+
+            while (! processor.hasFinishedLoadingSample())
+                juce::Thread::sleep (1);
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer noMidi, noteOns;
+            auto numBlocks = juce::jmax (1, juce::roundToInt (settings.secondsPerRun * sampleRate / blockSize));
+
+            for (auto quality : settings.qualities)
+            for (auto saturation : settings.saturationModes)
+            for (auto lanes : settings.laneModes)
+            for (auto threads : settings.threadModes)
+            for (auto cut : settings.cutModes)
+            for (auto& envelopeName : settings.envelopeNames)
+            {
+                auto* envelope = findEnvelope (envelopeName);
+                jassert (envelope != nullptr);
+
+                setParameter (processor, "quality", (float) quality);
+                setParameter (processor, "cutEnabled", cut ? 1.0f : 0.0f);
+                setParameter (processor, "envAttack", envelope->attack);
+                setParameter (processor, "envDecay", envelope->decay);
+                setParameter (processor, "envSustain", envelope->sustain);
+                setParameter (processor, "envRelease", envelope->release);
+
+                // Saturation runs the tape curve, the costliest, well into clipping
+                setParameter (processor, "clipCurve", saturation < 0 ? 0.0f : 2.0f);
+                setParameter (processor, "drive", saturation < 0 ? 0.0f : 12.0f);
+                processor.setOversampling (juce::jmax (0, saturation));
+                processor.setLaneRenderingEnabled (lanes);
+                processor.setVoiceThreadingEnabled (threads);
+
+                for (auto numVoices : settings.voiceCounts)
+                {
+                    juce::Array<double> runSeconds;
+                    juce::int64 voiceSamples = 0;
+
+                    for (int runIndex = -1; runIndex < settings.numRuns; ++runIndex)
+                    {
+                        processor.reset();
+                        noteOns = makeNoteOns (numVoices);
+                        voiceSamples = 0;
+
+                        auto start = juce::Time::getHighResolutionTicks();
+
+                        for (int block = 0; block < numBlocks; ++block)
+                        {
+                            processor.processBlock (buffer, block == 0 ? noteOns : noMidi);
+                            voiceSamples += (juce::int64) processor.getNumSoundingVoices() * blockSize;
+                        }
+
+                        auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+                        if (runIndex >= 0)   // the first run only warms up
+                            runSeconds.add (elapsed);
+                    }
+
+                    runSeconds.sort();
+                    auto seconds = runSeconds[runSeconds.size() / 2];
+                    auto numSamples = (double) numBlocks * blockSize;
+
+                    Result result;
+                    result.sampleRate = sampleRate;
+                    result.blockSize = blockSize;
+                    result.numVoices = numVoices;
+                    result.quality = quality;
+                    result.saturation = saturation;
+                    result.cut = cut;
+                    result.lanes = lanes;
+                    result.threads = threads;
+                    result.compact = compact;
+                    result.envelope = envelopeName;
+                    result.meanSoundingVoices = (double) voiceSamples / numSamples;
+                    result.nsPerSample = seconds * 1.0e9 / numSamples;
+                    result.nsPerVoiceSample = voiceSamples > 0 ? seconds * 1.0e9 / (double) voiceSamples : 0.0;
+                    result.realTimeFactor = seconds > 0.0 ? (numSamples / sampleRate) / seconds : 0.0;
+
+                    results.add (result);
+
+                    if (onResult != nullptr)
+                        onResult (result);
+                }
+            }
+        }
+    }
+
+    processor.reset();
+    processor.releaseResources();
+    return results;
+}
+
+//==============================================================================
+juce::String ProcessorBenchmark::toCsv (const juce::Array<Result>& results)
+{
+    juce::String csv ("sample_rate,block_size,voices,quality,saturation,lanes,threads,compact,cut,envelope,"
+                      "mean_sounding_voices,ns_per_sample,ns_per_voice_sample,realtime_factor\n");
+
+    for (auto& r : results)
+    {
+        csv << r.sampleRate << ',' << r.blockSize << ',' << r.numVoices << ','
+            << qualityNames[r.quality] << ',' << getSaturationName (r.saturation) << ','
+            << (r.lanes ? "on" : "off") << ',' << (r.threads ? "on" : "off") << ','
+            << (r.compact ? "on" : "off") << ',' << (r.cut ? "on" : "off") << ','
+            << r.envelope << ',' << juce::String (r.meanSoundingVoices, 2) << ','
+            << juce::String (r.nsPerSample, 3) << ',' << juce::String (r.nsPerVoiceSample, 3) << ','
+            << juce::String (r.realTimeFactor, 2) << '\n';
+    }
+
+    return csv;
+}
+
+juce::String ProcessorBenchmark::toJson (const juce::Array<Result>& results)
+{
+    juce::Array<juce::var> entries;
+
+    for (auto& r : results)
+    {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty ("sampleRate", r.sampleRate);
+        entry->setProperty ("blockSize", r.blockSize);
+        entry->setProperty ("voices", r.numVoices);
+        entry->setProperty ("quality", qualityNames[r.quality]);
+        entry->setProperty ("saturation", getSaturationName (r.saturation));
+        entry->setProperty ("lanes", r.lanes);
+        entry->setProperty ("threads", r.threads);
+        entry->setProperty ("compact", r.compact);
+        entry->setProperty ("cut", r.cut);
+        entry->setProperty ("envelope", r.envelope);
+        entry->setProperty ("meanSoundingVoices", r.meanSoundingVoices);
+        entry->setProperty ("nsPerSample", r.nsPerSample);
+        entry->setProperty ("nsPerVoiceSample", r.nsPerVoiceSample);
+        entry->setProperty ("realTimeFactor", r.realTimeFactor);
+        entries.add (juce::var (entry));
+    }
+
+    // Enough about the machine to tell two result files apart
+    auto* system = new juce::DynamicObject();
+    system->setProperty ("cpu", juce::SystemStats::getCpuModel());
+    system->setProperty ("cores", juce::SystemStats::getNumCpus());
+    system->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+    system->setProperty ("juce", juce::SystemStats::getJUCEVersion());
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("system", juce::var (system));
+    root->setProperty ("results", entries);
+
+    return juce::JSON::toString (juce::var (root));
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+    Timing sweeps over the plugin's processBlock.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Drives a NewProjectAudioProcessor directly, without a host, and times its
+    processBlock over every combination of the settings it is given.
+
+    Each measurement resets the processor, starts the requested number of
+    notes in the first block and times a fixed stretch of audio. The notes
+    sit at or below the sample's root so none of them runs out before the
+    stretch ends. The median of several runs is kept, after one untimed
+    warm-up run.
+*/
+class ProcessorBenchmark
+{
+public:
+    // Envelope presets; the attack and release are what change the voice
+    // count and the amount of envelope work per block
+    struct Envelope
+    {
+        const char* name;
+        float attack, decay, sustain, release;
+    };
+
+    static const Envelope envelopes[3];
+
+    struct Settings
+    {
+        juce::File samplesDirectory;
+        juce::String sampleName;
+
+        juce::Array<double> sampleRates;
+        juce::Array<int> blockSizes, voiceCounts, qualities;
+
+        // -1 leaves the saturator off; 0 to 2 drive it at 1x, 2x or 4x
+        juce::Array<int> saturationModes;
+        juce::Array<bool> cutModes, laneModes, threadModes, compactModes;
+        juce::StringArray envelopeNames;
+
+        double secondsPerRun = 0.5;
+        int numRuns = 5;
+    };
+
+    struct Result
+    {
+        double sampleRate;
+        int blockSize, numVoices, quality, saturation;
+        bool cut, lanes, threads, compact;
+        juce::String envelope;
+
+        // Voices actually sounding, averaged over the run; below numVoices
+        // when Cut chokes them
+        double meanSoundingVoices;
+
+        double nsPerSample, nsPerVoiceSample, realTimeFactor;
+    };
+
+    explicit ProcessorBenchmark (const Settings& settingsToUse);
+
+    // Runs the whole sweep, calling back after each measurement
+    juce::Array<Result> run (std::function<void (const Result&)> onResult);
+
+    static juce::String toCsv (const juce::Array<Result>& results);
+    static juce::String toJson (const juce::Array<Result>& results);
+
+private:
+    Settings settings;
+};
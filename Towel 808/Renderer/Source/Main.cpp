@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+    Command-line entry point for the Towel 808 offline renderer.
+  ==============================================================================
+*/
+
+#include <iostream>
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "../../Source/RealtimeSafety.h"
+
+namespace
+{
+    const char* const jobOptions =
+        "  --midi, -m <file>       MIDI file to render\n"
+        "  --sample, -s <name>     Sample to play, as listed in the plugin\n"
+        "  --output, -o <file>     WAV file to write\n"
+        "  --samples-dir <folder>  Where to find samples (default: Music/Towel Tuned 808s)\n"
+        "  --rate, -r <Hz>         Sample rate (default 44100)\n"
+        "  --block, -b <samples>   Block size (default 512)\n"
+        "  --bits <16|24|32>       Output bit depth, 32 is float (default 24)\n"
+        "  --tail <seconds>        Longest tail after the last event (default 10)\n"
+        "  --attack, --decay, --release <seconds>, --sustain <level>\n"
+        "  --cut <on|off>\n"
+        "  --quality <linear|hermite|sinc>\n";
+
+    const char* const checkOption =
+        "  --rt-check              Fail if processBlock allocates, waits on a lock, sleeps or\n"
+        "                          touches a file (needs a TOWEL808_RT_CHECKS build, e.g. Debug)\n";
+
+    int getNumThreads (const juce::ArgumentList& args)
+    {
+        if (args.containsOption ("--threads|-j"))
+            return juce::jmax (1, args.getValueForOption ("--threads|-j").getIntValue());
+
+        return juce::SystemStats::getNumCpus();
+    }
+
+    // One job per line, written with the same options as a single render.
+    // Blank lines and lines starting with # are skipped.
+    juce::Array<OfflineRenderer::Job> readJobFile (const juce::File& file)
+    {
+        juce::Array<OfflineRenderer::Job> jobs;
+        juce::StringArray lines;
+        file.readLines (lines);
+
+        for (auto& line : lines)
+        {
+            line = line.trim();
+
+            if (line.isEmpty() || line.startsWithChar ('#'))
+                continue;
+
+            auto tokens = juce::StringArray::fromTokens (line, true);
+
+            for (auto& token : tokens)
+                token = token.unquoted();
+
+            jobs.add (OfflineRenderer::parseJob (juce::ArgumentList ("render", tokens)));
+        }
+
+        return jobs;
+    }
+
+    void renderAndReport (const juce::Array<OfflineRenderer::Job>& jobs, int numThreads)
+    {
+        numThreads = juce::jlimit (1, juce::jmax (1, jobs.size()), numThreads);
+
+        auto startTime = juce::Time::getMillisecondCounterHiRes();
+        auto reports = OfflineRenderer::renderAll (jobs, numThreads);
+        auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+        int numFailed = 0;
+        double audioSeconds = 0.0;
+
+        for (int i = 0; i < jobs.size(); ++i)
+        {
+            auto& report = reports.getReference (i);
+            auto name = jobs.getReference (i).outputFile.getFileName();
+
+            if (report.succeeded())
+            {
+                std::cout << name << ": " << juce::String (report.audioSeconds, 2) << " s in "
+                          << juce::String (report.renderSeconds, 2) << " s" << std::endl;
+                audioSeconds += report.audioSeconds;
+            }
+            else
+            {
+                std::cerr << name << ": " << report.error << std::endl;
+                ++numFailed;
+            }
+        }
+
+        std::cout << jobs.size() - numFailed << " of " << jobs.size() << " jobs rendered, "
+                  << juce::String (audioSeconds, 1) << " s of audio in " << juce::String (elapsedSeconds, 1)
+                  << " s on " << numThreads << " threads" << std::endl;
+
+        if (numFailed > 0)
+            juce::ConsoleApplication::fail (juce::String (numFailed) + " jobs failed");
+    }
+
+    // Reports everything the checker logged while the jobs were rendering
+    void checkRealtimeSafety()
+    {
+        if (! RealtimeSafety::isEnabled())
+            juce::ConsoleApplication::fail ("--rt-check needs a build with TOWEL808_RT_CHECKS=1");
+
+        auto numViolations = RealtimeSafety::getNumViolations();
+
+        for (auto& violation : RealtimeSafety::getViolations())
+            std::cerr << "Real-time violation (" << RealtimeSafety::getKindName (violation.kind) << "):" << std::endl
+                      << violation.stackTrace << std::endl;
+
+        if (numViolations > 0)
+            juce::ConsoleApplication::fail (juce::String (numViolations) + " real-time violations in processBlock");
+
+        std::cout << "No real-time violations" << std::endl;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor's parameters and threads expect JUCE to be initialised
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand ("--help|-h", "Towel 808 offline renderer", false);
+
+    app.addCommand ({ "--batch",
+                      "--batch <jobfile> [--threads <n>] [--rt-check]",
+                      "Renders every job in a file, several at once",
+                      juce::String ("Each line of the job file holds the options for one render:\n") + jobOptions + checkOption,
+                      [] (const juce::ArgumentList& args)
+                      {
+                          auto jobs = readJobFile (args.getExistingFileForOption ("--batch"));
+                          renderAndReport (jobs, getNumThreads (args));
+
+                          if (args.containsOption ("--rt-check"))
+                              checkRealtimeSafety();
+                      } });
+
+    app.addDefaultCommand ({ "render",
+                             "--midi <file> --sample <name> --output <file> [options]",
+                             "Renders one MIDI file to WAV",
+                             juce::String (jobOptions) + checkOption,
+                             [] (const juce::ArgumentList& args)
+                             {
+                                 renderAndReport ({ OfflineRenderer::parseJob (args) }, 1);
+
+                                 if (args.containsOption ("--rt-check"))
+                                     checkRealtimeSafety();
+                             } });
+
+    return app.findAndRunCommand (argc, argv);
+}
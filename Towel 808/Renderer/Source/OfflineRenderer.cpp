@@ -0,0 +1,237 @@
+/*
+  ==============================================================================
+    Renders MIDI files through the plugin's processor without a host.
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+    float parseFloatOption (const juce::ArgumentList& args, const juce::String& option, float minimum, float maximum)
+    {
+        auto text = args.getValueForOption (option);
+        auto value = text.getFloatValue();
+
+        if (! text.containsOnly ("0123456789.-") || value < minimum || value > maximum)
+            juce::ConsoleApplication::fail (option + " must be between " + juce::String (minimum) + " and " + juce::String (maximum));
+
+        return value;
+    }
+
+    juce::MidiMessageSequence readMidiFile (const juce::File& file)
+    {
+        juce::MidiFile midiFile;
+        juce::FileInputStream input (file);
+
+        if (! input.openedOk() || ! midiFile.readFrom (input))
+            return {};
+
+        midiFile.convertTimestampTicksToSeconds();
+
+        // Everything plays on the one sampler, so the tracks are merged
+        juce::MidiMessageSequence sequence;
+
+        for (int i = 0; i < midiFile.getNumTracks(); ++i)
+            sequence.addSequence (*midiFile.getTrack (i), 0.0);
+
+        sequence.sort();
+        return sequence;
+    }
+}
+
+//==============================================================================
+OfflineRenderer::Job OfflineRenderer::parseJob (const juce::ArgumentList& args)
+{
+    Job job;
+
+    job.midiFile = args.getExistingFileForOption ("--midi|-m");
+    job.outputFile = args.getFileForOption ("--output|-o");
+    job.sampleName = args.getValueForOption ("--sample|-s");
+
+    if (job.sampleName.isEmpty())
+        juce::ConsoleApplication::fail ("Missing --sample <name>");
+
+    if (args.containsOption ("--samples-dir"))
+        job.samplesDirectory = args.getExistingFolderForOption ("--samples-dir");
+
+    if (args.containsOption ("--rate|-r"))
+        job.sampleRate = parseFloatOption (args, "--rate|-r", 8000.0f, 384000.0f);
+
+    if (args.containsOption ("--block|-b"))
+        job.blockSize = (int) parseFloatOption (args, "--block|-b", 1.0f, 65536.0f);
+
+    if (args.containsOption ("--bits"))
+    {
+        job.bitDepth = args.getValueForOption ("--bits").getIntValue();
+
+        if (job.bitDepth != 16 && job.bitDepth != 24 && job.bitDepth != 32)
+            juce::ConsoleApplication::fail ("--bits must be 16, 24 or 32");
+    }
+
+    if (args.containsOption ("--tail"))
+        job.maxTailSeconds = parseFloatOption (args, "--tail", 0.0f, 600.0f);
+
+    // Envelope times and levels use the same ranges as the plugin's parameters
+    struct EnvelopeOption { const char* option; const char* parameterID; float minimum, maximum; };
+
+    for (auto& envelope : { EnvelopeOption { "--attack",  "envAttack",  0.01f, 5.0f },
+                            EnvelopeOption { "--decay",   "envDecay",   0.01f, 5.0f },
+                            EnvelopeOption { "--sustain", "envSustain", 0.0f,  1.0f },
+                            EnvelopeOption { "--release", "envRelease", 0.01f, 5.0f } })
+    {
+        if (args.containsOption (envelope.option))
+            job.parameters.set (envelope.parameterID, parseFloatOption (args, envelope.option, envelope.minimum, envelope.maximum));
+    }
+
+    if (args.containsOption ("--cut"))
+    {
+        auto cut = args.getValueForOption ("--cut").toLowerCase();
+
+        if (cut != "on" && cut != "off")
+            juce::ConsoleApplication::fail ("--cut must be on or off");
+
+        job.parameters.set ("cutEnabled", cut == "on" ? 1.0f : 0.0f);
+    }
+
+    if (args.containsOption ("--quality"))
+    {
+        auto quality = juce::StringArray { "linear", "hermite", "sinc" }
+                           .indexOf (args.getValueForOption ("--quality").toLowerCase());
+
+        if (quality < 0)
+            juce::ConsoleApplication::fail ("--quality must be linear, hermite or sinc");
+
+        job.parameters.set ("quality", (float) quality);
+    }
+
+    return job;
+}
+
+//==============================================================================
+OfflineRenderer::Report OfflineRenderer::render (const Job& job)
+{
+    Report report;
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    auto sequence = readMidiFile (job.midiFile);
+
+    if (sequence.getNumEvents() == 0)
+    {
+        report.error = "No MIDI events in " + job.midiFile.getFullPathName();
+        return report;
+    }
+
+    NewProjectAudioProcessor processor;
+    processor.setNonRealtime (true);
+    processor.setPlayConfigDetails (0, 2, job.sampleRate, job.blockSize);
+
+    // Indexes the folder before the sample is looked up, so a library no
+    // instance has seen yet still works
+    processor.setSamplesDirectory (job.samplesDirectory != juce::File() ? job.samplesDirectory
+                                                                        : processor.getSamplesDirectory());
+
+    if (! processor.getSampleNames().contains (job.sampleName))
+    {
+        report.error = "No sample called " + job.sampleName;
+        return report;
+    }
+
+    for (auto& parameter : job.parameters)
+    {
+        if (auto* target = processor.apvts.getParameter (parameter.name.toString()))
+            target->setValueNotifyingHost (target->convertTo0to1 ((float) parameter.value));
+    }
+
+    // Choosing the sample first means prepareToPlay converts it straight to
+    // the job's rate rather than loading a default one
+    processor.loadSample (job.sampleName);
+    processor.prepareToPlay (job.sampleRate, job.blockSize);
+
+    // The first block picks up the decoded sound, so every note in the file
+    // plays the requested sample no matter how busy the machine is
+    while (! processor.hasFinishedLoadingSample())
+        juce::Thread::sleep (1);
+
+    job.outputFile.getParentDirectory().createDirectory();
+    job.outputFile.deleteFile();
+
+    std::unique_ptr<juce::OutputStream> stream (job.outputFile.createOutputStream());
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (stream != nullptr)
+        writer.reset (juce::WavAudioFormat().createWriterFor (stream.get(), job.sampleRate, 2,
+                                                              job.bitDepth, {}, 0));
+
+    if (writer == nullptr)
+    {
+        report.error = "Couldn't write " + job.outputFile.getFullPathName();
+        return report;
+    }
+
+    stream.release();   // now owned by the writer
+
+    auto toSamples = [&job] (double seconds) { return (juce::int64) std::llround (seconds * job.sampleRate); };
+
+    auto lastEventSample = toSamples (sequence.getEndTime());
+    auto maxLength = lastEventSample + toSamples (job.maxTailSeconds) + 1;
+
+    juce::AudioBuffer<float> buffer (2, job.blockSize);
+    juce::MidiBuffer midi;
+    int nextEvent = 0;
+    juce::int64 position = 0;
+
+    while (position < maxLength)
+    {
+        auto blockEnd = position + job.blockSize;
+        midi.clear();
+
+        for (; nextEvent < sequence.getNumEvents(); ++nextEvent)
+        {
+            auto& message = sequence.getEventPointer (nextEvent)->message;
+            auto eventSample = toSamples (message.getTimeStamp());
+
+            if (eventSample >= blockEnd)
+                break;
+
+            if (! message.isMetaEvent())
+                midi.addEvent (message, (int) (eventSample - position));
+        }
+
+        processor.processBlock (buffer, midi);
+
+        auto numToWrite = (int) juce::jmin ((juce::int64) job.blockSize, maxLength - position);
+        writer->writeFromAudioSampleBuffer (buffer, 0, numToWrite);
+        position += numToWrite;
+
+        // Stop at the end of the block in which the last release tail ends
+        if (nextEvent == sequence.getNumEvents() && ! processor.hasSoundingVoices())
+            break;
+    }
+
+    processor.releaseResources();
+    writer.reset();
+
+    report.audioSeconds = (double) position / job.sampleRate;
+    report.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    return report;
+}
+
+juce::Array<OfflineRenderer::Report> OfflineRenderer::renderAll (const juce::Array<Job>& jobs, int numThreads)
+{
+    juce::Array<Report> reports;
+    reports.resize (jobs.size());
+
+    juce::ThreadPool pool (juce::jlimit (1, juce::jmax (1, jobs.size()), numThreads));
+
+    // Each job writes only its own report slot, and the array is never
+    // resized while the pool runs
+    for (int i = 0; i < jobs.size(); ++i)
+        pool.addJob ([&jobs, &reports, i] { reports.getReference (i) = render (jobs.getReference (i)); });
+
+    while (pool.getNumJobs() > 0)
+        juce::Thread::sleep (10);
+
+    return reports;
+}
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+    Renders MIDI files through the plugin's processor without a host.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Bounces a MIDI file through a private NewProjectAudioProcessor and writes
+    the result to a WAV file, as fast as the processor can run.
+
+    Every job gets a fresh processor, built, rendered and destroyed on the
+    worker thread that runs it, so jobs share nothing. The processor is left
+    with its defaults for everything that depends on timing rather than on
+    the job (streaming, the pitch cache and the CPU budget are all off), and
+    the job's sample is fully decoded before the first block. The output is
+    therefore a function of the job alone, however many run at once.
+*/
+class OfflineRenderer
+{
+public:
+    struct Job
+    {
+        juce::File midiFile, outputFile;
+        juce::File samplesDirectory;   // empty for the user's Music folder
+        juce::String sampleName;
+
+        double sampleRate = 44100.0;
+        int blockSize = 512;
+        int bitDepth = 24;
+
+        // How long to keep rendering after the last MIDI event if notes are
+        // still sounding, e.g. a note without a note-off
+        double maxTailSeconds = 10.0;
+
+        // Plain (not normalised) values, keyed by parameter ID
+        juce::NamedValueSet parameters;
+    };
+
+    struct Report
+    {
+        juce::String error;
+        double audioSeconds = 0.0, renderSeconds = 0.0;
+
+        bool succeeded() const noexcept     { return error.isEmpty(); }
+    };
+
+    // Builds a job from command-line options, see Main.cpp for the list.
+    // Reports bad options through juce::ConsoleApplication::fail().
+    static Job parseJob (const juce::ArgumentList& args);
+
+    // Renders one job on the calling thread
+    static Report render (const Job& job);
+
+    // Renders the jobs on a pool of worker threads. The reports come back in
+    // the same order as the jobs.
+    static juce::Array<Report> renderAll (const juce::Array<Job>& jobs, int numThreads);
+};
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+    An event the audio thread can signal without taking a lock.
+  ==============================================================================
+*/
+
+#include "AudioThreadEvent.h"
+
+#if JUCE_MAC
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <cerrno>
+ #include <ctime>
+#endif
+
+//==============================================================================
+#if JUCE_MAC
+
+AudioThreadEvent::AudioThreadEvent()    : semaphore (dispatch_semaphore_create (0)) {}
+AudioThreadEvent::~AudioThreadEvent()   { dispatch_release ((dispatch_semaphore_t) semaphore); }
+
+namespace
+{
+    void post (void* semaphore) noexcept
+    {
+        dispatch_semaphore_signal ((dispatch_semaphore_t) semaphore);
+    }
+
+    bool waitFor (void* semaphore, int timeOutMilliseconds) noexcept
+    {
+        auto timeout = timeOutMilliseconds < 0 ? DISPATCH_TIME_FOREVER
+                                               : dispatch_time (DISPATCH_TIME_NOW, (int64_t) timeOutMilliseconds * 1000000);
+
+        return dispatch_semaphore_wait ((dispatch_semaphore_t) semaphore, timeout) == 0;
+    }
+}
+
+#elif JUCE_WINDOWS
+
+AudioThreadEvent::AudioThreadEvent()    : semaphore (CreateSemaphore (nullptr, 0, 1, nullptr)) {}
+AudioThreadEvent::~AudioThreadEvent()   { CloseHandle ((HANDLE) semaphore); }
+
+namespace
+{
+    void post (void* semaphore) noexcept
+    {
+        ReleaseSemaphore ((HANDLE) semaphore, 1, nullptr);
+    }
+
+    bool waitFor (void* semaphore, int timeOutMilliseconds) noexcept
+    {
+        return WaitForSingleObject ((HANDLE) semaphore,
+                                    timeOutMilliseconds < 0 ? INFINITE : (DWORD) timeOutMilliseconds) == WAIT_OBJECT_0;
+    }
+}
+
+#else
+
+AudioThreadEvent::AudioThreadEvent()    { sem_init (&semaphore, 0, 0); }
+AudioThreadEvent::~AudioThreadEvent()   { sem_destroy (&semaphore); }
+
+namespace
+{
+    void post (sem_t& semaphore) noexcept
+    {
+        sem_post (&semaphore);
+    }
+
+    bool waitFor (sem_t& semaphore, int timeOutMilliseconds) noexcept
+    {
+        if (timeOutMilliseconds < 0)
+        {
+            while (sem_wait (&semaphore) != 0)
+                if (errno != EINTR)
+                    return false;
+
+            return true;
+        }
+
+        timespec deadline;
+        clock_gettime (CLOCK_REALTIME, &deadline);
+
+        auto nanoseconds = deadline.tv_nsec + (long) (timeOutMilliseconds % 1000) * 1000000;
+        deadline.tv_sec += timeOutMilliseconds / 1000 + nanoseconds / 1000000000;
+        deadline.tv_nsec = nanoseconds % 1000000000;
+
+        while (sem_timedwait (&semaphore, &deadline) != 0)
+            if (errno != EINTR)
+                return false;
+
+        return true;
+    }
+}
+
+#endif
+
+//==============================================================================
+void AudioThreadEvent::signal() noexcept
+{
+    // Only the first signal since the thread last woke needs to post; it
+    // will see whatever the later ones published when it gets going
+    if (! signalled.exchange (true, std::memory_order_acq_rel))
+        post (semaphore);
+}
+
+bool AudioThreadEvent::wait (int timeOutMilliseconds) noexcept
+{
+    if (! waitFor (semaphore, timeOutMilliseconds))
+        return false;
+
+    // Reading the flag back synchronises with the signal that set it, and
+    // lets the next one post again
+    signalled.exchange (false, std::memory_order_acq_rel);
+    return true;
+}
@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+    An event the audio thread can signal without taking a lock.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if ! (JUCE_MAC || JUCE_WINDOWS)
+ #include <semaphore.h>
+#endif
+
+//==============================================================================
+/**
+    Wakes one background thread from the audio thread.
+
+    juce::WaitableEvent (and so juce::Thread::notify) locks a mutex to signal,
+    so the audio thread could stall behind the very thread it is waking. This
+    event posts to an operating system semaphore instead, which never blocks
+    the caller. An atomic flag collapses any number of signals made before
+    the thread wakes into one post, so a busy audio thread makes at most one
+    system call per wake-up.
+
+    Like an auto-reset juce::WaitableEvent, one wait() consumes every signal
+    made before it returns. Only one thread may wait on it.
+*/
+class AudioThreadEvent
+{
+public:
+    AudioThreadEvent();
+    ~AudioThreadEvent();
+
+    // Wakes the waiting thread, or the next call to wait() if none is
+    // waiting. Never blocks, so it is safe on the audio thread.
+    void signal() noexcept;
+
+    // Sleeps until signal() is called, or for at most timeOutMilliseconds if
+    // that isn't negative. Returns false if it timed out.
+    bool wait (int timeOutMilliseconds = -1) noexcept;
+
+private:
+    std::atomic<bool> signalled { false };
+
+   #if JUCE_MAC || JUCE_WINDOWS
+    void* semaphore = nullptr;
+   #else
+    sem_t semaphore;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (AudioThreadEvent)
+};
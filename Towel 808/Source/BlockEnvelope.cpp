@@ -0,0 +1,280 @@
+/*
+  ==============================================================================
+    Attack-decay-sustain-release envelope rendered a chunk at a time.
+  ==============================================================================
+*/
+
+#include "BlockEnvelope.h"
+#include "SampleKernels.h"
+
+namespace
+{
+    // How far past its target an exponential segment aims, as a proportion
+    // of the distance it covers; it stops when it reaches the target. Falling
+    // segments aim 60 dB past, so they die away like a struck drum. The
+    // attack aims much less far and stays close to a line.
+    constexpr double fallingBend = 0.001;
+    constexpr double risingBend = 0.3;
+}
+
+//==============================================================================
+void BlockEnvelope::setSampleRate (double newSampleRate) noexcept
+{
+    jassert (newSampleRate > 0.0);
+    sampleRate = newSampleRate;
+}
+
+void BlockEnvelope::setParameters (const juce::ADSR::Parameters& newParameters) noexcept
+{
+    parameters = newParameters;
+
+    if (stage == sustain)
+    {
+        level = parameters.sustain;
+    }
+    else if (stage != idle)
+    {
+        // Carry on from the same proportion of the new segment
+        auto elapsed = (double) position / length;
+
+        if (! computeSegment())
+        {
+            finishSegment();
+            return;
+        }
+
+        position = juce::jmin (length - 1, juce::roundToInt (elapsed * length));
+        level = getSegmentValue (position);
+    }
+}
+
+void BlockEnvelope::setCurve (Curve newCurve) noexcept
+{
+    if (newCurve == curve)
+        return;
+
+    // The rest of a moving segment starts again from where it has got to,
+    // so the level doesn't jump
+    if (stage == attack || stage == decay || stage == release)
+    {
+        from = level;
+        length -= position;
+        position = 0;
+    }
+
+    curve = newCurve;
+}
+
+void BlockEnvelope::noteOn() noexcept
+{
+    enterStage (attack);
+}
+
+void BlockEnvelope::noteOff() noexcept
+{
+    if (stage != idle)
+        enterStage (release);
+}
+
+void BlockEnvelope::reset() noexcept
+{
+    stage = idle;
+    level = from = to = 0.0f;
+    length = position = 0;
+}
+
+float BlockEnvelope::getHighestLevelToCome() const noexcept
+{
+    switch (stage)
+    {
+        case attack:
+        case decay:     return juce::jmax (level, to);
+        case sustain:
+        case release:   return level;
+        case idle:
+        default:        return 0.0f;
+    }
+}
+
+//==============================================================================
+int BlockEnvelope::process (float* dest, int stride, int numSamples) noexcept
+{
+    int numDone = 0, numAudible = numSamples;
+
+    while (numDone < numSamples)
+    {
+        if (stage == idle)
+        {
+            numAudible = numDone;
+            break;
+        }
+
+        if (stage == sustain)
+        {
+            // A sustain level of zero ends the note, as it does with juce::ADSR
+            if (level <= 0.0f)
+            {
+                reset();
+                numAudible = numDone;
+                break;
+            }
+
+            if (stride == 1)
+                juce::FloatVectorOperations::fill (dest + numDone, level, numSamples - numDone);
+            else
+                for (int i = numDone; i < numSamples; ++i)
+                    dest[i * stride] = level;
+
+            numDone = numSamples;
+            break;
+        }
+
+        auto numThisTime = juce::jmin (numSamples - numDone, length - position);
+
+        if (stride == 1)
+        {
+            fillSegment (dest + numDone, position + 1, numThisTime);
+        }
+        else
+        {
+            float scratch[scratchSize];
+
+            for (int start = 0; start < numThisTime; start += scratchSize)
+            {
+                auto numInPiece = juce::jmin (scratchSize, numThisTime - start);
+                fillSegment (scratch, position + 1 + start, numInPiece);
+
+                for (int i = 0; i < numInPiece; ++i)
+                    dest[(numDone + start + i) * stride] = scratch[i];
+            }
+        }
+
+        position += numThisTime;
+        numDone += numThisTime;
+
+        auto* last = dest + (numDone - 1) * stride;
+        level = *last;
+
+        if (position == length)
+        {
+            // Land exactly on the target, whatever rounding the fill picked up
+            *last = level = to;
+
+            // A segment that ends in silence ends the note on its last sample
+            if (to <= 0.0f)
+            {
+                reset();
+                numAudible = numDone - 1;
+                break;
+            }
+
+            finishSegment();
+        }
+    }
+
+    for (int i = numAudible; i < numSamples; ++i)
+        dest[i * stride] = 0.0f;
+
+    return numAudible;
+}
+
+//==============================================================================
+void BlockEnvelope::enterStage (Stage newStage) noexcept
+{
+    stage = newStage;
+    from = level;
+    position = 0;
+
+    if (stage == sustain)
+        level = parameters.sustain;
+    else if (stage == idle)
+        reset();
+    else if (! computeSegment())
+        finishSegment();
+}
+
+bool BlockEnvelope::computeSegment() noexcept
+{
+    double seconds = 0.0;
+
+    switch (stage)
+    {
+        case attack:
+            to = 1.0f;
+            seconds = parameters.attack * (1.0 - from);
+            break;
+
+        case decay:
+            to = parameters.sustain;
+            seconds = from > to ? parameters.decay * (from - to) / (1.0 - to) : 0.0;
+            break;
+
+        case release:
+            to = 0.0f;
+            seconds = parameters.release;
+            break;
+
+        case idle:
+        case sustain:
+        default:
+            return false;
+    }
+
+    length = juce::roundToInt (seconds * sampleRate);
+    return length > 0;
+}
+
+void BlockEnvelope::finishSegment() noexcept
+{
+    level = to;
+
+    switch (stage)
+    {
+        case attack:    enterStage (decay); break;
+        case decay:     enterStage (sustain); break;
+        case release:
+        case idle:
+        case sustain:
+        default:        reset(); break;
+    }
+}
+
+void BlockEnvelope::fillSegment (float* dest, int firstSample, int numSamples) const noexcept
+{
+    auto distance = (double) to - (double) from;
+
+    if (curve == linear)
+    {
+        auto step = distance / length;
+        SampleKernels::fillRamp (dest, (float) (from + step * firstSample), (float) step, numSamples);
+        return;
+    }
+
+    // to - distance * ((1 + bend) * floor^(k / length) - bend) runs from
+    // the start level at k = 0 to the target at k = length
+    auto bend = getBend();
+    auto floor = bend / (1.0 + bend);
+
+    SampleKernels::fillExponential (dest,
+                                    (float) (to + distance * bend),
+                                    (float) (-distance * (1.0 + bend) * std::pow (floor, (double) firstSample / length)),
+                                    (float) std::pow (floor, 1.0 / length),
+                                    numSamples);
+}
+
+float BlockEnvelope::getSegmentValue (int samplePosition) const noexcept
+{
+    auto proportion = (double) samplePosition / length;
+
+    if (curve == linear)
+        return (float) (from + (to - from) * proportion);
+
+    auto bend = getBend();
+    auto shape = (1.0 + bend) * std::pow (bend / (1.0 + bend), proportion) - bend;
+    return (float) (to + (from - to) * shape);
+}
+
+double BlockEnvelope::getBend() const noexcept
+{
+    return to > from ? risingBend : fallingBend;
+}
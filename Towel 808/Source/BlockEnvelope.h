@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+    Attack-decay-sustain-release envelope rendered a chunk at a time.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A drop-in for juce::ADSR that produces whole runs of samples instead of
+    one value per call.
+
+    Each segment (attack, decay, release) is a fixed number of samples with a
+    closed-form shape, so a chunk within a segment is a single vectorised
+    fill, and a sustaining note is a constant the caller can fold into its
+    gain. Nothing branches per sample, and starting a note only works out
+    the length of the attack.
+
+    Timing follows juce::ADSR: the attack and decay times are for the full
+    distance from silence to full level and from there to the sustain level,
+    and the release takes its whole time from wherever the note was let go.
+
+    Segments are straight lines, or exponential curves that move quickly at
+    first and then settle, which is how an 808's decay sounds. Changing a
+    time moves the note to the same proportion of the new segment.
+*/
+class BlockEnvelope
+{
+public:
+    BlockEnvelope() = default;
+
+    // Segment shapes, in the order of the processor's "envCurve" choices
+    enum Curve
+    {
+        linear = 0,
+        exponential
+    };
+
+    void setSampleRate (double newSampleRate) noexcept;
+
+    // Takes effect from the next sample, including on a sounding note
+    void setParameters (const juce::ADSR::Parameters& newParameters) noexcept;
+    void setCurve (Curve newCurve) noexcept;
+
+    // The attack starts from the current level, so a retriggered note doesn't click
+    void noteOn() noexcept;
+    void noteOff() noexcept;
+    void reset() noexcept;
+
+    bool isActive() const noexcept                  { return stage != idle; }
+
+    // The level every sample holds while the envelope is sustaining, or 0
+    // while it is moving or has ended
+    float getConstantLevel() const noexcept         { return stage == sustain ? level : 0.0f; }
+
+    // The highest level the envelope can reach from here on with the
+    // current parameters: full level during the attack, otherwise where it is now
+    float getHighestLevelToCome() const noexcept;
+
+    // Writes the next numSamples values to dest[i * stride] and returns how
+    // many come before the envelope ends. The rest are zeroed.
+    int process (float* dest, int stride, int numSamples) noexcept;
+
+private:
+    enum Stage
+    {
+        idle,
+        attack,
+        decay,
+        sustain,
+        release
+    };
+
+    // Starts a stage from the current level, moving straight past any that
+    // are zero length
+    void enterStage (Stage newStage) noexcept;
+
+    // Works out the current segment's target and length from its start
+    // level and the parameters. Returns false if it has no length.
+    bool computeSegment() noexcept;
+    void finishSegment() noexcept;
+
+    // Renders numSamples of the current segment, from firstSample onwards
+    void fillSegment (float* dest, int firstSample, int numSamples) const noexcept;
+    float getSegmentValue (int samplePosition) const noexcept;
+    double getBend() const noexcept;
+
+    double sampleRate = 44100.0;
+    juce::ADSR::Parameters parameters;
+    Curve curve = linear;
+
+    Stage stage = idle;
+    float level = 0.0f;
+
+    // The current segment runs from one level to another over length
+    // samples, of which position have been rendered
+    float from = 0.0f, to = 0.0f;
+    int length = 0, position = 0;
+
+    // Strided output is rendered in pieces of this size on the stack
+    static constexpr int scratchSize = 64;
+
+    JUCE_LEAK_DETECTOR (BlockEnvelope)
+};
@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+    Unit tests for BlockEnvelope.
+  ==============================================================================
+*/
+
+#if JUCE_UNIT_TESTS
+
+#include "BlockEnvelope.h"
+#include "SampleKernels.h"
+
+//==============================================================================
+class BlockEnvelopeTests  : public juce::UnitTest
+{
+public:
+    BlockEnvelopeTests()  : juce::UnitTest ("BlockEnvelope", "Towel 808") {}
+
+    void runTest() override
+    {
+        // attack, decay, sustain, release
+        const juce::ADSR::Parameters settings[] = { { 0.1f, 0.5f, 0.6f, 0.3f },
+                                                    { 0.0f, 0.2f, 0.0f, 0.3f },
+                                                    { 0.01f, 0.0f, 0.5f, 0.0f },
+                                                    { 0.002f, 0.05f, 1.0f, 1.5f } };
+
+        beginTest ("Linear segments follow juce::ADSR");
+
+        for (auto& parameters : settings)
+        {
+            // Chunk sizes and strides as the voices and the lane engine use them
+            expectFollowsADSR (parameters, 64, 1);
+            expectFollowsADSR (parameters, 37, SampleKernels::lanesPerGroup);
+        }
+
+        beginTest ("Exponential segments take as long as linear ones");
+
+        for (auto& parameters : settings)
+            expectSameLength (parameters);
+
+        beginTest ("No level to come is above getHighestLevelToCome");
+
+        for (auto curve : { BlockEnvelope::linear, BlockEnvelope::exponential })
+            for (auto& parameters : settings)
+                expectHighestLevelHolds (parameters, curve);
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+
+    // The note is held for noteLength samples and then released
+    static constexpr int noteLength = 48000;
+    static constexpr int maxLength = 4 * noteLength;
+
+    static BlockEnvelope makeEnvelope (const juce::ADSR::Parameters& parameters, BlockEnvelope::Curve curve)
+    {
+        BlockEnvelope envelope;
+        envelope.setSampleRate (sampleRate);
+        envelope.setParameters (parameters);
+        envelope.setCurve (curve);
+        envelope.noteOn();
+
+        return envelope;
+    }
+
+    // Renders the envelope chunk by chunk, releasing it after noteLength
+    // samples, and returns how many samples it lasted
+    static int render (BlockEnvelope& envelope, float* levels, int chunkSize, int stride)
+    {
+        juce::HeapBlock<float> chunk ((size_t) (chunkSize * stride), true);
+
+        for (int start = 0; start < maxLength; start += chunkSize)
+        {
+            if (start >= noteLength && start - chunkSize < noteLength)
+                envelope.noteOff();
+
+            auto numThisTime = juce::jmin (chunkSize, maxLength - start);
+            auto numActive = envelope.process (chunk, stride, numThisTime);
+
+            for (int i = 0; i < numThisTime; ++i)
+                levels[start + i] = chunk[i * stride];
+
+            if (numActive < numThisTime)
+                return start + numActive;
+        }
+
+        return maxLength;
+    }
+
+    static int getReleaseSample (int chunkSize)
+    {
+        return (noteLength + chunkSize - 1) / chunkSize * chunkSize;
+    }
+
+    void expectFollowsADSR (const juce::ADSR::Parameters& parameters, int chunkSize, int stride)
+    {
+        auto envelope = makeEnvelope (parameters, BlockEnvelope::linear);
+
+        juce::ADSR adsr;
+        adsr.setSampleRate (sampleRate);
+        adsr.setParameters (parameters);
+        adsr.noteOn();
+
+        juce::HeapBlock<float> levels ((size_t) maxLength, true);
+        auto length = render (envelope, levels, chunkSize, stride);
+        auto releaseSample = getReleaseSample (chunkSize);
+
+        float worst = 0.0f;
+        int adsrLength = 0;
+
+        for (; adsrLength < maxLength; ++adsrLength)
+        {
+            if (adsrLength == releaseSample)
+                adsr.noteOff();
+
+            auto expected = adsr.getNextSample();
+
+            // A note with no sustain ends with its decay; juce::ADSR would
+            // hold it at zero until it was released
+            if (! adsr.isActive() || expected <= 0.0f)
+                break;
+
+            worst = juce::jmax (worst, std::abs (levels[adsrLength] - expected));
+        }
+
+        // juce::ADSR adds up its steps in floats, which drifts a little over
+        // a long segment and can end a long release a few samples late. The
+        // envelope works each value out afresh.
+        expectLessThan (worst, 2.0e-3f);
+        expect (std::abs (length - adsrLength) <= juce::jmax (1, adsrLength / 10000), "lasted " + juce::String (length)
+                                                     + " samples, juce::ADSR " + juce::String (adsrLength));
+
+        // Everything after the end is silent
+        expectEquals (juce::FloatVectorOperations::findMaximum (levels + length, maxLength - length), 0.0f);
+    }
+
+    void expectSameLength (const juce::ADSR::Parameters& parameters)
+    {
+        juce::HeapBlock<float> linearLevels ((size_t) maxLength, true), curvedLevels ((size_t) maxLength, true);
+
+        auto linear = makeEnvelope (parameters, BlockEnvelope::linear);
+        auto curved = makeEnvelope (parameters, BlockEnvelope::exponential);
+
+        auto linearLength = render (linear, linearLevels, 64, 1);
+        auto curvedLength = render (curved, curvedLevels, 64, 1);
+
+        expectEquals (curvedLength, linearLength);
+
+        // Both reach full level at the end of the attack and sit at the
+        // sustain level once the decay is over
+        auto attackEnd = juce::roundToInt (parameters.attack * sampleRate);
+        auto decayEnd = attackEnd + juce::roundToInt (parameters.decay * sampleRate);
+
+        if (attackEnd > 0 && attackEnd < noteLength)
+            expectWithinAbsoluteError (curvedLevels[attackEnd - 1], linearLevels[attackEnd - 1], 1.0e-3f);
+
+        if (decayEnd + 1 < noteLength)
+            expectWithinAbsoluteError (curvedLevels[decayEnd + 1], parameters.sustain, 1.0e-3f);
+    }
+
+    void expectHighestLevelHolds (const juce::ADSR::Parameters& parameters, BlockEnvelope::Curve curve)
+    {
+        auto envelope = makeEnvelope (parameters, curve);
+        auto releaseSample = getReleaseSample (64);
+
+        juce::HeapBlock<float> levels ((size_t) maxLength, true);
+        juce::Array<float> highestAtChunk;
+
+        // Renders the same note again, noting the promise at each chunk
+        for (int start = 0; start < maxLength; start += 64)
+        {
+            if (start == releaseSample)
+                envelope.noteOff();
+
+            highestAtChunk.add (envelope.getHighestLevelToCome());
+
+            if (envelope.process (levels + start, 1, 64) < 64)
+                break;
+        }
+
+        float worst = 0.0f;
+
+        for (int chunk = 0; chunk < highestAtChunk.size(); ++chunk)
+        {
+            auto start = chunk * 64;
+            auto peak = juce::FloatVectorOperations::findMaximum (levels + start, maxLength - start);
+            worst = juce::jmax (worst, peak - highestAtChunk[chunk]);
+        }
+
+        expectLessOrEqual (worst, 1.0e-6f);
+    }
+};
+
+static BlockEnvelopeTests blockEnvelopeTests;
+
+#endif
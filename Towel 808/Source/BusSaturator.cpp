@@ -0,0 +1,289 @@
+/*
+  ==============================================================================
+    Oversampled drive and clip stage for the sampler's summed output.
+  ==============================================================================
+*/
+
+#include "BusSaturator.h"
+#include "SampleKernels.h"
+
+namespace
+{
+    // Non-zero taps per branch of each step. The first step's filter is 63
+    // taps long and the second's 31.
+    constexpr int firstStageTaps = 32;
+    constexpr int secondStageTaps = 16;
+
+    // Kaiser window shape: about 80 dB of stopband rejection
+    constexpr double kaiserBeta = 8.0;
+
+    // How long drive changes take to settle, so automation doesn't click
+    constexpr double driveRampSeconds = 0.02;
+
+    double besselI0 (double x) noexcept
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; term > sum * 1.0e-12; ++k)
+        {
+            auto factor = x / (2.0 * k);
+            term *= factor * factor;
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+//==============================================================================
+BusSaturator::HalfBand::HalfBand (int numBranchTaps)
+    : numTaps (numBranchTaps)
+{
+    jassert (numTaps % 4 == 0 && numTaps <= maxTaps);
+
+    // A half-band lowpass has its cutoff at a quarter of the higher rate, so
+    // the windowed sinc is zero at every even offset from the centre. The
+    // branch holds the odd offsets, -(numTaps - 1) to numTaps - 1.
+    auto centre = numTaps - 1;
+    double taps[maxTaps], sum = 0.0;
+
+    for (int k = 0; k < numTaps; ++k)
+    {
+        auto offset = 2 * k - centre;
+        auto x = juce::MathConstants<double>::halfPi * offset;
+        auto u = (double) offset / (centre + 1);
+
+        taps[k] = std::sin (x) / x * besselI0 (kaiserBeta * std::sqrt (1.0 - u * u));
+        sum += taps[k];
+    }
+
+    // The branch carries half the gain at DC and the centre tap the other half
+    for (int k = 0; k < numTaps; ++k)
+    {
+        downTaps[k] = (float) (0.5 * taps[k] / sum);
+        upTaps[k] = 2.0f * downTaps[k];
+    }
+
+    reset();
+}
+
+void BusSaturator::HalfBand::reset() noexcept
+{
+    for (auto* states : { upState, downState })
+    {
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            juce::zeromem (states[channel].input, sizeof (states[channel].input));
+            juce::zeromem (states[channel].odd, sizeof (states[channel].odd));
+            states[channel].position = 0;
+        }
+    }
+}
+
+void BusSaturator::HalfBand::upsample (int channel, const float* input, float* output, int numInputSamples) noexcept
+{
+    auto& state = upState[channel];
+    auto half = numTaps / 2;
+
+    for (int i = 0; i < numInputSamples; ++i)
+    {
+        state.position = (state.position + 1) % numTaps;
+        state.input[state.position] = state.input[state.position + numTaps] = input[i];
+
+        // window[numTaps - 1] is the newest input sample
+        auto* window = state.input + state.position + 1;
+
+        // The stuffed zeros only meet the branch taps; the samples between
+        // them only meet the centre tap, which passes them through delayed
+        output[2 * i]     = SampleKernels::dotProduct (upTaps, window, numTaps);
+        output[2 * i + 1] = window[numTaps - half];
+    }
+}
+
+void BusSaturator::HalfBand::downsample (int channel, const float* input, float* output, int numOutputSamples) noexcept
+{
+    auto& state = downState[channel];
+    auto half = numTaps / 2;
+
+    for (int i = 0; i < numOutputSamples; ++i)
+    {
+        state.position = (state.position + 1) % numTaps;
+        state.input[state.position] = state.input[state.position + numTaps] = input[2 * i];
+        state.odd[state.position] = state.odd[state.position + numTaps] = input[2 * i + 1];
+
+        // Only the even samples meet the branch taps, and of the odd ones
+        // only the one under the centre tap counts
+        auto* window = state.input + state.position + 1;
+        auto* oddWindow = state.odd + state.position + 1;
+
+        output[i] = SampleKernels::dotProduct (downTaps, window, numTaps) + 0.5f * oddWindow[numTaps - 1 - half];
+    }
+}
+
+//==============================================================================
+BusSaturator::BusSaturator()
+    : firstStage (firstStageTaps),
+      secondStage (secondStageTaps)
+{
+}
+
+void BusSaturator::prepare (double sampleRate, int newMaxBlockSize)
+{
+    maxBlockSize = juce::jmax (1, newMaxBlockSize);
+    twice.setSize (2, 2 * maxBlockSize);
+    fourTimes.setSize (2, 4 * maxBlockSize);
+    driveGains.allocate ((size_t) maxBlockSize, true);
+
+    drive.reset (sampleRate, driveRampSeconds);
+    reset();
+}
+
+void BusSaturator::reset() noexcept
+{
+    firstStage.reset();
+    secondStage.reset();
+    heldSample[0] = heldSample[1] = 0.0f;
+    drive.setCurrentAndTargetValue (drive.getTargetValue());
+    activeStages = requestedStages.load();
+    silentSamples = flushSamples;
+}
+
+void BusSaturator::setOversamplingStages (int numStages) noexcept
+{
+    requestedStages = juce::jlimit (0, maxOversamplingStages, numStages);
+}
+
+void BusSaturator::setDrive (float driveDecibels) noexcept
+{
+    drive.setTargetValue (juce::Decibels::decibelsToGain (driveDecibels));
+}
+
+int BusSaturator::getLatencySamples (int numStages) noexcept
+{
+    // Each step delays by its filter's centre twice, once on the way up and
+    // once on the way down, at its higher rate. At 4x the second step comes
+    // to half a host sample, rounded up by the one-sample hold at 2x.
+    auto firstDelay = firstStageTaps - 1;
+    auto secondDelay = secondStageTaps - 1;
+
+    switch (numStages)
+    {
+        case 0:     return 0;
+        case 1:     return firstDelay;
+        default:    return firstDelay + (2 * secondDelay + 2) / 4;
+    }
+}
+
+bool BusSaturator::isIdle() const noexcept
+{
+    return activeStages == 0 || silentSamples >= flushSamples;
+}
+
+//==============================================================================
+void BusSaturator::process (juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    if (requestedStages.load() != activeStages)
+        reset();
+
+    auto numChannels = juce::jmin (2, buffer.getNumChannels());
+
+    if (activeStages > 0)
+    {
+        bool hasSignal = false;
+
+        for (int channel = 0; channel < numChannels && ! hasSignal; ++channel)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax (buffer.getReadPointer (channel), numSamples);
+            hasSignal = range.getStart() != 0.0f || range.getEnd() != 0.0f;
+        }
+
+        silentSamples = hasSignal ? 0 : juce::jmin (flushSamples, silentSamples + numSamples);
+    }
+
+    // With the curve off at the host rate there is nothing to do at all
+    if (curve == off && activeStages == 0)
+        return;
+
+    for (int start = 0; start < numSamples; start += maxBlockSize)
+    {
+        auto numThisTime = juce::jmin (maxBlockSize, numSamples - start);
+
+        // One ramp for both channels, so a drive change never shifts the image
+        bool driving = curve != off;
+
+        if (driving)
+            for (int i = 0; i < numThisTime; ++i)
+                driveGains[i] = drive.getNextValue();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = buffer.getWritePointer (channel, start);
+
+            if (driving)
+                juce::FloatVectorOperations::multiply (samples, driveGains, numThisTime);
+
+            if (activeStages == 0)
+            {
+                shape (samples, numThisTime);
+                continue;
+            }
+
+            auto* upTwice = twice.getWritePointer (channel);
+            firstStage.upsample (channel, samples, upTwice, numThisTime);
+
+            if (activeStages == 1)
+            {
+                shape (upTwice, 2 * numThisTime);
+            }
+            else
+            {
+                auto numTwice = 2 * numThisTime;
+                auto held = upTwice[numTwice - 1];
+                std::memmove (upTwice + 1, upTwice, (size_t) (numTwice - 1) * sizeof (float));
+                upTwice[0] = heldSample[channel];
+                heldSample[channel] = held;
+
+                auto* upFourTimes = fourTimes.getWritePointer (channel);
+                secondStage.upsample (channel, upTwice, upFourTimes, numTwice);
+                shape (upFourTimes, 2 * numTwice);
+                secondStage.downsample (channel, upFourTimes, upTwice, numTwice);
+            }
+
+            firstStage.downsample (channel, upTwice, samples, numThisTime);
+        }
+    }
+}
+
+void BusSaturator::shape (float* samples, int numSamples) const noexcept
+{
+    // Plain loops over clamped polynomials, which the compiler vectorises
+    switch (curve)
+    {
+        case soft:
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto x = juce::jlimit (-1.0f, 1.0f, samples[i]);
+                samples[i] = x * (1.5f - 0.5f * x * x);
+            }
+            break;
+
+        case tape:
+            // Pade approximant of tanh, which reaches exactly 1 at x = 3
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto x = juce::jlimit (-3.0f, 3.0f, samples[i]);
+                auto x2 = x * x;
+                samples[i] = x * (27.0f + x2) / (27.0f + 9.0f * x2);
+            }
+            break;
+
+        case hard:
+            for (int i = 0; i < numSamples; ++i)
+                samples[i] = juce::jlimit (-1.0f, 1.0f, samples[i]);
+            break;
+
+        case off:
+        default:
+            break;
+    }
+}
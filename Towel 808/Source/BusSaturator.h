@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+    Oversampled drive and clip stage for the sampler's summed output.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Drives the mixed output of all voices into a clipping curve once per
+    block, so an 808 can be saturated without a separate plugin after it.
+
+    The curve runs at two or four times the host rate. Each factor of two is
+    a linear-phase half-band FIR in polyphase form: every other tap is zero
+    apart from the centre one, so each sample costs a single SIMD dot product
+    over the remaining taps. The first step carries the steep filter that
+    keeps harmonics above the host's Nyquist frequency from folding back;
+    the second only has to clear the first step's images and is half as long.
+
+    The filters delay the output by a whole number of samples, which the
+    processor reports to the host. The delay depends only on the oversampling
+    factor, so turning the curve on or off never moves the host's latency
+    compensation. With no oversampling the stage adds no latency and costs
+    nothing while the curve is off.
+
+    The settings and process() belong to the audio thread, apart from the
+    oversampling factor, which may be changed from any thread.
+*/
+class BusSaturator
+{
+public:
+    BusSaturator();
+
+    // Clipping curves, in the order of the processor's "clipCurve" choices
+    enum Curve
+    {
+        off = 0,
+        soft,       // cubic, smooth all the way into clipping
+        tape,       // rational tanh approximation, rounder at the knee
+        hard        // straight clip at full scale
+    };
+
+    // 0 runs the curve at the host rate, 1 at twice it and 2 at four times
+    static constexpr int maxOversamplingStages = 2;
+
+    // Sizes the scratch buffers for blocks of up to maxBlockSize samples and
+    // clears the filters. Larger blocks are processed in pieces.
+    void prepare (double sampleRate, int maxBlockSize);
+    void reset() noexcept;
+
+    // Takes effect at the start of the next block, with cleared filters
+    void setOversamplingStages (int numStages) noexcept;
+    int getOversamplingStages() const noexcept          { return requestedStages.load(); }
+
+    void setDrive (float driveDecibels) noexcept;
+    void setCurve (Curve newCurve) noexcept              { curve = newCurve; }
+
+    // Delay through the stage, in samples at the host rate
+    static int getLatencySamples (int numStages) noexcept;
+
+    // Saturates the first one or two channels of the buffer in place
+    void process (juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    // True once the filters hold nothing but silence, so a block of silent
+    // input would come out silent. An idle processor can then skip the stage.
+    bool isIdle() const noexcept;
+
+private:
+    //==============================================================================
+    class HalfBand
+    {
+    public:
+        // numTaps is the length of the branch that holds the non-zero taps,
+        // a multiple of four; the whole filter is 2 * numTaps - 1 long
+        explicit HalfBand (int numTaps);
+
+        void reset() noexcept;
+
+        // Two output samples per input sample
+        void upsample (int channel, const float* input, float* output, int numInputSamples) noexcept;
+
+        // One output sample per two input samples
+        void downsample (int channel, const float* input, float* output, int numOutputSamples) noexcept;
+
+        // Delay of one pass, in samples at the higher rate
+        int getDelay() const noexcept       { return numTaps - 1; }
+
+        static constexpr int maxTaps = 32;
+
+    private:
+        // Histories are stored twice over so the newest numTaps samples are
+        // always contiguous for the dot product
+        struct State
+        {
+            float input[2 * maxTaps], odd[2 * maxTaps];
+            int position;
+        };
+
+        const int numTaps;
+
+        // Branch taps, oldest sample first; the upsampler's are doubled to
+        // make up for the zeros stuffed between input samples
+        float upTaps[maxTaps], downTaps[maxTaps];
+        State upState[2], downState[2];
+    };
+
+    void shape (float* samples, int numSamples) const noexcept;
+
+    HalfBand firstStage, secondStage;
+
+    std::atomic<int> requestedStages { 0 };
+    int activeStages = 0;
+    Curve curve = off;
+
+    juce::SmoothedValue<float> drive { 1.0f };
+
+    // Scratch at two and four times the block size, and the drive ramp
+    juce::AudioBuffer<float> twice, fourTimes;
+    juce::HeapBlock<float> driveGains;
+    int maxBlockSize = 0;
+
+    // The 4x path is half a host sample short of a whole one. Holding the
+    // 2x signal back by one sample, the last of which is kept here, makes it whole.
+    float heldSample[2] {};
+
+    // Host-rate samples since the last block with any signal in it. Once it
+    // passes the longest history, every filter has flushed.
+    static constexpr int flushSamples = 2 * HalfBand::maxTaps;
+    int silentSamples = flushSamples;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BusSaturator)
+};
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+    Unit tests for BusSaturator.
+  ==============================================================================
+*/
+
+#if JUCE_UNIT_TESTS
+
+#include "BusSaturator.h"
+
+//==============================================================================
+class BusSaturatorTests  : public juce::UnitTest
+{
+public:
+    BusSaturatorTests()  : juce::UnitTest ("BusSaturator", "Towel 808") {}
+
+    void runTest() override
+    {
+        beginTest ("Without a curve or oversampling the signal is untouched");
+        {
+            BusSaturator saturator;
+            saturator.prepare (48000.0, blockSize);
+
+            auto buffer = makeImpulse();
+            saturator.process (buffer, blockSize);
+
+            expectEquals (BusSaturator::getLatencySamples (0), 0);
+            expectEquals (buffer.getSample (0, 0), 1.0f);
+            expectEquals (buffer.getMagnitude (0, 1, blockSize - 1), 0.0f);
+        }
+
+        // With the curve off, oversampling is just the half-band filters up
+        // and back down again
+        for (int stages = 1; stages <= BusSaturator::maxOversamplingStages; ++stages)
+        {
+            auto latency = BusSaturator::getLatencySamples (stages);
+
+            beginTest ("Oversampling " + juce::String (1 << stages) + "x: unity gain at DC");
+            {
+                auto saturator = makeSaturator (stages);
+
+                juce::AudioBuffer<float> buffer (2, blockSize);
+                juce::FloatVectorOperations::fill (buffer.getWritePointer (0), 0.5f, blockSize);
+                juce::FloatVectorOperations::fill (buffer.getWritePointer (1), -0.25f, blockSize);
+                saturator->process (buffer, blockSize);
+
+                // Once every filter has filled up
+                auto settled = 2 * latency;
+
+                for (int channel = 0; channel < 2; ++channel)
+                {
+                    auto range = juce::FloatVectorOperations::findMinAndMax (buffer.getReadPointer (channel, settled),
+                                                                            blockSize - settled);
+                    auto expected = channel == 0 ? 0.5f : -0.25f;
+
+                    expectWithinAbsoluteError (range.getStart(), expected, 1.0e-5f);
+                    expectWithinAbsoluteError (range.getEnd(), expected, 1.0e-5f);
+                }
+            }
+
+            beginTest ("Oversampling " + juce::String (1 << stages) + "x: delay matches getLatencySamples");
+            {
+                auto saturator = makeSaturator (stages);
+
+                auto buffer = makeImpulse();
+                saturator->process (buffer, blockSize);
+
+                for (int channel = 0; channel < 2; ++channel)
+                {
+                    auto* response = buffer.getReadPointer (channel);
+                    int peak = 0;
+
+                    for (int i = 1; i < blockSize; ++i)
+                        if (std::abs (response[i]) > std::abs (response[peak]))
+                            peak = i;
+
+                    expectEquals (peak, latency);
+
+                    // Linear phase: the response is symmetric about the delay
+                    float worst = 0.0f;
+
+                    for (int offset = 1; offset <= latency; ++offset)
+                        worst = juce::jmax (worst, std::abs (response[latency - offset] - response[latency + offset]));
+
+                    expectLessThan (worst, 1.0e-6f);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr int blockSize = 512;
+
+    static std::unique_ptr<BusSaturator> makeSaturator (int stages)
+    {
+        auto saturator = std::make_unique<BusSaturator>();
+        saturator->setOversamplingStages (stages);
+        saturator->setCurve (BusSaturator::off);
+        saturator->prepare (48000.0, blockSize);
+
+        return saturator;
+    }
+
+    static juce::AudioBuffer<float> makeImpulse()
+    {
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        buffer.clear();
+        buffer.setSample (0, 0, 1.0f);
+        buffer.setSample (1, 0, 1.0f);
+
+        return buffer;
+    }
+};
+
+static BusSaturatorTests busSaturatorTests;
+
+#endif
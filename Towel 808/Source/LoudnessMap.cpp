@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+    Block-wise peak levels of a sample, measured once when it is loaded.
+  ==============================================================================
+*/
+
+#include "LoudnessMap.h"
+
+//==============================================================================
+void LoudnessMap::clear()
+{
+    remainingPeaks.clearQuick();
+    numFrames = 0;
+}
+
+void LoudnessMap::measure (const float* const* channels, int numChannels, int numFramesToMeasure)
+{
+    clear();
+    remainingPeaks.ensureStorageAllocated ((numFramesToMeasure + blockSize - 1) / blockSize);
+
+    for (int start = 0; start < numFramesToMeasure; start += blockSize)
+    {
+        auto numThisTime = juce::jmin (blockSize, numFramesToMeasure - start);
+        float peak = 0.0f;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax (channels[ch] + start, numThisTime);
+            peak = juce::jmax (peak, -range.getStart(), range.getEnd());
+        }
+
+        addPeak (start, start + numThisTime, peak);
+    }
+
+    accumulate();
+}
+
+void LoudnessMap::measure (const juce::int16* const* channels, int numChannels, int numFramesToMeasure, float scale)
+{
+    clear();
+    remainingPeaks.ensureStorageAllocated ((numFramesToMeasure + blockSize - 1) / blockSize);
+
+    for (int start = 0; start < numFramesToMeasure; start += blockSize)
+    {
+        auto numThisTime = juce::jmin (blockSize, numFramesToMeasure - start);
+        int peak = 0;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < numThisTime; ++i)
+                peak = juce::jmax (peak, std::abs ((int) channels[ch][start + i]));
+
+        addPeak (start, start + numThisTime, (float) peak * scale);
+    }
+
+    accumulate();
+}
+
+void LoudnessMap::extend (const juce::Array<float>& slicePeaks, juce::int64 totalFrames)
+{
+    auto numSlices = slicePeaks.size();
+
+    if (numSlices == 0 || totalFrames <= numFrames)
+        return;
+
+    // The slices split the sample the way the library does, frame
+    // f landing in slice f * numSlices / totalFrames
+    for (auto start = numFrames; start < totalFrames;)
+    {
+        auto end = juce::jmin (totalFrames, (start / blockSize + 1) * blockSize);
+        auto first = (int) (start * numSlices / totalFrames);
+        auto last = (int) ((end - 1) * numSlices / totalFrames);
+        float peak = 0.0f;
+
+        for (int slice = first; slice <= last; ++slice)
+            peak = juce::jmax (peak, slicePeaks.getUnchecked (slice));
+
+        addPeak (start, end, peak);
+        start = end;
+    }
+
+    accumulate();
+}
+
+//==============================================================================
+float LoudnessMap::getPeakFrom (juce::int64 frame) const noexcept
+{
+    if (numFrames == 0)
+        return 1.0f;
+
+    if (frame >= numFrames)
+        return 0.0f;
+
+    return remainingPeaks.getUnchecked ((int) (juce::jmax ((juce::int64) 0, frame) / blockSize));
+}
+
+juce::int64 LoudnessMap::getAudibleLength (float threshold) const noexcept
+{
+    // The values only ever fall towards the end, so the audible blocks are
+    // the ones before the first that drops below the threshold
+    int numAudible = 0;
+
+    while (numAudible < remainingPeaks.size() && remainingPeaks.getUnchecked (numAudible) >= threshold)
+        ++numAudible;
+
+    return juce::jmin (numFrames, (juce::int64) numAudible * blockSize);
+}
+
+//==============================================================================
+void LoudnessMap::addPeak (juce::int64 start, juce::int64 end, float peak)
+{
+    jassert (start < end);
+
+    auto lastBlock = (int) ((end - 1) / blockSize);
+
+    while (remainingPeaks.size() <= lastBlock)
+        remainingPeaks.add (0.0f);
+
+    for (auto block = (int) (start / blockSize); block <= lastBlock; ++block)
+    {
+        auto& value = remainingPeaks.getReference (block);
+        value = juce::jmax (value, peak);
+    }
+
+    numFrames = juce::jmax (numFrames, end);
+}
+
+void LoudnessMap::accumulate() noexcept
+{
+    for (int block = remainingPeaks.size() - 1; --block >= 0;)
+    {
+        auto& value = remainingPeaks.getReference (block);
+        value = juce::jmax (value, remainingPeaks.getUnchecked (block + 1));
+    }
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+    Block-wise peak levels of a sample, measured once when it is loaded.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    The peak level of every block of a sample, stored as the highest peak
+    from each block to the end of the sample.
+
+    A voice looks up how loud anything it has left to play can get with a
+    single read, so it can end as soon as the rest of the note is below
+    -96 dB instead of playing a near-silent tail to the last sample. The same
+    table tells the loader where a sample's audible part ends.
+
+    A map covers a whole sample or nothing. An empty map knows nothing about
+    the sample and reports every frame as full scale, so it never ends a note
+    early. It is built before the sound reaches the audio thread and only read
+    after that.
+*/
+class LoudnessMap
+{
+public:
+    LoudnessMap() = default;
+
+    // Frames per measured block: about 6 ms at 44.1 kHz
+    static constexpr int blockSize = 256;
+
+    // Level below which a voice is treated as silent, -96 dB
+    static constexpr float silence = 1.5849e-5f;
+
+    void clear();
+
+    // Measures numFrames frames of float data, or of 16-bit data that is
+    // turned back into float by multiplying by scale
+    void measure (const float* const* channels, int numChannels, int numFrames);
+    void measure (const juce::int16* const* channels, int numChannels, int numFrames, float scale);
+
+    // Covers the frames after the measured ones, up to totalFrames, from the
+    // peaks of equal slices of the whole sample. This is how the library's
+    // waveform overview describes the part of a streaming sound that isn't
+    // resident.
+    void extend (const juce::Array<float>& slicePeaks, juce::int64 totalFrames);
+
+    bool isEmpty() const noexcept                       { return numFrames == 0; }
+    juce::int64 getNumFrames() const noexcept           { return numFrames; }
+
+    // The highest peak of any frame from this one to the end. Frames past
+    // the end are silent.
+    float getPeakFrom (juce::int64 frame) const noexcept;
+    float getPeak() const noexcept                      { return getPeakFrom (0); }
+
+    // Frames up to the end of the last block that peaks at or above
+    // threshold; everything after it is quieter
+    juce::int64 getAudibleLength (float threshold) const noexcept;
+
+private:
+    // Raises the peak of every block that frames start to end touch
+    void addPeak (juce::int64 start, juce::int64 end, float peak);
+
+    // Makes each block's value the highest from there to the end again
+    void accumulate() noexcept;
+
+    juce::Array<float> remainingPeaks;
+    juce::int64 numFrames = 0;
+
+    JUCE_LEAK_DETECTOR (LoudnessMap)
+};
@@ -0,0 +1,179 @@
+/*
+  ==============================================================================
+    Unit tests for LoudnessMap.
+  ==============================================================================
+*/
+
+#if JUCE_UNIT_TESTS
+
+#include "LoudnessMap.h"
+
+//==============================================================================
+class LoudnessMapTests  : public juce::UnitTest
+{
+public:
+    LoudnessMapTests()  : juce::UnitTest ("LoudnessMap", "Towel 808") {}
+
+    void runTest() override
+    {
+        beginTest ("An empty map never ends a note");
+        {
+            LoudnessMap map;
+            expect (map.isEmpty());
+            expectEquals (map.getPeakFrom (0), 1.0f);
+            expectEquals (map.getPeakFrom (1000000), 1.0f);
+        }
+
+        beginTest ("Each block holds the highest peak from there to the end");
+        {
+            auto sample = makeDecay (numFrames);
+
+            LoudnessMap map;
+            map.measure (sample.getArrayOfReadPointers(), sample.getNumChannels(), numFrames);
+
+            expectEquals (map.getNumFrames(), (juce::int64) numFrames);
+            expectMatchesSuffixMaxima (map, sample);
+            expectEquals (map.getPeakFrom (numFrames), 0.0f);
+        }
+
+        beginTest ("16-bit data measures the same as its float equivalent");
+        {
+            auto sample = makeDecay (numFrames);
+            constexpr auto scale = 1.0f / 32768.0f;
+
+            juce::HeapBlock<juce::int16> left ((size_t) numFrames), right ((size_t) numFrames);
+
+            for (int i = 0; i < numFrames; ++i)
+            {
+                left[i]  = (juce::int16) juce::roundToInt (sample.getSample (0, i) * 32767.0f);
+                right[i] = (juce::int16) juce::roundToInt (sample.getSample (1, i) * 32767.0f);
+                sample.setSample (0, i, left[i] * scale);
+                sample.setSample (1, i, right[i] * scale);
+            }
+
+            const juce::int16* channels[] = { left, right };
+
+            LoudnessMap map;
+            map.measure (channels, 2, numFrames, scale);
+
+            expectMatchesSuffixMaxima (map, sample);
+        }
+
+        beginTest ("The audible length ends with the last block above the threshold");
+        {
+            auto sample = makeDecay (numFrames);
+
+            LoudnessMap map;
+            map.measure (sample.getArrayOfReadPointers(), sample.getNumChannels(), numFrames);
+
+            for (auto threshold : { LoudnessMap::silence, 1.0e-3f, 0.1f, 0.5f, 2.0f })
+            {
+                juce::int64 expected = 0;
+
+                for (int i = 0; i < numFrames; ++i)
+                    if (juce::jmax (std::abs (sample.getSample (0, i)), std::abs (sample.getSample (1, i))) >= threshold)
+                        expected = juce::jmin ((juce::int64) numFrames, (juce::int64) (i / blockSize + 1) * blockSize);
+
+                expectEquals (map.getAudibleLength (threshold), expected);
+            }
+        }
+
+        beginTest ("Slice peaks cover the frames that weren't measured");
+        {
+            constexpr int numSlices = 128;
+            constexpr int numMeasured = 3000;
+
+            auto sample = makeDecay (numFrames);
+
+            juce::Array<float> slicePeaks;
+
+            for (int slice = 0; slice < numSlices; ++slice)
+            {
+                // The frames the library puts in this slice
+                auto start = ((juce::int64) slice * numFrames + numSlices - 1) / numSlices;
+                auto end = ((juce::int64) (slice + 1) * numFrames + numSlices - 1) / numSlices;
+                float peak = 0.0f;
+
+                for (auto i = start; i < end; ++i)
+                    peak = juce::jmax (peak, std::abs (sample.getSample (0, (int) i)), std::abs (sample.getSample (1, (int) i)));
+
+                slicePeaks.add (peak);
+            }
+
+            LoudnessMap map;
+            map.measure (sample.getArrayOfReadPointers(), sample.getNumChannels(), numMeasured);
+            map.extend (slicePeaks, numFrames);
+
+            expectEquals (map.getNumFrames(), (juce::int64) numFrames);
+
+            // The slices are coarser than the blocks, so a block may report
+            // a louder slice it shares frames with, but never anything quieter
+            // than the frames it really has left
+            int numTooQuiet = 0;
+
+            for (int frame = 0; frame < numFrames; frame += blockSize / 2)
+                if (map.getPeakFrom (frame) < getSuffixMaximum (sample, frame / blockSize * blockSize))
+                    ++numTooQuiet;
+
+            expectEquals (numTooQuiet, 0);
+        }
+    }
+
+private:
+    // Not a whole number of blocks, so the last one is short
+    static constexpr int numFrames = 40000;
+    static constexpr int blockSize = LoudnessMap::blockSize;
+
+    // Noise with an uneven decay and a quiet bump near the end, so the
+    // suffix maxima aren't simply each block's own peak
+    juce::AudioBuffer<float> makeDecay (int length)
+    {
+        auto random = getRandom();
+        juce::AudioBuffer<float> sample (2, length);
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            for (int i = 0; i < length; ++i)
+            {
+                auto level = std::exp (-8.0f * (float) i / (float) length) * random.nextFloat();
+
+                if (i > length * 9 / 10 && i < length * 9 / 10 + 100)
+                    level += 0.01f;
+
+                sample.setSample (channel, i, (random.nextBool() ? level : -level) * 0.9f);
+            }
+        }
+
+        return sample;
+    }
+
+    static float getSuffixMaximum (const juce::AudioBuffer<float>& sample, int from)
+    {
+        float peak = 0.0f;
+
+        for (int channel = 0; channel < sample.getNumChannels(); ++channel)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax (sample.getReadPointer (channel, from),
+                                                                    sample.getNumSamples() - from);
+            peak = juce::jmax (peak, -range.getStart(), range.getEnd());
+        }
+
+        return peak;
+    }
+
+    void expectMatchesSuffixMaxima (const LoudnessMap& map, const juce::AudioBuffer<float>& sample)
+    {
+        int numWrong = 0;
+
+        for (int frame = 0; frame < sample.getNumSamples(); frame += blockSize / 4)
+            if (map.getPeakFrom (frame) != getSuffixMaximum (sample, frame / blockSize * blockSize))
+                ++numWrong;
+
+        expectEquals (numWrong, 0);
+        expectEquals (map.getPeak(), getSuffixMaximum (sample, 0));
+    }
+};
+
+static LoudnessMapTests loudnessMapTests;
+
+#endif
@@ -0,0 +1,1216 @@
+/*
+  ==============================================================================
+    Sampler sound, voice and synthesiser classes used by the Towel 808 processor.
+  ==============================================================================
+*/
+
+#include "MySampler.h"
+#include "SamplePrefetcher.h"
+#include "PitchCache.h"
+#include "SampleKernels.h"
+
+//==============================================================================
+MySamplerSound::MySamplerSound (const juce::String& soundName,
+                                juce::AudioFormatReader& source,
+                                const juce::BigInteger& notes,
+                                int midiNoteForNormalPitch,
+                                double attackTimeSecs,
+                                double releaseTimeSecs,
+                                double maxSampleLengthSeconds)
+    : name(soundName),
+      midiNotes(notes),
+      midiRootNote(midiNoteForNormalPitch)
+{
+    if (maxSampleLengthSeconds > 0)
+        length = juce::roundToIntAccurate(source.sampleRate * maxSampleLengthSeconds);
+    else
+        length = (int)source.lengthInSamples;
+
+    data.reset(new juce::AudioBuffer<float>(juce::jmin(2, (int)source.numChannels), length + 4));
+
+    source.read(data.get(), 0, length + 4, 0, true, true);
+    trimData();
+
+    params.attack = attackTimeSecs;
+    params.release = releaseTimeSecs;
+
+    sourceSampleRate = source.sampleRate;
+}
+
+MySamplerSound::MySamplerSound (const juce::String& soundName,
+                                float* const* channelData,
+                                int numChannels,
+                                int numSamples,
+                                double sampleRate,
+                                const juce::BigInteger& notes,
+                                int midiNoteForNormalPitch,
+                                juce::ReferenceCountedObjectPtr<juce::ReferenceCountedObject> dataOwner)
+    : name(soundName),
+      owner(std::move(dataOwner)),
+      midiNotes(notes),
+      midiRootNote(midiNoteForNormalPitch),
+      sourceSampleRate(sampleRate),
+      length(numSamples)
+{
+    // The owner's memory stays as it is; the sound just stops short of the silence
+    loudness.measure(channelData, numChannels, numSamples);
+    data.reset(new juce::AudioBuffer<float>(channelData, numChannels, getTrimmedLength(numSamples)));
+}
+
+MySamplerSound::MySamplerSound (const juce::String& soundName,
+                                const juce::int16* const* channelData,
+                                int numChannels,
+                                int numSamples,
+                                float scale,
+                                double sampleRate,
+                                const juce::BigInteger& notes,
+                                int midiNoteForNormalPitch,
+                                juce::ReferenceCountedObjectPtr<juce::ReferenceCountedObject> dataOwner)
+    : name(soundName),
+      owner(std::move(dataOwner)),
+      midiNotes(notes),
+      midiRootNote(midiNoteForNormalPitch),
+      sourceSampleRate(sampleRate),
+      length(numSamples)
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+        compact.channels[ch] = channelData[ch];
+
+    loudness.measure(channelData, numChannels, numSamples, scale);
+
+    compact.numChannels = numChannels;
+    compact.numSamples = getTrimmedLength(numSamples);
+    compact.scale = scale;
+}
+
+MySamplerSound::MySamplerSound (const juce::String& soundName,
+                                std::unique_ptr<juce::AudioFormatReader> streamingSource,
+                                const juce::BigInteger& notes,
+                                int midiNoteForNormalPitch,
+                                double headLengthSeconds)
+    : name(soundName),
+      reader(std::move(streamingSource)),
+      midiNotes(notes),
+      midiRootNote(midiNoteForNormalPitch)
+{
+    length = (int)reader->lengthInSamples;
+    sourceSampleRate = reader->sampleRate;
+
+    auto headLength = juce::jmin(length, juce::roundToInt(sourceSampleRate * headLengthSeconds));
+
+    data.reset(new juce::AudioBuffer<float>(juce::jmin(2, (int)reader->numChannels), headLength + 4));
+
+    reader->read(data.get(), 0, headLength + 4, 0, true, true);
+}
+
+MySamplerSound::MySamplerSound (const MySamplerSound& original,
+                                juce::AudioBuffer<float>&& convertedData,
+                                double convertedSampleRate)
+    : name(original.name),
+      data(new juce::AudioBuffer<float>(std::move(convertedData))),
+      midiNotes(original.midiNotes),
+      midiRootNote(original.midiRootNote),
+      sourceSampleRate(convertedSampleRate),
+      normalisationGain(original.normalisationGain),
+      params(original.params),
+      length(data->getNumSamples())
+{
+    jassert (! original.isStreaming());
+
+    trimData();
+
+    if (original.isCompact())
+        makeCompact();
+}
+
+juce::int64 MySamplerSound::getTotalNumSamples() const noexcept
+{
+    return isStreaming() ? (juce::int64) length + 4 : getNumResidentSamples();
+}
+
+void MySamplerSound::measureStreamingLoudness (const juce::Array<float>& slicePeaks)
+{
+    jassert (isStreaming());
+
+    // Without an overview nothing is known about the rest of the file, and
+    // a map of the head alone would make it look silent
+    if (slicePeaks.isEmpty())
+        return;
+
+    loudness.measure (data->getArrayOfReadPointers(), data->getNumChannels(), juce::jmin (length, data->getNumSamples()));
+    loudness.extend (slicePeaks, length);
+}
+
+double MySamplerSound::getAudibleLengthSeconds() const noexcept
+{
+    // Resident data has already lost its silent end
+    juce::int64 numFrames = getNumResidentSamples();
+
+    if (isStreaming())
+        numFrames = loudness.isEmpty() ? (juce::int64) length
+                                       : loudness.getAudibleLength (loudness.getPeak() * LoudnessMap::silence);
+
+    return (double) numFrames / sourceSampleRate;
+}
+
+int MySamplerSound::getTrimmedLength (int numSamples) const noexcept
+{
+    // Relative to the sound's own peak, so a quiet sample isn't cut short.
+    // Normalisation never lifts a peak past -1 dBTP, so what goes stays
+    // below -96 dBFS however loud the sample is played.
+    auto numAudible = loudness.getAudibleLength (loudness.getPeak() * LoudnessMap::silence);
+    return (int) juce::jmin ((juce::int64) numSamples, numAudible + 4);
+}
+
+void MySamplerSound::trimData()
+{
+    loudness.measure (data->getArrayOfReadPointers(), data->getNumChannels(), data->getNumSamples());
+
+    auto numSamples = getTrimmedLength (data->getNumSamples());
+
+    // Reallocated, so the dropped tail no longer takes up memory
+    if (numSamples < data->getNumSamples())
+        data->setSize (data->getNumChannels(), numSamples, true, false, false);
+}
+
+void MySamplerSound::makeCompact()
+{
+    jassert (data != nullptr && owner == nullptr && ! isStreaming());
+
+    auto numSamples = data->getNumSamples();
+    auto layout = getCompactLayout (data->getArrayOfReadPointers(), data->getNumChannels(), numSamples);
+
+    compactStorage.malloc ((size_t) layout.numChannels * (size_t) numSamples);
+
+    for (int ch = 0; ch < layout.numChannels; ++ch)
+    {
+        auto* dest = compactStorage.get() + (size_t) ch * (size_t) numSamples;
+        SampleKernels::convertToInt16 (data->getReadPointer (ch), dest, layout.scale, numSamples);
+        compact.channels[ch] = dest;
+    }
+
+    compact.numChannels = layout.numChannels;
+    compact.numSamples = numSamples;
+    compact.scale = layout.scale;
+    data.reset();
+}
+
+int MySamplerSound::getNumResidentChannels() const noexcept
+{
+    return isCompact() ? compact.numChannels : data->getNumChannels();
+}
+
+int MySamplerSound::getNumResidentSamples() const noexcept
+{
+    return isCompact() ? compact.numSamples : data->getNumSamples();
+}
+
+size_t MySamplerSound::getResidentSizeInBytes() const noexcept
+{
+    auto sampleSize = isCompact() ? sizeof (juce::int16) : sizeof (float);
+    return (size_t) getNumResidentChannels() * (size_t) getNumResidentSamples() * sampleSize;
+}
+
+void MySamplerSound::readResidentFrames (int channel, int startFrame, int numFrames, float* dest) const noexcept
+{
+    jassert (channel < getNumResidentChannels() && startFrame + numFrames <= getNumResidentSamples());
+
+    if (isCompact())
+        SampleKernels::convertFromInt16 (compact.channels[channel] + startFrame, dest, compact.scale, numFrames);
+    else
+        juce::FloatVectorOperations::copy (dest, data->getReadPointer (channel) + startFrame, numFrames);
+}
+
+MySamplerSound::CompactLayout MySamplerSound::getCompactLayout (const float* const* channels, int numChannels,
+                                                                int numSamples) noexcept
+{
+    // A 16-bit file decodes to whole multiples of 1/32768 and fits back exactly
+    constexpr float sixteenBitStep = 1.0f / 32768.0f;
+    bool isSixteenBit = true;
+    float peak = 0.0f;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto range = juce::FloatVectorOperations::findMinAndMax (channels[ch], numSamples);
+        peak = juce::jmax (peak, -range.getStart(), range.getEnd());
+
+        for (int i = 0; i < numSamples && isSixteenBit; ++i)
+        {
+            auto steps = channels[ch][i] * 32768.0f;
+            isSixteenBit = steps == std::floor (steps);
+        }
+    }
+
+    CompactLayout layout;
+    layout.scale = (isSixteenBit && peak < 1.0f) || peak <= 0.0f ? sixteenBitStep : peak / 32767.0f;
+
+    // Dual-mono files are common among 808s; both sides read the one channel
+    layout.numChannels = numChannels > 1 && std::memcmp (channels[0], channels[1], (size_t) numSamples * sizeof (float)) == 0
+                           ? 1 : numChannels;
+    return layout;
+}
+
+bool MySamplerSound::appliesToNote (int midiNoteNumber)
+{
+    return midiNotes[midiNoteNumber];
+}
+
+bool MySamplerSound::appliesToChannel (int /*midiChannel*/)
+{
+    return true;
+}
+
+//==============================================================================
+VoiceLanes::VoiceLanes() noexcept
+{
+    std::fill (std::begin (soundingSlot), std::end (soundingSlot), -1);
+}
+
+void VoiceLanes::addSounding (int lane) noexcept
+{
+    if (soundingSlot[lane] >= 0)
+        return;
+
+    soundingSlot[lane] = numSounding;
+    sounding[numSounding++] = lane;
+}
+
+void VoiceLanes::removeSounding (int lane) noexcept
+{
+    // Several voices may be rendering at once; the list is only changed
+    // afterwards, on one thread, in the order a serial pass would have used
+    if (deferRemovals)
+    {
+        removalPending[lane] = true;
+        return;
+    }
+
+    auto slot = soundingSlot[lane];
+
+    if (slot < 0)
+        return;
+
+    auto last = sounding[--numSounding];
+    sounding[slot] = last;
+    soundingSlot[last] = slot;
+    soundingSlot[lane] = -1;
+}
+
+void VoiceLanes::applyDeferredRemovals() noexcept
+{
+    deferRemovals = false;
+
+    // A serial pass walks the list backwards and each voice can only remove
+    // itself, so removing in the same order leaves the list exactly as that
+    // pass would have
+    for (int i = numSounding; --i >= 0;)
+    {
+        auto lane = sounding[i];
+
+        if (removalPending[lane])
+        {
+            removalPending[lane] = false;
+            removeSounding (lane);
+        }
+    }
+}
+
+int VoiceLanes::getNumFramesBefore (int lane, juce::int64 limit, int maxSamples) const noexcept
+{
+    auto room = (double) (limit - 1) - position[lane];
+
+    if (room <= 0.0)
+        return 0;
+
+    return (int) juce::jmin ((double) maxSamples, std::ceil (room / increment[lane]));
+}
+
+//==============================================================================
+bool MySamplerVoice::canPlaySound (juce::SynthesiserSound* sound)
+{
+    return dynamic_cast<MySamplerSound*> (sound) != nullptr;
+}
+
+void MySamplerVoice::startNote (int midiNoteNumber, float velocity,
+                                juce::SynthesiserSound* sound, int currentPitchWheelPosition)
+{
+    if (auto* samplerSound = dynamic_cast<MySamplerSound*> (sound))
+    {
+        noteIncrement = std::pow (2.0, (midiNoteNumber - samplerSound->getMidiRootNote()) / 12.0)
+                                   * (samplerSound->getSourceSampleRate() / getSampleRate());
+
+        if (normalising.load (std::memory_order_relaxed))
+            velocity *= samplerSound->getNormalisationGain();
+
+        lanes.position[lane] = 0.0;
+        lanes.gainL[lane] = velocity;
+        lanes.gainR[lane] = velocity;
+
+        adsr.noteOn();
+        chokeSamplesRemaining = -1;
+        lastEnvelopeValue = 1.0f;
+
+        // Keep a reference to the audio data
+        soundData = samplerSound->getAudioData();
+        compactData = samplerSound->isCompact() ? &samplerSound->getCompactData() : nullptr;
+        numSourceSamples = samplerSound->getTotalNumSamples();
+        loudness = &samplerSound->getLoudnessMap();
+        loudnessFrameScale = 1.0;
+
+        // The ring picks up a kernel's width before the end of the head, so
+        // every tier finds all the frames it reads around a position in one place
+        isStreaming = samplerSound->isStreaming()
+                        && prefetcher != nullptr
+                        && prefetcher->startStream (lane, samplerSound,
+                                                    juce::jmax (0, soundData->getNumSamples() - SampleKernels::maxKernelSpan));
+
+        // A pre-pitched copy, when the cache has one ready, plays back frame
+        // for frame instead of being resampled
+        releaseCachedEntry();
+
+        if (pitchCache != nullptr)
+            cachedEntry = pitchCache->acquire (samplerSound, midiNoteNumber, getSampleRate());
+
+        if (cachedEntry != nullptr)
+        {
+            soundData = &cachedEntry->data;
+            compactData = nullptr;
+            numSourceSamples = soundData->getNumSamples();
+            loudnessFrameScale = noteIncrement;
+            noteIncrement = 1.0;
+        }
+
+        // Bend and glide scale whichever increment the note plays at, so a
+        // pre-pitched copy bends just like the original
+        targetNote = midiNoteNumber;
+        pitchWheelPosition = currentPitchWheelPosition;
+        bendRatio = std::exp2 ((pitchWheelPosition - 8192) / 8192.0 * lanes.bendRangeSemitones / 12.0);
+        glideRatio = glideTarget = 1.0;
+        glideSamplesRemaining = 0;
+
+        auto previousNote = lanes.lastNote;
+        lanes.lastNote = midiNoteNumber;
+
+        if (lanes.glideSeconds > 0.0 && previousNote >= 0 && previousNote != midiNoteNumber)
+        {
+            glideRatio = std::exp2 ((previousNote - midiNoteNumber) / 12.0);
+            startGlide (1.0);
+        }
+        else
+        {
+            updateIncrement();
+        }
+
+        // Anything played from a ring or from compact data goes through
+        // renderNextBlock instead
+        lanes.resident[lane] = soundData != nullptr && ! samplerSound->isStreaming();
+
+        if (soundData != nullptr)
+        {
+            lanes.sourceL[lane] = soundData->getReadPointer (0);
+            lanes.sourceR[lane] = soundData->getReadPointer (soundData->getNumChannels() > 1 ? 1 : 0);
+            lanes.numFrames[lane] = soundData->getNumSamples();
+        }
+        lanes.addSounding (lane);
+    }
+    else
+    {
+        jassertfalse; // This object can only play MySamplerSounds!
+    }
+}
+
+void MySamplerVoice::stopNote (float /*velocity*/, bool allowTailOff)
+{
+    if (allowTailOff)
+    {
+        adsr.noteOff();
+    }
+    else
+    {
+        adsr.reset();
+        endNote();
+    }
+}
+
+void MySamplerVoice::endNote()
+{
+    if (isStreaming)
+        prefetcher->stopStream (lane);
+
+    isStreaming = false;
+    releaseCachedEntry();
+    lanes.resident[lane] = false;
+    lanes.removeSounding (lane);
+    clearCurrentNote();
+    soundData = nullptr; // Invalidate the soundData pointer
+    compactData = nullptr;
+    loudness = nullptr;
+}
+
+void MySamplerVoice::pitchWheelMoved (int newValue)
+{
+    pitchWheelPosition = newValue;
+    updatePitchBend();
+}
+
+void MySamplerVoice::updatePitchBend() noexcept
+{
+    // One exp2 per wheel message; the wheel's 14 bits span twice the range
+    bendRatio = std::exp2 ((pitchWheelPosition - 8192) / 8192.0 * lanes.bendRangeSemitones / 12.0);
+    updateIncrement();
+}
+
+void MySamplerVoice::glideToNote (int midiNoteNumber) noexcept
+{
+    // Ratios are relative to the note the voice was started with, which is
+    // the one its increment and any pre-pitched copy were made for
+    targetNote = midiNoteNumber;
+    lanes.lastNote = midiNoteNumber;
+    startGlide (std::exp2 ((midiNoteNumber - getCurrentlyPlayingNote()) / 12.0));
+}
+
+void MySamplerVoice::startGlide (double targetRatio) noexcept
+{
+    // The per-sample step is worked out once here; a glide that changes
+    // direction half way starts again from wherever the pitch has got to
+    glideTarget = targetRatio;
+    glideSamplesRemaining = juce::roundToInt (lanes.glideSeconds * getSampleRate());
+
+    if (glideSamplesRemaining > 0)
+        glideStep = std::pow (glideTarget / glideRatio, 1.0 / glideSamplesRemaining);
+    else
+        glideRatio = glideTarget;
+
+    updateIncrement();
+}
+
+void MySamplerVoice::stepGlide (int numSamples) noexcept
+{
+    auto numSteps = juce::jmin (numSamples, glideSamplesRemaining);
+
+    for (int i = 0; i < numSteps; ++i)
+        glideRatio *= glideStep;
+
+    glideSamplesRemaining -= numSteps;
+
+    // Land exactly on the target, whatever rounding the steps picked up
+    if (glideSamplesRemaining == 0)
+        glideRatio = glideTarget;
+
+    updateIncrement();
+}
+
+void MySamplerVoice::updateIncrement() noexcept
+{
+    lanes.increment[lane] = noteIncrement * glideRatio * bendRatio;
+}
+
+void MySamplerVoice::choke() noexcept
+{
+    if (chokeSamplesRemaining >= 0)
+        return;
+
+    chokeLength = juce::jmax (1, juce::roundToInt (getSampleRate() * chokeFadeSeconds));
+    chokeSamplesRemaining = chokeLength - 1;
+}
+
+float MySamplerVoice::getCurrentLevel() const noexcept
+{
+    return lastEnvelopeValue * juce::jmax (lanes.gainL[lane], lanes.gainR[lane]);
+}
+
+bool MySamplerVoice::isSilentFromHere() const noexcept
+{
+    if (loudness == nullptr)
+        return false;
+
+    auto frame = (juce::int64) (lanes.position[lane] * loudnessFrameScale);
+    auto level = adsr.getHighestLevelToCome() * juce::jmax (lanes.gainL[lane], lanes.gainR[lane]);
+
+    return level * loudness->getPeakFrom (frame) < LoudnessMap::silence;
+}
+
+void MySamplerVoice::releaseCachedEntry() noexcept
+{
+    if (cachedEntry != nullptr)
+        pitchCache->release (cachedEntry);
+
+    cachedEntry = nullptr;
+}
+
+int MySamplerVoice::fillEnvelope (float* dest, int stride, int numSamples) noexcept
+{
+    // The voice ends at its first silent sample
+    auto numAudibleSamples = adsr.process (dest, stride, numSamples);
+
+    // A choked voice fades out linearly over a fixed number of samples, and
+    // ends where the fade reaches zero
+    if (chokeSamplesRemaining >= 0)
+    {
+        auto numFading = juce::jmin (numAudibleSamples, chokeSamplesRemaining);
+        auto fadeStep = 1.0f / (float) chokeLength;
+
+        for (int i = 0; i < numFading; ++i)
+            dest[i * stride] *= (float) (chokeSamplesRemaining - i) * fadeStep;
+
+        for (int i = numFading; i < numAudibleSamples; ++i)
+            dest[i * stride] = 0.0f;
+
+        chokeSamplesRemaining -= numFading;
+        numAudibleSamples = numFading;
+    }
+
+    lastEnvelopeValue = numSamples > 0 ? dest[(numSamples - 1) * stride] : lastEnvelopeValue;
+    return numAudibleSamples;
+}
+
+void MySamplerVoice::renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    auto& sourceSamplePosition = lanes.position[lane];
+    auto numTrailing = SampleKernels::getTrailingFrames (quality);
+
+    while (numSamples > 0 && (soundData != nullptr || compactData != nullptr))
+    {
+        // A glide or bend changes the pitch between chunks
+        auto pitchRatio = lanes.increment[lane];
+
+        // Chunks never straddle the end of a streaming sound's resident head,
+        // so each one reads from a single place
+        auto numHeadSamples = getNumHeadSamples();
+        bool hasRing = numSourceSamples > numHeadSamples;
+        bool fromHead = ! hasRing || (juce::int64) sourceSamplePosition + numTrailing < numHeadSamples;
+
+        auto limit = ! fromHead ? numSourceSamples
+                                : (hasRing ? numHeadSamples - numTrailing + 1 : numHeadSamples);
+
+        auto numThisTime = juce::jmin (numSamples, lanes.getNumFramesBefore (lane, limit, kernelBlockSize));
+
+        // Keep the frames a chunk reads within the scratch span
+        if (! fromHead || quality != SampleKernels::linear || compactData != nullptr)
+            numThisTime = juce::jmin (numThisTime, juce::jmax (1, (int) ((spanCapacity - 2 * SampleKernels::maxKernelSpan) / pitchRatio)));
+
+        if (numThisTime <= 0 || isSilentFromHere())
+        {
+            // Stop the note once we've run out of source samples, or once
+            // the rest of them can't be heard
+            stopNote (0.0f, false);
+            break;
+        }
+
+        // A sustaining note holds one level for the whole chunk, which goes
+        // into the gain instead of a multiply per sample
+        auto envelopeGain = isChoking() ? 0.0f : adsr.getConstantLevel();
+        bool isHeld = envelopeGain > 0.0f;
+        auto numAudible = isHeld ? numThisTime : fillEnvelope (envelope, 1, numThisTime);
+
+        if (isHeld)
+            lastEnvelopeValue = envelopeGain;
+        else
+            envelopeGain = 1.0f;
+
+        if (numAudible > 0)
+        {
+            renderSource (numAudible, fromHead);
+
+            if (! isHeld)
+            {
+                juce::FloatVectorOperations::multiply (left, envelope, numAudible);
+                juce::FloatVectorOperations::multiply (right, envelope, numAudible);
+            }
+
+            // Scale and add as two separate steps rather than a multiply-add,
+            // which a compiler may fuse: the voice threads rely on the sum
+            // rounding the same way whether it lands in the output or in scratch
+            juce::FloatVectorOperations::multiply (left, lanes.gainL[lane] * envelopeGain, numAudible);
+            juce::FloatVectorOperations::add (outputBuffer.getWritePointer (0, startSample), left, numAudible);
+
+            if (outputBuffer.getNumChannels() > 1)
+            {
+                juce::FloatVectorOperations::multiply (right, lanes.gainR[lane] * envelopeGain, numAudible);
+                juce::FloatVectorOperations::add (outputBuffer.getWritePointer (1, startSample), right, numAudible);
+            }
+
+            sourceSamplePosition += numAudible * pitchRatio;
+            advancePitch (numAudible);
+            startSample += numAudible;
+            numSamples -= numAudible;
+        }
+
+        if (numAudible < numThisTime)
+        {
+            endNote();
+            break;
+        }
+    }
+
+    // Hand back the ring space for frames every tier has moved past
+    if (isStreaming)
+        prefetcher->discardBefore (lane, (juce::int64) sourceSamplePosition - SampleKernels::maxLeadingFrames);
+}
+
+void MySamplerVoice::renderSource (int numSamples, bool fromHead) noexcept
+{
+    auto position = lanes.position[lane];
+    auto increment = lanes.increment[lane];
+    auto base = (juce::int64) position;
+    SampleKernels::computePositions (position - (double) base, increment, indices, fractions, numSamples);
+
+    const float* sourceL;
+    const float* sourceR;
+
+    if (fromHead && increment == 1.0 && position == (double) base)
+    {
+        // Pre-pitched data, or converted data played at its root note, lines
+        // up with the output, so it is simply copied
+        copyHeadSpan (0, base, numSamples, left);
+
+        if (getNumHeadChannels() > 1)
+            copyHeadSpan (1, base, numSamples, right);
+        else
+            juce::FloatVectorOperations::copy (right, left, numSamples);
+
+        return;
+    }
+
+    if (fromHead && quality == SampleKernels::linear && compactData == nullptr)
+    {
+        // Linear never reads before its position, so it works in place
+        sourceL = soundData->getReadPointer (0) + base;
+        sourceR = soundData->getNumChannels() > 1 ? soundData->getReadPointer (1) + base : nullptr;
+    }
+    else
+    {
+        // The wider kernels read frames either side of each position, so the
+        // span they cover is copied out with its edges filled in
+        auto numLeading = SampleKernels::getLeadingFrames (quality);
+        auto firstFrame = base - numLeading;
+        auto spanLength = indices[numSamples - 1] + numLeading + SampleKernels::getTrailingFrames (quality) + 1;
+
+        sourceL = spanL + numLeading;
+        sourceR = spanR + numLeading;
+
+        if (fromHead)
+        {
+            copyHeadSpan (0, firstFrame, spanLength, spanL);
+
+            if (getNumHeadChannels() > 1)
+                copyHeadSpan (1, firstFrame, spanLength, spanR);
+            else
+                sourceR = nullptr;
+        }
+        else if (! (isStreaming && prefetcher->readFrames (lane, firstFrame, spanLength, spanL, spanR)))
+        {
+            // If the prefetcher has fallen behind, this chunk stays silent
+            juce::FloatVectorOperations::clear (left, numSamples);
+            juce::FloatVectorOperations::clear (right, numSamples);
+            return;
+        }
+    }
+
+    SampleKernels::interpolate (quality, sourceL, indices, fractions, left, numSamples, increment);
+
+    if (sourceR != nullptr)
+        SampleKernels::interpolate (quality, sourceR, indices, fractions, right, numSamples, increment);
+    else
+        juce::FloatVectorOperations::copy (right, left, numSamples);
+}
+
+void MySamplerVoice::copyHeadSpan (int channel, juce::int64 firstFrame, int numFrames, float* dest) const noexcept
+{
+    // Frames before the start or past the end of the data read as silence
+    auto numAvailable = (juce::int64) getNumHeadSamples();
+    auto validStart = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numFrames, -firstFrame);
+    auto validEnd = (int) juce::jlimit ((juce::int64) validStart, (juce::int64) numFrames, numAvailable - firstFrame);
+
+    juce::FloatVectorOperations::clear (dest, validStart);
+
+    // Compact data is widened to float on the way
+    if (compactData != nullptr)
+        SampleKernels::convertFromInt16 (compactData->channels[channel] + firstFrame + validStart, dest + validStart,
+                                         compactData->scale, validEnd - validStart);
+    else
+        juce::FloatVectorOperations::copy (dest + validStart, soundData->getReadPointer (channel) + firstFrame + validStart, validEnd - validStart);
+    juce::FloatVectorOperations::clear (dest + validEnd, numFrames - validEnd);
+}
+
+//==============================================================================
+MySynthesiser::MySynthesiser()
+{
+    // Reserve the slot up front so swapping sounds never reallocates
+    sounds.ensureStorageAllocated (1);
+
+    // Handle every MIDI event at its own sample rather than rounding it to
+    // the default 32-sample sub-block, so chokes start exactly with the note
+    setMinimumRenderingSubdivisionSize (1, true);
+}
+
+void MySynthesiser::setCurrentSound (const MySamplerSound::Ptr& newSound)
+{
+    // clearQuick() keeps the array's storage, so this doesn't touch the heap.
+    // Whoever handed us the sound still holds a reference to the old one, so
+    // the last release never happens here on the audio thread.
+    sounds.clearQuick();
+
+    if (newSound != nullptr)
+        sounds.add (newSound.get());
+}
+
+MySamplerVoice* MySynthesiser::getVoiceForLane (int lane) const noexcept
+{
+    return static_cast<MySamplerVoice*> (voices.getUnchecked (lane));
+}
+
+void MySynthesiser::setADSRParameters (const juce::ADSR::Parameters& params) noexcept
+{
+    if (adsrParametersSet
+         && params.attack == adsrParameters.attack
+         && params.decay == adsrParameters.decay
+         && params.sustain == adsrParameters.sustain
+         && params.release == adsrParameters.release)
+        return;
+
+    adsrParameters = params;
+    adsrParametersSet = true;
+
+    // Every voice here is a MySamplerVoice (see getVoiceForLane)
+    for (int i = 0; i < voices.size(); ++i)
+        getVoiceForLane (i)->setADSRParameters (params);
+}
+
+void MySynthesiser::setEnvelopeCurve (BlockEnvelope::Curve newCurve) noexcept
+{
+    if (newCurve == envelopeCurve)
+        return;
+
+    envelopeCurve = newCurve;
+
+    for (int i = 0; i < voices.size(); ++i)
+        getVoiceForLane (i)->setEnvelopeCurve (newCurve);
+}
+
+void MySynthesiser::setChokeGroup (int midiNoteNumber, int group) noexcept
+{
+    if (juce::isPositiveAndBelow (midiNoteNumber, 128))
+        chokeGroups[midiNoteNumber] = group;
+}
+
+void MySynthesiser::noteOn (int midiChannel, int midiNoteNumber, float velocity)
+{
+    if (legatoEnabled && juce::isPositiveAndBelow (midiNoteNumber, 128))
+    {
+        removeHeldNote (midiNoteNumber);
+        heldNotes[numHeldNotes++] = midiNoteNumber;
+
+        // A key played while another is held slides the sounding voice
+        // instead of starting a new one
+        if (auto* voice = findLegatoVoice())
+        {
+            voice->glideToNote (midiNoteNumber);
+            return;
+        }
+    }
+
+    // This runs at the note's own sample position within the block, so the
+    // fade on the choked voices starts exactly where the new note does.
+    // Only sounding voices are visited.
+    if (juce::isPositiveAndBelow (midiNoteNumber, 128))
+    {
+        if (auto group = chokeGroups[midiNoteNumber])
+        {
+            for (int i = lanes.numSounding; --i >= 0;)
+            {
+                auto* voice = getVoiceForLane (lanes.sounding[i]);
+                auto playingNote = voice->getCurrentlyPlayingNote();
+
+                if (juce::isPositiveAndBelow (playingNote, 128) && chokeGroups[playingNote] == group)
+                    voice->choke();
+            }
+        }
+    }
+
+    juce::Synthesiser::noteOn (midiChannel, midiNoteNumber, velocity);
+}
+
+void MySynthesiser::noteOff (int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff)
+{
+    if (legatoEnabled && juce::isPositiveAndBelow (midiNoteNumber, 128))
+    {
+        removeHeldNote (midiNoteNumber);
+
+        if (auto* voice = findLegatoVoice())
+        {
+            // A key that isn't sounding was only being held underneath
+            if (voice->getTargetNote() != midiNoteNumber)
+                return;
+
+            if (numHeldNotes > 0)
+            {
+                voice->glideToNote (heldNotes[numHeldNotes - 1]);
+                return;
+            }
+
+            // The last key is up, so the voice is released under the note
+            // it was started with
+            midiNoteNumber = voice->getCurrentlyPlayingNote();
+        }
+    }
+
+    juce::Synthesiser::noteOff (midiChannel, midiNoteNumber, velocity, allowTailOff);
+}
+
+void MySynthesiser::allNotesOff (int midiChannel, bool allowTailOff)
+{
+    numHeldNotes = 0;
+    juce::Synthesiser::allNotesOff (midiChannel, allowTailOff);
+}
+
+void MySynthesiser::setPitchModulation (double bendRangeSemitones, double glideSeconds) noexcept
+{
+    lanes.glideSeconds = juce::jmax (0.0, glideSeconds);
+
+    if (bendRangeSemitones == lanes.bendRangeSemitones)
+        return;
+
+    lanes.bendRangeSemitones = bendRangeSemitones;
+
+    for (int i = 0; i < lanes.numSounding; ++i)
+        getVoiceForLane (lanes.sounding[i])->updatePitchBend();
+}
+
+void MySynthesiser::setLegatoEnabled (bool shouldBeEnabled) noexcept
+{
+    if (shouldBeEnabled != legatoEnabled)
+        numHeldNotes = 0;
+
+    legatoEnabled = shouldBeEnabled;
+}
+
+MySamplerVoice* MySynthesiser::findLegatoVoice() const noexcept
+{
+    // The voice whose key is still down; a choked one is on its way out
+    for (int i = 0; i < lanes.numSounding; ++i)
+    {
+        auto* voice = getVoiceForLane (lanes.sounding[i]);
+
+        if (voice->isKeyDown() && ! voice->isChoking())
+            return voice;
+    }
+
+    return nullptr;
+}
+
+void MySynthesiser::removeHeldNote (int midiNoteNumber) noexcept
+{
+    for (int i = 0; i < numHeldNotes; ++i)
+    {
+        if (heldNotes[i] == midiNoteNumber)
+        {
+            std::copy (heldNotes + i + 1, heldNotes + numHeldNotes, heldNotes + i);
+            --numHeldNotes;
+            return;
+        }
+    }
+}
+
+void MySynthesiser::chokeQuietestVoices (int numToChoke) noexcept
+{
+    for (int n = 0; n < numToChoke; ++n)
+    {
+        MySamplerVoice* quietest = nullptr;
+
+        for (int i = 0; i < lanes.numSounding; ++i)
+        {
+            auto* voice = getVoiceForLane (lanes.sounding[i]);
+
+            if (! voice->isChoking() && (quietest == nullptr || voice->getCurrentLevel() < quietest->getCurrentLevel()))
+                quietest = voice;
+        }
+
+        if (quietest == nullptr)
+            return;
+
+        quietest->choke();
+    }
+}
+
+juce::SynthesiserVoice* MySynthesiser::findFreeVoice (juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                                      int midiNoteNumber, bool stealIfNoneAvailable) const
+{
+    // A repeated note takes over the voice already playing it even below the
+    // limit, so a fast roll can't pile up one releasing tail per hit
+    if (stealIfNoneAvailable && stealPolicy.load() == stealSameNote)
+        if (auto* voice = findVoicePlayingNote (midiNoteNumber))
+            return voice;
+
+    // Below the polyphony limit any idle voice will do
+    if (lanes.numSounding < juce::jmin (polyphonyLimit.load(), voices.size()))
+        for (auto* voice : voices)
+            if (! voice->isVoiceActive() && voice->canPlaySound (soundToPlay))
+                return voice;
+
+    if (stealIfNoneAvailable)
+        return findVoiceToSteal (soundToPlay, midiChannel, midiNoteNumber);
+
+    return nullptr;
+}
+
+juce::SynthesiserVoice* MySynthesiser::findVoiceToSteal (juce::SynthesiserSound* /*soundToPlay*/, int /*midiChannel*/,
+                                                         int midiNoteNumber) const
+{
+    // Only sounding voices are candidates, so this is O(active voices)
+    MySamplerVoice* oldest = nullptr;
+    MySamplerVoice* oldestReleased = nullptr;
+    MySamplerVoice* quietest = nullptr;
+    auto policy = stealPolicy.load();
+
+    if (policy == stealSameNote)
+        if (auto* voice = findVoicePlayingNote (midiNoteNumber))
+            return voice;
+
+    for (int i = 0; i < lanes.numSounding; ++i)
+    {
+        auto* voice = getVoiceForLane (lanes.sounding[i]);
+
+        if (oldest == nullptr || voice->wasStartedBefore (*oldest))
+            oldest = voice;
+
+        if (! voice->isKeyDown() && (oldestReleased == nullptr || voice->wasStartedBefore (*oldestReleased)))
+            oldestReleased = voice;
+
+        if (quietest == nullptr || voice->getCurrentLevel() < quietest->getCurrentLevel())
+            quietest = voice;
+    }
+
+    if (policy == stealQuietest && quietest != nullptr)
+        return quietest;
+
+    // Tails of released notes go before notes that are still held
+    return oldestReleased != nullptr ? oldestReleased : oldest;
+}
+
+MySamplerVoice* MySynthesiser::findVoicePlayingNote (int midiNoteNumber) const noexcept
+{
+    for (int i = 0; i < lanes.numSounding; ++i)
+    {
+        auto* voice = getVoiceForLane (lanes.sounding[i]);
+
+        if (voice->getCurrentlyPlayingNote() == midiNoteNumber)
+            return voice;
+    }
+
+    return nullptr;
+}
+
+void MySynthesiser::setQuality (SampleKernels::Quality newQuality) noexcept
+{
+    if (newQuality == quality)
+        return;
+
+    quality = newQuality;
+
+    for (int i = 0; i < voices.size(); ++i)
+        getVoiceForLane (i)->setQuality (newQuality);
+}
+
+void MySynthesiser::setNormalisingEnabled (bool shouldBeEnabled) noexcept
+{
+    for (int i = 0; i < voices.size(); ++i)
+        getVoiceForLane (i)->setNormalising (shouldBeEnabled);
+}
+
+void MySynthesiser::renderVoices (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    // Only sounding voices are visited. Walking the list backwards means a
+    // voice that ends while rendering can't cause another to be skipped.
+    // With the lane engine on, only streaming voices render one at a time
+    // here, because they read through their prefetcher ring. The lanes only
+    // interpolate linearly, so the other tiers always use the voices.
+    auto useLanes = quality == SampleKernels::linear
+                     && laneRenderingEnabled.load (std::memory_order_relaxed);
+
+    if (! useLanes && renderVoicesOnThreads (buffer, startSample, numSamples))
+        return;
+
+    for (int i = lanes.numSounding; --i >= 0;)
+    {
+        auto lane = lanes.sounding[i];
+
+        if (! (useLanes && lanes.resident[lane]))
+            getVoiceForLane (lane)->renderNextBlock (buffer, startSample, numSamples);
+    }
+
+    if (useLanes)
+        renderLanes (buffer, startSample, numSamples);
+}
+
+bool MySynthesiser::renderVoicesOnThreads (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    auto* pool = activeVoiceThreads.load (std::memory_order_acquire);
+
+    if (pool == nullptr
+         || lanes.numSounding < minThreadedVoices
+         || lanes.numSounding * numSamples < minThreadedVoiceSamples
+         || numSamples > voiceScratch.getNumSamples())
+        return false;
+
+    // Item k is the k-th voice a serial pass would render
+    numThreadedLanes = lanes.numSounding;
+
+    for (int k = 0; k < numThreadedLanes; ++k)
+        threadedLanes[k] = lanes.sounding[numThreadedLanes - 1 - k];
+
+    threadedNumSamples = numSamples;
+
+    lanes.deferRemovals = true;
+
+    if (! pool->tryRun (renderVoiceToScratch, this, numThreadedLanes))
+    {
+        // Another instance's block has the pool, so this one renders serially
+        lanes.deferRemovals = false;
+        return false;
+    }
+
+    lanes.applyDeferredRemovals();
+
+    // Summing in the serial order gives the same bits as the serial pass:
+    // each scratch buffer holds exactly what that voice would have added
+    for (int k = 0; k < numThreadedLanes; ++k)
+    {
+        auto& scratch = scratchViews[threadedLanes[k]];
+
+        for (int ch = 0; ch < juce::jmin (2, buffer.getNumChannels()); ++ch)
+            juce::FloatVectorOperations::add (buffer.getWritePointer (ch, startSample), scratch.getReadPointer (ch), numSamples);
+    }
+
+    return true;
+}
+
+void MySynthesiser::renderVoiceToScratch (void* context, int index)
+{
+    auto& synth = *static_cast<MySynthesiser*> (context);
+    auto lane = synth.threadedLanes[index];
+    auto& scratch = synth.scratchViews[lane];
+
+    // -0 is the one starting value that x + start == x holds for exactly,
+    // signed zeros included
+    for (int ch = 0; ch < 2; ++ch)
+        juce::FloatVectorOperations::fill (scratch.getWritePointer (ch), -0.0f, synth.threadedNumSamples);
+
+    synth.getVoiceForLane (lane)->renderNextBlock (scratch, 0, synth.threadedNumSamples);
+}
+
+void MySynthesiser::setVoiceThreadingEnabled (bool shouldBeEnabled)
+{
+    // The reference is taken once and then kept, so the audio thread can
+    // never be inside a pool that is being destroyed. Switched off, the
+    // workers just stay asleep.
+    if (shouldBeEnabled && voiceThreads == nullptr)
+        voiceThreads = std::make_unique<juce::SharedResourcePointer<VoiceThreadPool>>();
+
+    activeVoiceThreads.store (shouldBeEnabled ? &voiceThreads->get() : nullptr, std::memory_order_release);
+}
+
+void MySynthesiser::setMaximumBlockSize (int maxBlockSize)
+{
+    voiceScratch.setSize (2 * VoiceLanes::maxLanes, juce::jmax (1, maxBlockSize));
+
+    for (int lane = 0; lane < VoiceLanes::maxLanes; ++lane)
+        scratchViews[lane].setDataToReferTo (voiceScratch.getArrayOfWritePointers() + 2 * lane, 2, voiceScratch.getNumSamples());
+}
+
+void MySynthesiser::renderLanes (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    static const float silence[2] = {};
+
+    while (numSamples > 0)
+    {
+        // Gather the active lanes. The chunk ends where the first of them
+        // runs out of source, so no lane ever reads past its data.
+        auto numThisTime = juce::jmin (numSamples, laneBlockSize);
+        int numActive = 0;
+
+        for (int i = lanes.numSounding; --i >= 0;)
+        {
+            auto lane = lanes.sounding[i];
+
+            if (! lanes.resident[lane])
+                continue;
+
+            auto numFrames = lanes.getNumFramesBefore (lane, lanes.numFrames[lane], laneBlockSize);
+
+            if (numFrames <= 0 || getVoiceForLane (lane)->isSilentFromHere())
+            {
+                getVoiceForLane (lane)->stopNote (0.0f, false);
+                continue;
+            }
+
+            numThisTime = juce::jmin (numThisTime, numFrames);
+            activeLanes[numActive++] = lane;
+        }
+
+        if (numActive == 0)
+            return;
+
+        auto numGroups = (numActive + SampleKernels::lanesPerGroup - 1) / SampleKernels::lanesPerGroup;
+        auto stride = numGroups * SampleKernels::lanesPerGroup;
+
+        for (int k = 0; k < numActive; ++k)
+            numAudible[k] = getVoiceForLane (activeLanes[k])->fillEnvelope (laneEnvelopes + k, stride, numThisTime);
+
+        for (int k = numActive; k < stride; ++k)
+            for (int i = 0; i < numThisTime; ++i)
+                laneEnvelopes[i * stride + k] = 0.0f;
+
+        juce::FloatVectorOperations::clear (accumulatorL, numThisTime * SampleKernels::lanesPerGroup);
+        juce::FloatVectorOperations::clear (accumulatorR, numThisTime * SampleKernels::lanesPerGroup);
+
+        for (int g = 0; g < numGroups; ++g)
+        {
+            SampleKernels::LaneGroup group;
+
+            for (int j = 0; j < SampleKernels::lanesPerGroup; ++j)
+            {
+                auto k = g * SampleKernels::lanesPerGroup + j;
+
+                if (k < numActive)
+                {
+                    auto lane = activeLanes[k];
+                    auto base = (juce::int64) lanes.position[lane];
+
+                    group.sourceL[j]   = lanes.sourceL[lane] + base;
+                    group.sourceR[j]   = lanes.sourceR[lane] + base;
+                    group.fraction[j]  = (float) (lanes.position[lane] - (double) base);
+                    group.increment[j] = (float) lanes.increment[lane];
+                    group.gainL[j]     = lanes.gainL[lane];
+                    group.gainR[j]     = lanes.gainR[lane];
+                }
+                else
+                {
+                    group.sourceL[j] = group.sourceR[j] = silence;
+                    group.fraction[j] = group.increment[j] = group.gainL[j] = group.gainR[j] = 0.0f;
+                }
+            }
+
+            SampleKernels::renderLaneGroup (group, laneEnvelopes + g * SampleKernels::lanesPerGroup, stride,
+                                            accumulatorL, accumulatorR, numThisTime);
+        }
+
+        SampleKernels::sumLanes (accumulatorL, buffer.getWritePointer (0, startSample), numThisTime);
+
+        if (buffer.getNumChannels() > 1)
+            SampleKernels::sumLanes (accumulatorR, buffer.getWritePointer (1, startSample), numThisTime);
+
+        for (int k = 0; k < numActive; ++k)
+        {
+            auto lane = activeLanes[k];
+            lanes.position[lane] += numThisTime * lanes.increment[lane];
+            getVoiceForLane (lane)->advancePitch (numThisTime);
+
+            if (numAudible[k] < numThisTime)
+                getVoiceForLane (lane)->stopNote (0.0f, false);
+        }
+
+        startSample += numThisTime;
+        numSamples -= numThisTime;
+    }
+}
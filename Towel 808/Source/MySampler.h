@@ -0,0 +1,517 @@
+/*
+  ==============================================================================
+    Sampler sound, voice and synthesiser classes used by the Towel 808 processor.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleKernels.h"
+#include "BlockEnvelope.h"
+#include "LoudnessMap.h"
+#include "VoiceThreadPool.h"
+
+class SamplePrefetcher;
+class PitchCache;
+class PitchCacheEntry;
+
+//==============================================================================
+// Custom SamplerSound class to hold sample data and parameters
+class MySamplerSound : public juce::SynthesiserSound
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<MySamplerSound>;
+
+    MySamplerSound (const juce::String& soundName,
+                    juce::AudioFormatReader& source,
+                    const juce::BigInteger& notes,
+                    int midiNoteForNormalPitch,
+                    double attackTimeSecs,
+                    double releaseTimeSecs,
+                    double maxSampleLengthSeconds);
+
+    // Wraps sample data that lives elsewhere (e.g. in a SampleBank arena).
+    // The owner is kept alive for as long as this sound exists.
+    MySamplerSound (const juce::String& soundName,
+                    float* const* channelData,
+                    int numChannels,
+                    int numSamples,
+                    double sampleRate,
+                    const juce::BigInteger& notes,
+                    int midiNoteForNormalPitch,
+                    juce::ReferenceCountedObjectPtr<juce::ReferenceCountedObject> dataOwner);
+
+    // Wraps compact 16-bit data that lives elsewhere (e.g. in a SampleBank
+    // arena), as laid out by getCompactLayout
+    MySamplerSound (const juce::String& soundName,
+                    const juce::int16* const* channelData,
+                    int numChannels,
+                    int numSamples,
+                    float scale,
+                    double sampleRate,
+                    const juce::BigInteger& notes,
+                    int midiNoteForNormalPitch,
+                    juce::ReferenceCountedObjectPtr<juce::ReferenceCountedObject> dataOwner);
+
+    // Keeps only the first headLengthSeconds of the file resident. The rest is
+    // read from the reader by the SamplePrefetcher while voices play the head.
+    MySamplerSound (const juce::String& soundName,
+                    std::unique_ptr<juce::AudioFormatReader> streamingSource,
+                    const juce::BigInteger& notes,
+                    int midiNoteForNormalPitch,
+                    double headLengthSeconds);
+
+    // The same sound with its audio replaced by a copy converted to another
+    // sample rate. The original must be resident; if it is compact, so is the copy.
+    MySamplerSound (const MySamplerSound& original,
+                    juce::AudioBuffer<float>&& convertedData,
+                    double convertedSampleRate);
+
+    bool appliesToNote (int midiNoteNumber) override;
+    bool appliesToChannel (int midiChannel) override;
+
+    // Resident float data, or nullptr if the sound is compact
+    juce::AudioBuffer<float>* getAudioData() const noexcept        { return data.get(); }
+    const juce::ADSR::Parameters& getADSRParameters() const noexcept { return params; }
+    int getMidiRootNote() const noexcept                          { return midiRootNote; }
+    double getSourceSampleRate() const noexcept                   { return sourceSampleRate; }
+    const juce::String& getName() const noexcept                  { return name; }
+
+    // Gain that brings the sample to the library's target loudness. Set it
+    // before the sound is handed to the audio thread.
+    void setNormalisationGain (float newGain) noexcept             { normalisationGain = newGain; }
+    float getNormalisationGain() const noexcept                   { return normalisationGain; }
+
+    bool isStreaming() const noexcept                             { return reader != nullptr; }
+    juce::AudioFormatReader* getStreamingReader() const noexcept  { return reader.get(); }
+
+    // Number of frames a voice may read, including the trailing guard samples.
+    // For a streaming sound this is more than getAudioData() holds.
+    juce::int64 getTotalNumSamples() const noexcept;
+
+    // Peak levels from each part of the sound to its end. Resident sounds
+    // are measured as they are built, and anything more than 96 dB below
+    // their peak at the end is dropped. A streaming sound's map is empty
+    // until measureStreamingLoudness() is called.
+    const LoudnessMap& getLoudnessMap() const noexcept             { return loudness; }
+
+    // Maps a streaming sound from its resident head and, for the rest, the
+    // slice peaks of the library's waveform overview. Call before the sound
+    // is handed to the audio thread.
+    void measureStreamingLoudness (const juce::Array<float>& slicePeaks);
+
+    // How long the sound plays at its own rate before the rest is silent
+    double getAudibleLengthSeconds() const noexcept;
+
+    // Compact sounds keep 16-bit integers and a scale back to float instead
+    // of float data. A dual-mono file keeps a single channel.
+    struct CompactData
+    {
+        const juce::int16* channels[2] {};
+        int numChannels = 0, numSamples = 0;
+        float scale = 1.0f;
+    };
+
+    bool isCompact() const noexcept                               { return compact.numChannels > 0; }
+    const CompactData& getCompactData() const noexcept            { return compact; }
+
+    // Replaces the resident float data with compact data. Call before the
+    // sound is handed to the audio thread.
+    void makeCompact();
+
+    // The resident data, however it is stored
+    int getNumResidentChannels() const noexcept;
+    int getNumResidentSamples() const noexcept;
+    size_t getResidentSizeInBytes() const noexcept;
+
+    // Copies numFrames resident frames of one channel, from startFrame, out as floats
+    void readResidentFrames (int channel, int startFrame, int numFrames, float* dest) const noexcept;
+
+    // How float data would be stored compactly. 16-bit material maps back
+    // exactly; anything else is scaled so its peak uses the full range. Two
+    // identical channels are stored once.
+    struct CompactLayout
+    {
+        float scale;
+        int numChannels;
+    };
+
+    static CompactLayout getCompactLayout (const float* const* channels, int numChannels, int numSamples) noexcept;
+
+private:
+    // Number of the numSamples measured frames to keep: the audible ones
+    // and the guard samples after them
+    int getTrimmedLength (int numSamples) const noexcept;
+    void trimData();
+
+    juce::String name;
+    juce::ReferenceCountedObjectPtr<juce::ReferenceCountedObject> owner;
+    std::unique_ptr<juce::AudioBuffer<float>> data;
+    juce::HeapBlock<juce::int16> compactStorage;
+    CompactData compact;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    juce::BigInteger midiNotes;
+    int midiRootNote;
+    double sourceSampleRate;
+    float normalisationGain = 1.0f;
+    juce::ADSR::Parameters params;
+    int length;
+    LoudnessMap loudness;
+
+    JUCE_LEAK_DETECTOR (MySamplerSound)
+};
+
+//==============================================================================
+// Playback state of every voice, kept as one array per field so the lane
+// renderer can load several voices into a SIMD register at once. Lane i
+// belongs to the synthesiser's voice i.
+struct VoiceLanes
+{
+    static constexpr int maxLanes = 64;
+
+    VoiceLanes() noexcept;
+
+    // Number of output samples, up to maxSamples, whose frame pair
+    // (pos, pos + 1) lies below limit
+    int getNumFramesBefore (int lane, juce::int64 limit, int maxSamples) const noexcept;
+
+    double position[maxLanes] {};
+    double increment[maxLanes] {};
+    float gainL[maxLanes] {}, gainR[maxLanes] {};
+
+    // Resident source data; the right pointer repeats the left for mono
+    const float* sourceL[maxLanes] {};
+    const float* sourceR[maxLanes] {};
+    juce::int64 numFrames[maxLanes] {};
+
+    // True while the voice plays resident data the lane renderer can handle
+    bool resident[maxLanes] {};
+
+    // Compact, unordered list of the lanes whose voice is playing a note, so
+    // each block only visits those. Removal swaps the last entry into the
+    // gap, which makes it safe to remove while iterating backwards.
+    void addSounding (int lane) noexcept;
+    void removeSounding (int lane) noexcept;
+
+    int sounding[maxLanes] {};
+    int numSounding = 0;
+    int soundingSlot[maxLanes];
+
+    // While set, removeSounding only marks the lane; applyDeferredRemovals
+    // then removes the marked lanes and clears the flag
+    void applyDeferredRemovals() noexcept;
+
+    bool deferRemovals = false;
+    bool removalPending[maxLanes] {};
+
+    // Pitch bend range and glide time every voice uses, and the note the
+    // next one glides from (-1 until a note has been played)
+    double bendRangeSemitones = 2.0;
+    double glideSeconds = 0.0;
+    int lastNote = -1;
+};
+
+//==============================================================================
+// Custom SamplerVoice class to handle ADSR and sample playback
+class MySamplerVoice : public juce::SynthesiserVoice
+{
+public:
+    MySamplerVoice (VoiceLanes& lanesToUse, int laneIndex)
+        : lanes (lanesToUse), lane (laneIndex)
+    {
+        jassert (laneIndex < VoiceLanes::maxLanes);
+    }
+
+    // Hands back a pre-pitched copy still held by a note, so the cache can
+    // free it when it goes
+    ~MySamplerVoice() override                              { releaseCachedEntry(); }
+
+    bool canPlaySound (juce::SynthesiserSound* sound) override;
+
+    void startNote (int midiNoteNumber, float velocity,
+                    juce::SynthesiserSound* sound, int currentPitchWheelPosition) override;
+    void stopNote (float velocity, bool allowTailOff) override;
+
+    void pitchWheelMoved (int newValue) override;
+    void controllerMoved (int /*controllerNumber*/, int /*newValue*/) override {}
+
+    // Slides the sounding note to another note over the glide time, without
+    // restarting the sample or its envelope
+    void glideToNote (int midiNoteNumber) noexcept;
+
+    // The note the voice is sounding, or gliding to
+    int getTargetNote() const noexcept                      { return targetNote; }
+
+    // Recalculates the bend after the bend range has changed
+    void updatePitchBend() noexcept;
+
+    // Moves a glide on by numSamples output samples. Called after each
+    // rendered chunk, so the pitch changes at chunk boundaries.
+    void advancePitch (int numSamples) noexcept
+    {
+        if (glideSamplesRemaining > 0)
+            stepGlide (numSamples);
+    }
+
+    void renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override;
+
+    void setCurrentPlaybackSampleRate (double newRate) override
+    {
+        juce::SynthesiserVoice::setCurrentPlaybackSampleRate (newRate);
+
+        if (newRate > 0.0)
+            adsr.setSampleRate (newRate);
+    }
+
+    // Used by the next note, and by the current one from its next sample
+    void setADSRParameters (const juce::ADSR::Parameters& params) noexcept    { adsr.setParameters (params); }
+    void setEnvelopeCurve (BlockEnvelope::Curve newCurve) noexcept         { adsr.setCurve (newCurve); }
+
+    // Fades the note out over a few milliseconds from the next sample, then ends it
+    void choke() noexcept;
+    bool isChoking() const noexcept                         { return chokeSamplesRemaining >= 0; }
+
+    // How loud the voice was at the end of its last rendered chunk (envelope
+    // times velocity gain). A note that hasn't rendered yet counts as full level.
+    float getCurrentLevel() const noexcept;
+
+    // True once nothing the note has left to play, at the loudest its
+    // envelope can still reach, comes above -96 dB
+    bool isSilentFromHere() const noexcept;
+
+    // Gives this voice the cache of pre-pitched sounds it plays when it can
+    void setPitchCache (PitchCache* cacheToUse)
+    {
+        pitchCache = cacheToUse;
+    }
+
+    // Interpolator used from the next rendered chunk onwards
+    void setQuality (SampleKernels::Quality newQuality) noexcept     { quality = newQuality; }
+
+    // Whether the next note is scaled by its sound's normalisation gain
+    void setNormalising (bool shouldNormalise) noexcept             { normalising = shouldNormalise; }
+
+    // Gives this voice the prefetcher; it uses the stream matching its lane
+    void setPrefetcher (SamplePrefetcher* prefetcherToUse)
+    {
+        prefetcher = prefetcherToUse;
+    }
+
+    // Writes the next numSamples envelope values to dest[i * stride] and
+    // returns how many come before the envelope ends. The rest are zeroed.
+    int fillEnvelope (float* dest, int stride, int numSamples) noexcept;
+
+private:
+    void endNote();
+    void renderSource (int numSamples, bool fromHead) noexcept;
+    void releaseCachedEntry() noexcept;
+    void copyHeadSpan (int channel, juce::int64 firstFrame, int numFrames, float* dest) const noexcept;
+    void startGlide (double targetRatio) noexcept;
+    void stepGlide (int numSamples) noexcept;
+    void updateIncrement() noexcept;
+
+    // Voices render in chunks of up to this many samples using the scratch
+    // buffers below, so nothing is allocated on the audio thread
+    static constexpr int kernelBlockSize = 64;
+
+    // Largest span of source frames a chunk may copy into scratch, either
+    // out of a streaming ring or with edges for the wider interpolators
+    static constexpr int spanCapacity = 1024;
+
+    BlockEnvelope adsr;
+
+    // Position, pitch ratio and gains live in the shared lanes
+    VoiceLanes& lanes;
+    const int lane;
+
+    // The lane's increment is the note's own increment times the glide and
+    // bend ratios. A glide multiplies its ratio by a fixed step every sample,
+    // so the pitch moves evenly in semitones without a pow() per sample.
+    double noteIncrement = 1.0;
+    double glideRatio = 1.0, glideTarget = 1.0, glideStep = 1.0;
+    int glideSamplesRemaining = 0;
+    double bendRatio = 1.0;
+    int pitchWheelPosition = 8192;
+    int targetNote = -1;
+
+    // The note plays from float data, or from a compact sound's data
+    juce::AudioBuffer<float>* soundData = nullptr;
+    const MySamplerSound::CompactData* compactData = nullptr;
+    juce::int64 numSourceSamples = 0;
+
+    // The sound's loudness map, and how many of its frames each frame the
+    // voice plays covers: the pitch ratio for a pre-pitched copy, else 1
+    const LoudnessMap* loudness = nullptr;
+    double loudnessFrameScale = 1.0;
+
+    int getNumHeadSamples() const noexcept      { return soundData != nullptr ? soundData->getNumSamples() : compactData->numSamples; }
+    int getNumHeadChannels() const noexcept     { return soundData != nullptr ? soundData->getNumChannels() : compactData->numChannels; }
+
+    SamplePrefetcher* prefetcher = nullptr;
+    bool isStreaming = false;
+
+    PitchCache* pitchCache = nullptr;
+    PitchCacheEntry* cachedEntry = nullptr;
+
+    SampleKernels::Quality quality = SampleKernels::linear;
+    std::atomic<bool> normalising { true };
+
+    // Long enough not to click, short enough to sound like a cut
+    static constexpr double chokeFadeSeconds = 0.005;
+    int chokeLength = 1, chokeSamplesRemaining = -1;
+    float lastEnvelopeValue = 0.0f;
+
+    int indices[kernelBlockSize];
+    float fractions[kernelBlockSize];
+    float envelope[kernelBlockSize];
+    float left[kernelBlockSize], right[kernelBlockSize];
+    float spanL[spanCapacity], spanR[spanCapacity];
+
+    JUCE_LEAK_DETECTOR (MySamplerVoice)
+};
+
+//==============================================================================
+// Synthesiser that plays a single MySamplerSound which can be swapped from the
+// audio thread without locking or allocating.
+class MySynthesiser : public juce::Synthesiser
+{
+public:
+    MySynthesiser();
+
+    // Replaces the sound new notes will play. Voices that are still sounding
+    // keep their own reference to the previous sound until they finish.
+    void setCurrentSound (const MySamplerSound::Ptr& newSound);
+
+    // The state voices are constructed with. Voice i must use lane i.
+    VoiceLanes& getVoiceLanes() noexcept                    { return lanes; }
+
+    // Renders voices playing resident data four at a time, one per SIMD lane,
+    // instead of walking the voice objects. Can be switched at any time.
+    void setLaneRenderingEnabled (bool shouldBeEnabled) noexcept   { laneRenderingEnabled = shouldBeEnabled; }
+
+    // Hands new envelope settings to the voices, including sounding ones.
+    // Only does any work when the settings differ from the last call.
+    void setADSRParameters (const juce::ADSR::Parameters& params) noexcept;
+
+    // Straight or exponential envelope segments, for every voice
+    void setEnvelopeCurve (BlockEnvelope::Curve newCurve) noexcept;
+
+    // Puts a note into a choke group. Starting a note stops every sounding
+    // voice in the same group with a short fade. Group 0 means no group.
+    void setChokeGroup (int midiNoteNumber, int group) noexcept;
+
+    void noteOn (int midiChannel, int midiNoteNumber, float velocity) override;
+
+    // Which voice a note takes over when the polyphony limit is reached.
+    // With stealSameNote a repeated note takes over its own voice even
+    // below the limit.
+    enum StealPolicy
+    {
+        stealOldest = 0,    // the longest-running note, preferring released ones
+        stealQuietest,      // the lowest current envelope times gain
+        stealSameNote       // a voice already playing this note, else the oldest
+    };
+
+    void setStealPolicy (StealPolicy newPolicy) noexcept     { stealPolicy = (int) newPolicy; }
+
+    // Caps how many voices may sound at once, up to the number of voices
+    void setPolyphonyLimit (int newLimit) noexcept           { polyphonyLimit = juce::jmax (1, newLimit); }
+
+    // Starts the choke fade on the least audible sounding voices
+    void chokeQuietestVoices (int numToChoke) noexcept;
+
+    int getNumSoundingVoices() const noexcept                { return lanes.numSounding; }
+
+    // Sets the pitch wheel's range and the glide time. With a glide time,
+    // each new note slides in from the previous note's pitch.
+    void setPitchModulation (double bendRangeSemitones, double glideSeconds) noexcept;
+
+    // In legato mode a note played while another is held re-targets the
+    // sounding voice instead of starting a new one, and releasing it slides
+    // back to the most recent key still held
+    void setLegatoEnabled (bool shouldBeEnabled) noexcept;
+
+    void noteOff (int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) override;
+    void allNotesOff (int midiChannel, bool allowTailOff) override;
+
+    // Picks the interpolator for every voice
+    void setQuality (SampleKernels::Quality newQuality) noexcept;
+
+    // Plays every sound at the loudness the library measured for it, so
+    // samples from different packs sit at the same level. Notes already
+    // sounding keep their gain.
+    void setNormalisingEnabled (bool shouldBeEnabled) noexcept;
+
+    // True while any voice is playing a note, including its release tail
+    bool hasSoundingVoices() const noexcept                 { return lanes.numSounding > 0; }
+
+    // Shares the voices of large blocks with a few worker threads. Each
+    // voice renders into its own scratch buffer and the buffers are summed
+    // in the serial order, so the output is bit-identical either way. Call
+    // on the message thread; takes effect at the next block.
+    void setVoiceThreadingEnabled (bool shouldBeEnabled);
+
+    // Sizes the voice threads' scratch buffers. Call from prepareToPlay;
+    // larger blocks fall back to rendering serially.
+    void setMaximumBlockSize (int maxBlockSize);
+
+protected:
+    using juce::Synthesiser::renderVoices;
+    void renderVoices (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) override;
+
+    juce::SynthesiserVoice* findFreeVoice (juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                           int midiNoteNumber, bool stealIfNoneAvailable) const override;
+    juce::SynthesiserVoice* findVoiceToSteal (juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                              int midiNoteNumber) const override;
+
+private:
+    void renderLanes (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+    MySamplerVoice* findLegatoVoice() const noexcept;
+    MySamplerVoice* findVoicePlayingNote (int midiNoteNumber) const noexcept;
+    void removeHeldNote (int midiNoteNumber) noexcept;
+    bool renderVoicesOnThreads (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+    static void renderVoiceToScratch (void* context, int index);
+    MySamplerVoice* getVoiceForLane (int lane) const noexcept;
+
+    static constexpr int laneBlockSize = 64;
+
+    VoiceLanes lanes;
+    std::atomic<bool> laneRenderingEnabled { false };
+
+    juce::ADSR::Parameters adsrParameters;
+    bool adsrParametersSet = false;
+    BlockEnvelope::Curve envelopeCurve = BlockEnvelope::linear;
+    SampleKernels::Quality quality = SampleKernels::linear;
+    int chokeGroups[128] {};
+    std::atomic<int> stealPolicy { stealOldest };
+    std::atomic<int> polyphonyLimit { VoiceLanes::maxLanes };
+
+    // Keys held in legato mode, oldest first
+    bool legatoEnabled = false;
+    int heldNotes[128];
+    int numHeldNotes = 0;
+
+    // Envelopes are stored lane-interleaved (sample-major), so each group of
+    // four voices reads its envelope values for a sample with one load
+    float laneEnvelopes[laneBlockSize * VoiceLanes::maxLanes];
+    float accumulatorL[laneBlockSize * 4], accumulatorR[laneBlockSize * 4];
+    int activeLanes[VoiceLanes::maxLanes], numAudible[VoiceLanes::maxLanes];
+
+    // Below these the hand-off to the workers costs more than it saves
+    static constexpr int minThreadedVoices = 4;
+    static constexpr int minThreadedVoiceSamples = 4096;
+
+    // The process-wide pool, held from the first time threading is switched
+    // on. Its workers sleep whenever no instance is handing them voices.
+    std::unique_ptr<juce::SharedResourcePointer<VoiceThreadPool>> voiceThreads;
+    std::atomic<VoiceThreadPool*> activeVoiceThreads { nullptr };
+
+    // Two channels per lane, and a view of each pair for the voice to render into
+    juce::AudioBuffer<float> voiceScratch;
+    juce::AudioBuffer<float> scratchViews[VoiceLanes::maxLanes];
+    int threadedLanes[VoiceLanes::maxLanes];
+    int numThreadedLanes = 0, threadedNumSamples = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MySynthesiser)
+};
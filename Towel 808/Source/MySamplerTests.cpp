@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+    Unit tests for MySynthesiser.
+  ==============================================================================
+*/
+
+#if JUCE_UNIT_TESTS
+
+#include "MySampler.h"
+
+//==============================================================================
+class MySamplerTests  : public juce::UnitTest
+{
+public:
+    MySamplerTests()  : juce::UnitTest ("MySampler", "Towel 808") {}
+
+    void runTest() override
+    {
+        auto sound = makeSound();
+        auto events = makeEvents();
+
+        beginTest ("Voice threads give the same bits as rendering serially");
+
+        for (auto quality : { SampleKernels::linear, SampleKernels::hermite, SampleKernels::sinc })
+        {
+            int maxSerialVoices = 0, maxThreadedVoices = 0;
+            auto serial = render (sound, events, quality, false, maxSerialVoices);
+            auto threaded = render (sound, events, quality, true, maxThreadedVoices);
+
+            // Enough voices to be shared out, and some actually playing
+            expectEquals (maxThreadedVoices, maxSerialVoices);
+            expectGreaterOrEqual (maxThreadedVoices, minVoicesPerBlock);
+            expectGreaterThan (serial.getMagnitude (0, numBlocks * blockSize), 0.01f);
+
+            // Compared as bits, so even a zero of the wrong sign shows up
+            int numDifferent = 0;
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < numBlocks * blockSize; ++i)
+                    if (std::memcmp (serial.getReadPointer (ch, i), threaded.getReadPointer (ch, i), sizeof (float)) != 0)
+                        ++numDifferent;
+
+            expectEquals (numDifferent, 0);
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 512;
+    static constexpr int numBlocks = 48;
+    static constexpr int numVoices = 32;
+    static constexpr int rootNote = 60;
+
+    // The fewest voices a block of this size shares with the workers
+    static constexpr int minVoicesPerBlock = 4096 / blockSize;
+
+    struct Event
+    {
+        int sample, note;
+        float velocity;   // 0 for a note-off
+    };
+
+    // A short decaying stereo noise burst, so notes played high run out of
+    // sample part-way through a block
+    juce::ReferenceCountedObjectPtr<MySamplerSound> makeSound()
+    {
+        constexpr int length = 12000;
+
+        auto random = getRandom();
+        juce::AudioBuffer<float> noise (2, length);
+
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < length; ++i)
+                noise.setSample (ch, i, (random.nextFloat() * 2.0f - 1.0f) * std::exp (-3.0f * (float) i / (float) length));
+
+        juce::MemoryBlock wavData;
+
+        {
+            juce::WavAudioFormat wav;
+            std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (new juce::MemoryOutputStream (wavData, false),
+                                                                                  44100.0, 2, 32, {}, 0));
+            writer->writeFromAudioSampleBuffer (noise, 0, length);
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader (juce::WavAudioFormat().createReaderFor (new juce::MemoryInputStream (wavData, false),
+                                                                                                 true));
+        juce::BigInteger notes;
+        notes.setRange (0, 128, true);
+
+        return new MySamplerSound ("Noise", *reader, notes, rootNote, 0.0, 0.0, 0.0);
+    }
+
+    // Bursts of notes every few blocks, each followed by a few releases, with
+    // quiet blocks in between that render without interruption
+    juce::Array<Event> makeEvents()
+    {
+        auto random = getRandom();
+        juce::Array<Event> events;
+        juce::Array<int> held;
+
+        for (int block = 0; block < numBlocks; block += 3)
+        {
+            for (int n = 0; n < 6; ++n)
+            {
+                auto note = rootNote - 12 + random.nextInt (31);
+                events.add ({ block * blockSize + random.nextInt (blockSize), note, 0.2f + 0.8f * random.nextFloat() });
+                held.addIfNotAlreadyThere (note);
+            }
+
+            for (int n = 0; n < 3 && ! held.isEmpty(); ++n)
+            {
+                auto index = random.nextInt (held.size());
+                events.add ({ (block + 1) * blockSize + random.nextInt (blockSize), held[index], 0.0f });
+                held.remove (index);
+            }
+        }
+
+        std::stable_sort (events.begin(), events.end(),
+                          [] (const Event& a, const Event& b) { return a.sample < b.sample; });
+
+        return events;
+    }
+
+    static juce::AudioBuffer<float> render (const juce::ReferenceCountedObjectPtr<MySamplerSound>& sound,
+                                            const juce::Array<Event>& events, SampleKernels::Quality quality,
+                                            bool useThreads, int& maxSoundingVoices)
+    {
+        MySynthesiser synth;
+
+        for (int i = 0; i < numVoices; ++i)
+            synth.addVoice (new MySamplerVoice (synth.getVoiceLanes(), i));
+
+        synth.setCurrentPlaybackSampleRate (sampleRate);
+        synth.setMaximumBlockSize (blockSize);
+        synth.setQuality (quality);
+        synth.setADSRParameters ({ 0.002f, 0.05f, 0.7f, 0.03f });
+        synth.setVoiceThreadingEnabled (useThreads);
+        synth.setCurrentSound (sound);
+
+        juce::AudioBuffer<float> output (2, numBlocks * blockSize);
+        output.clear();
+
+        juce::MidiBuffer midi;
+        int nextEvent = 0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            auto blockStart = block * blockSize;
+            midi.clear();
+
+            for (; nextEvent < events.size() && events[nextEvent].sample < blockStart + blockSize; ++nextEvent)
+            {
+                auto& event = events.getReference (nextEvent);
+                midi.addEvent (event.velocity > 0.0f ? juce::MidiMessage::noteOn (1, event.note, event.velocity)
+                                                     : juce::MidiMessage::noteOff (1, event.note),
+                               event.sample - blockStart);
+            }
+
+            maxSoundingVoices = juce::jmax (maxSoundingVoices, synth.getNumSoundingVoices());
+
+            juce::AudioBuffer<float> view (output.getArrayOfWritePointers(), 2, blockStart, blockSize);
+            synth.renderNextBlock (view, midi, 0, blockSize);
+        }
+
+        return output;
+    }
+};
+
+static MySamplerTests mySamplerTests;
+
+#endif
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+    Change-tracked copy of the processor's audio parameters.
+  ==============================================================================
+*/
+
+#include "ParameterSnapshot.h"
+
+namespace
+{
+    const char* const parameterIDs[] = { "envAttack", "envDecay", "envSustain", "envRelease", "envCurve", "cutEnabled",
+                                         "quality", "glide", "bendRange", "legato", "drive", "clipCurve" };
+}
+
+//==============================================================================
+ParameterSnapshot::ParameterSnapshot (juce::AudioProcessorValueTreeState& stateToListenTo)
+    : state (stateToListenTo)
+{
+    for (auto* id : parameterIDs)
+    {
+        parameterChanged (id, state.getRawParameterValue (id)->load());
+        state.addParameterListener (id, this);
+    }
+}
+
+ParameterSnapshot::~ParameterSnapshot()
+{
+    for (auto* id : parameterIDs)
+        state.removeParameterListener (id, this);
+}
+
+ParameterSnapshot::Values ParameterSnapshot::getValues() const noexcept
+{
+    Values values;
+    values.envelope.attack  = attack.load();
+    values.envelope.decay   = decay.load();
+    values.envelope.sustain = sustain.load();
+    values.envelope.release = release.load();
+    values.envelopeCurve = juce::roundToInt (envelopeCurve.load());
+    values.cutEnabled = cut.load() > 0.5f;
+    values.quality = juce::roundToInt (quality.load());
+    values.glideSeconds = glide.load();
+    values.bendRange = juce::roundToInt (bendRange.load());
+    values.legatoEnabled = legato.load() > 0.5f;
+    values.driveDecibels = drive.load();
+    values.clipCurve = juce::roundToInt (clipCurve.load());
+    return values;
+}
+
+void ParameterSnapshot::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    if      (parameterID == "envAttack")    attack = newValue;
+    else if (parameterID == "envDecay")     decay = newValue;
+    else if (parameterID == "envSustain")   sustain = newValue;
+    else if (parameterID == "envRelease")   release = newValue;
+    else if (parameterID == "envCurve")     envelopeCurve = newValue;
+    else if (parameterID == "cutEnabled")   cut = newValue;
+    else if (parameterID == "quality")      quality = newValue;
+    else if (parameterID == "glide")        glide = newValue;
+    else if (parameterID == "bendRange")    bendRange = newValue;
+    else if (parameterID == "legato")       legato = newValue;
+    else if (parameterID == "drive")        drive = newValue;
+    else if (parameterID == "clipCurve")    clipCurve = newValue;
+
+    version.fetch_add (1, std::memory_order_release);
+}
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+    Change-tracked copy of the processor's audio parameters.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Listens to the envelope, Cut, quality, pitch and saturation parameters
+    and bumps a version counter whenever one of them changes. The audio
+    thread compares that counter with the version it last read, so a block
+    where nothing moved costs one atomic load instead of a read of every
+    parameter.
+
+    Listener callbacks can arrive on any thread, including the audio thread,
+    so they only store values and never lock or allocate.
+*/
+class ParameterSnapshot  : private juce::AudioProcessorValueTreeState::Listener
+{
+public:
+    explicit ParameterSnapshot (juce::AudioProcessorValueTreeState& stateToListenTo);
+    ~ParameterSnapshot() override;
+
+    struct Values
+    {
+        juce::ADSR::Parameters envelope;
+        int envelopeCurve = 0;
+        bool cutEnabled = false;
+        int quality = 0;
+        float glideSeconds = 0.0f;
+        int bendRange = 2;
+        bool legatoEnabled = false;
+        float driveDecibels = 0.0f;
+        int clipCurve = 0;
+    };
+
+    // Incremented after every change
+    int getVersion() const noexcept     { return version.load (std::memory_order_acquire); }
+
+    // Reads the current values. Call getVersion() first, so a change that
+    // lands in between is picked up again on the next block.
+    Values getValues() const noexcept;
+
+private:
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+
+    juce::AudioProcessorValueTreeState& state;
+
+    std::atomic<float> attack { 0.0f }, decay { 0.0f }, sustain { 0.0f }, release { 0.0f }, envelopeCurve { 0.0f };
+    std::atomic<float> cut { 0.0f }, quality { 0.0f };
+    std::atomic<float> glide { 0.0f }, bendRange { 2.0f }, legato { 0.0f };
+    std::atomic<float> drive { 0.0f }, clipCurve { 0.0f };
+    std::atomic<int> version { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterSnapshot)
+};
@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+    Background cache of sounds rendered in advance at the pitch of each note.
+  ==============================================================================
+*/
+
+#include "PitchCache.h"
+#include "SampleKernels.h"
+
+//==============================================================================
+PitchCache::PitchCache()
+    : juce::Thread ("Towel 808 Pitch Cache")
+{
+    for (auto& slot : slots)
+        slot.store (nullptr);
+}
+
+PitchCache::~PitchCache()
+{
+    signalThreadShouldExit();
+    wakeUp.signal();
+    stopThread (4000);
+
+    // The voices have given their references back by now, so every entry
+    // is only held here and goes with the arrays below
+    for (auto& slot : slots)
+        slot.store (nullptr);
+
+    for (auto& entry : entries)
+    {
+        jassert (entry == nullptr || entry->getReferenceCount() == 1);
+        entry = nullptr;
+    }
+
+    jassert (std::all_of (retired.begin(), retired.end(), [] (PitchCacheEntry* e) { return e->getReferenceCount() == 1; }));
+    retired.clear();
+
+    // Drop the sound references still sitting in unhandled requests
+    int start1, size1, start2, size2;
+    requestFifo.prepareToRead (requestFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)  requests[start1 + i].sound->decReferenceCount();
+    for (int i = 0; i < size2; ++i)  requests[start2 + i].sound->decReferenceCount();
+
+    requestFifo.finishedRead (size1 + size2);
+}
+
+void PitchCache::setEnabled (bool shouldBeEnabled, size_t memoryBudgetBytes)
+{
+    memoryBudget = memoryBudgetBytes;
+    enabled = shouldBeEnabled;
+
+    // Until the cache is first enabled there is nothing for the thread to do
+    if (shouldBeEnabled && ! isThreadRunning())
+        startThread();
+
+    // Either way the thread has something to do: disabling retires every entry
+    wakeUp.signal();
+}
+
+//==============================================================================
+PitchCacheEntry* PitchCache::acquire (MySamplerSound* sound, int note, double sampleRate) noexcept
+{
+    if (! enabled.load() || sound->isStreaming() || ! juce::isPositiveAndBelow (note, numNotes))
+        return nullptr;
+
+    // An unpublished entry stays alive until this block is over, so it is
+    // safe to look at and take a reference to here
+    auto* entry = slots[note].load (std::memory_order_acquire);
+
+    if (entry != nullptr && entry->sound == sound && entry->sampleRate == sampleRate)
+    {
+        entry->incReferenceCount();
+        entry->lastUsed.store (blocksStarted.load(), std::memory_order_relaxed);
+        return entry;
+    }
+
+    if (requestFifo.getFreeSpace() > 0)
+    {
+        // The request holds its own reference until the cache thread adopts it
+        sound->incReferenceCount();
+
+        int start1, size1, start2, size2;
+        requestFifo.prepareToWrite (1, start1, size1, start2, size2);
+        requests[size1 > 0 ? start1 : start2] = { sound, note, sampleRate };
+        requestFifo.finishedWrite (1);
+        wakeUp.signal();
+    }
+
+    return nullptr;
+}
+
+void PitchCache::release (PitchCacheEntry* entry) noexcept
+{
+    // The cache holds its own reference until it frees the entry itself
+    entry->decReferenceCountWithoutDeleting();
+}
+
+//==============================================================================
+void PitchCache::run()
+{
+    while (! threadShouldExit())
+    {
+        if (! enabled.load() && currentSound != nullptr)
+            retireAll();
+
+        handleRequests();
+        freeRetiredEntries();
+
+        // Voices drop their references to retired entries without telling
+        // anyone, so those are checked on a timer until they are all gone.
+        // Otherwise the thread sleeps until the next request.
+        wakeUp.wait (retired.isEmpty() ? -1 : 20);
+    }
+}
+
+void PitchCache::handleRequests()
+{
+    while (requestFifo.getNumReady() > 0 && ! threadShouldExit())
+    {
+        int start1, size1, start2, size2;
+        requestFifo.prepareToRead (1, start1, size1, start2, size2);
+        auto request = requests[size1 > 0 ? start1 : start2];
+        requestFifo.finishedRead (1);
+
+        MySamplerSound::Ptr sound (request.sound);
+        request.sound->decReferenceCount();   // adopted by sound above
+
+        if (enabled.load())
+            build (sound, request.note, request.sampleRate);
+    }
+}
+
+void PitchCache::build (const MySamplerSound::Ptr& sound, int note, double sampleRate)
+{
+    // Only the sound being played is cached; switching to another one or to
+    // a different host rate retires everything built so far
+    if (sound != currentSound || sampleRate != currentSampleRate)
+    {
+        retireAll();
+        currentSound = sound;
+        currentSampleRate = sampleRate;
+    }
+
+    if (entries[note] != nullptr)
+        return;
+
+    // The size is known before anything is rendered, so a copy that can't
+    // fit is never allocated
+    auto ratio = getRatio (*sound, note, sampleRate);
+    auto numBytes = (size_t) sound->getNumResidentChannels() * (size_t) (getNumRenderedFrames (*sound, ratio) + 1) * sizeof (float);
+
+    if (! makeRoomFor (numBytes))
+        return;
+
+    auto entry = render (*sound, note, sampleRate);
+    jassert (getSizeInBytes (*entry) == numBytes);
+
+    bytesUsed += numBytes;
+    entries[note] = entry;
+    slots[note].store (entry.get(), std::memory_order_release);
+}
+
+bool PitchCache::makeRoomFor (size_t numBytes)
+{
+    // Don't evict anything for a copy that wouldn't fit in an empty cache
+    if (numBytes > memoryBudget.load())
+        return false;
+
+    while (bytesUsed + numBytes > memoryBudget.load())
+    {
+        int oldest = -1;
+
+        for (int note = 0; note < numNotes; ++note)
+            if (entries[note] != nullptr
+                 && (oldest < 0 || entries[note]->lastUsed.load() < entries[oldest]->lastUsed.load()))
+                oldest = note;
+
+        if (oldest < 0)
+            return false;
+
+        retire (oldest);
+    }
+
+    return true;
+}
+
+void PitchCache::retire (int note)
+{
+    slots[note].store (nullptr, std::memory_order_seq_cst);
+
+    // Any voice that could still see the slot is inside the current block
+    auto entry = std::move (entries[note]);
+    entry->retiredAtBlock = blocksStarted.load();
+    retired.add (entry);
+}
+
+void PitchCache::retireAll()
+{
+    for (int note = 0; note < numNotes; ++note)
+        if (entries[note] != nullptr)
+            retire (note);
+
+    currentSound = nullptr;
+}
+
+void PitchCache::freeRetiredEntries()
+{
+    auto blockNow = blocksStarted.load();
+
+    // Free an entry once a new block has started since it was unpublished
+    // and no voice is playing it any more
+    for (int i = retired.size(); --i >= 0;)
+    {
+        auto* entry = retired.getObjectPointerUnchecked (i);
+
+        if (entry->retiredAtBlock != blockNow && entry->getReferenceCount() == 1)
+        {
+            bytesUsed -= getSizeInBytes (*entry);
+            retired.remove (i);
+        }
+    }
+}
+
+//==============================================================================
+PitchCacheEntry::Ptr PitchCache::render (const MySamplerSound& sound, int note, double sampleRate)
+{
+    auto ratio = getRatio (sound, note, sampleRate);
+    auto numSourceFrames = sound.getNumResidentSamples();
+    auto numChannels = sound.getNumResidentChannels();
+    auto numFrames = getNumRenderedFrames (sound, ratio);
+
+    PitchCacheEntry::Ptr entry (new PitchCacheEntry());
+    entry->sound = &sound;
+    entry->note = note;
+    entry->sampleRate = sampleRate;
+
+    // One extra silent frame keeps the voice's interpolator in bounds at the end
+    entry->data.setSize (numChannels, numFrames + 1);
+    entry->data.clear();
+
+    // Silence either side of the source covers the sinc kernel's reach
+    auto numLeading = SampleKernels::getLeadingFrames (SampleKernels::sinc);
+    auto numTrailing = SampleKernels::sincTaps + (int) std::ceil (ratio) + 1;
+    juce::HeapBlock<float> padded ((size_t) (numLeading + numSourceFrames + numTrailing), true);
+
+    constexpr int blockSize = 64;
+    int indices[blockSize];
+    float fractions[blockSize];
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        sound.readResidentFrames (channel, 0, numSourceFrames, padded + numLeading);
+        auto* dest = entry->data.getWritePointer (channel);
+
+        for (int start = 0; start < numFrames; start += blockSize)
+        {
+            auto numThisTime = juce::jmin (blockSize, numFrames - start);
+            auto position = start * ratio;
+            auto base = (int) position;
+
+            SampleKernels::computePositions (position - base, ratio, indices, fractions, numThisTime);
+            SampleKernels::interpolateSinc (padded + numLeading + base, indices, fractions, dest + start, numThisTime, ratio);
+        }
+    }
+
+    return entry;
+}
+
+double PitchCache::getRatio (const MySamplerSound& sound, int note, double sampleRate) noexcept
+{
+    return std::pow (2.0, (note - sound.getMidiRootNote()) / 12.0)
+             * (sound.getSourceSampleRate() / sampleRate);
+}
+
+int PitchCache::getNumRenderedFrames (const MySamplerSound& sound, double ratio) noexcept
+{
+    return juce::jmax (1, (int) std::ceil ((sound.getNumResidentSamples() - 1) / ratio));
+}
+
+size_t PitchCache::getSizeInBytes (const PitchCacheEntry& entry) noexcept
+{
+    return (size_t) entry.data.getNumChannels() * (size_t) entry.data.getNumSamples() * sizeof (float);
+}
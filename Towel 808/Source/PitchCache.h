@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+    Background cache of sounds rendered in advance at the pitch of each note.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MySampler.h"
+#include "AudioThreadEvent.h"
+
+//==============================================================================
+/**
+    One sound resampled to one note at one host sample rate. Voices play it
+    back frame for frame. Never modified once published.
+*/
+class PitchCacheEntry  : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<PitchCacheEntry>;
+
+    juce::AudioBuffer<float> data;
+    const MySamplerSound* sound = nullptr;   // only compared, never dereferenced
+    int note = 0;
+    double sampleRate = 0.0;
+
+private:
+    friend class PitchCache;
+    std::atomic<juce::uint32> lastUsed { 0 };
+    juce::uint32 retiredAtBlock = 0;
+};
+
+//==============================================================================
+/**
+    Renders band-limited, pre-pitched copies of the current sound on its own
+    thread, one per note, the first time each note is played. Until a note's
+    copy is ready, voices resample live as usual. The thread is only started
+    when the cache is first enabled, and it sleeps until a note asks for a
+    copy or an evicted one is waiting to be freed.
+
+    Entries are published through one atomic slot per note. The audio thread
+    takes a reference to an entry it plays and drops it without deleting.
+    The cache only frees an entry once it has been unpublished for a whole
+    audio block and nothing else holds it, so a voice can never pick up an
+    entry that is about to be freed.
+*/
+class PitchCache  : private juce::Thread
+{
+public:
+    PitchCache();
+    ~PitchCache() override;
+
+    // Enables or disables the cache. Entries beyond the budget are not built;
+    // the least recently played are evicted to make room for new ones. Call
+    // on the message thread.
+    void setEnabled (bool shouldBeEnabled, size_t memoryBudgetBytes);
+
+    //==============================================================================
+    // The functions below are called on the audio thread.
+
+    // Must be called at the start of every processBlock
+    void audioBlockStarted() noexcept       { blocksStarted.fetch_add (1); }
+
+    // Returns the entry for this note with a reference taken, or nullptr after
+    // asking the cache thread to build it
+    PitchCacheEntry* acquire (MySamplerSound* sound, int note, double sampleRate) noexcept;
+
+    // Gives back a reference taken by acquire()
+    void release (PitchCacheEntry* entry) noexcept;
+
+private:
+    struct Request
+    {
+        MySamplerSound* sound;
+        int note;
+        double sampleRate;
+    };
+
+    void run() override;
+    void handleRequests();
+    void build (const MySamplerSound::Ptr& sound, int note, double sampleRate);
+    bool makeRoomFor (size_t numBytes);
+    void retire (int note);
+    void retireAll();
+    void freeRetiredEntries();
+
+    static PitchCacheEntry::Ptr render (const MySamplerSound& sound, int note, double sampleRate);
+    static size_t getSizeInBytes (const PitchCacheEntry& entry) noexcept;
+
+    // The pitch ratio a note plays the sound at, and how many frames its
+    // copy has, not counting the silent frame at the end
+    static double getRatio (const MySamplerSound& sound, int note, double sampleRate) noexcept;
+    static int getNumRenderedFrames (const MySamplerSound& sound, double ratio) noexcept;
+
+    static constexpr int numNotes = 128;
+
+    std::atomic<bool> enabled { false };
+    std::atomic<size_t> memoryBudget { 0 };
+    std::atomic<juce::uint32> blocksStarted { 0 };
+    std::atomic<PitchCacheEntry*> slots[numNotes];
+
+    // Woken by the audio thread, so juce::Thread's own event, which locks,
+    // isn't used
+    AudioThreadEvent wakeUp;
+
+    static constexpr int maxRequests = 256;
+    juce::AbstractFifo requestFifo { maxRequests };
+    Request requests[maxRequests];
+
+    // Cache thread only
+    MySamplerSound::Ptr currentSound;
+    double currentSampleRate = 0.0;
+    PitchCacheEntry::Ptr entries[numNotes];
+    juce::ReferenceCountedArray<PitchCacheEntry> retired;
+    size_t bytesUsed = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchCache)
+};
@@ -16,7 +16,7 @@ NewProjectAudioProcessorEditor::NewProjectAudioProcessorEditor (NewProjectAudioP
 
     // Make the editor resizable and set resize limits
     setResizable (true, true);
-    setResizeLimits (400, 300, 1000, 800);
+    setResizeLimits (600, 300, 1000, 800);
 
     // Add the keyboard component
     addAndMakeVisible (keyboardComponent);
@@ -80,6 +80,34 @@ NewProjectAudioProcessorEditor::NewProjectAudioProcessorEditor (NewProjectAudioP
     releaseAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
         audioProcessor.apvts, "envRelease", releaseSlider);
 
+    // Initialize and configure the Glide slider and label
+    glideSlider.setSliderStyle(juce::Slider::LinearVertical);
+    glideSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
+    glideSlider.setColour(juce::Slider::thumbColourId, sliderColour);
+    glideSlider.setColour(juce::Slider::trackColourId, sliderColour);
+    addAndMakeVisible(glideSlider);
+
+    glideLabel.setText("Glide", juce::dontSendNotification);
+    glideLabel.setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(glideLabel);
+
+    glideAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.apvts, "glide", glideSlider);
+
+    // Initialize and configure the Drive slider and label
+    driveSlider.setSliderStyle(juce::Slider::LinearVertical);
+    driveSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
+    driveSlider.setColour(juce::Slider::thumbColourId, sliderColour);
+    driveSlider.setColour(juce::Slider::trackColourId, sliderColour);
+    addAndMakeVisible(driveSlider);
+
+    driveLabel.setText("Drive", juce::dontSendNotification);
+    driveLabel.setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(driveLabel);
+
+    driveAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.apvts, "drive", driveSlider);
+
     // Initialize and configure the Cut button
     cutButton.setButtonText("Cut");
     addAndMakeVisible(cutButton);
@@ -87,18 +115,85 @@ NewProjectAudioProcessorEditor::NewProjectAudioProcessorEditor (NewProjectAudioP
     cutButtonAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
         audioProcessor.apvts, "cutEnabled", cutButton);
 
-    // Get the list of sample names from the processor
-    auto sampleNames = audioProcessor.getSampleNames();
-
-    // Add items to the ComboBox and configure it
-    sampleSelector.addItemList(sampleNames, 1); // IDs start from 1
-    sampleSelector.setSelectedId(1); // Select the first sample by default
+    // Initialize and configure the Legato button
+    legatoButton.setButtonText("Legato");
+    addAndMakeVisible(legatoButton);
+
+    legatoButtonAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        audioProcessor.apvts, "legato", legatoButton);
+
+    // Initialize and configure the Bank button
+    bankButton.setButtonText("Bank");
+    bankButton.setToggleState(audioProcessor.isBankModeEnabled(), juce::dontSendNotification);
+    bankButton.onClick = [this] { audioProcessor.setBankModeEnabled(bankButton.getToggleState()); };
+    addAndMakeVisible(bankButton);
+
+    // Initialize and configure the Stream button
+    streamButton.setButtonText("Stream");
+    streamButton.setToggleState(audioProcessor.isStreamingEnabled(), juce::dontSendNotification);
+    streamButton.onClick = [this] { audioProcessor.setStreamingEnabled(streamButton.getToggleState()); };
+    addAndMakeVisible(streamButton);
+
+    // Initialize and configure the Cache button
+    cacheButton.setButtonText("Cache");
+    cacheButton.setToggleState(audioProcessor.isPitchCacheEnabled(), juce::dontSendNotification);
+    cacheButton.onClick = [this] { audioProcessor.setPitchCacheEnabled(cacheButton.getToggleState()); };
+    addAndMakeVisible(cacheButton);
+
+    // Initialize and configure the Lanes button
+    lanesButton.setButtonText("Lanes");
+    lanesButton.setToggleState(audioProcessor.isLaneRenderingEnabled(), juce::dontSendNotification);
+    lanesButton.onClick = [this] { audioProcessor.setLaneRenderingEnabled(lanesButton.getToggleState()); };
+    addAndMakeVisible(lanesButton);
+
+    // Initialize and configure the Threads button
+    threadsButton.setButtonText("Threads");
+    threadsButton.setToggleState(audioProcessor.isVoiceThreadingEnabled(), juce::dontSendNotification);
+    threadsButton.onClick = [this] { audioProcessor.setVoiceThreadingEnabled(threadsButton.getToggleState()); };
+    addAndMakeVisible(threadsButton);
+
+    // Initialize and configure the Compact button
+    compactButton.setButtonText("Compact");
+    compactButton.setToggleState(audioProcessor.isCompactStorageEnabled(), juce::dontSendNotification);
+    compactButton.onClick = [this] { audioProcessor.setCompactStorageEnabled(compactButton.getToggleState()); };
+    addAndMakeVisible(compactButton);
+
+    // Fill the ComboBox from the processor's sample list and keep it up to date
+    refreshSampleList();
     sampleSelector.addListener(this);
     addAndMakeVisible(sampleSelector);
+    audioProcessor.getSampleLibrary().addChangeListener(this);
+
+    // Configure the voice stealing policy selector; IDs are the policy plus one
+    stealSelector.addItemList(juce::StringArray { "Steal Oldest", "Steal Quietest", "Steal Same Note" }, 1);
+    stealSelector.setSelectedId(audioProcessor.getStealPolicy() + 1, juce::dontSendNotification);
+    stealSelector.onChange = [this] { audioProcessor.setStealPolicy(stealSelector.getSelectedId() - 1); };
+    addAndMakeVisible(stealSelector);
+
+    // Add the quality choices before attaching, so the attachment can select one
+    qualitySelector.addItemList(juce::StringArray { "Linear", "Hermite", "Sinc" }, 1);
+    addAndMakeVisible(qualitySelector);
+
+    qualityAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        audioProcessor.apvts, "quality", qualitySelector);
+
+    // The curve choices follow the same pattern as the quality ones
+    curveSelector.addItemList(juce::StringArray { "Off", "Soft", "Tape", "Hard" }, 1);
+    addAndMakeVisible(curveSelector);
+
+    curveAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        audioProcessor.apvts, "clipCurve", curveSelector);
+
+    // Configure the oversampling selector; IDs are the number of stages plus one
+    oversamplingSelector.addItemList(juce::StringArray { "1x", "2x", "4x" }, 1);
+    oversamplingSelector.setSelectedId(audioProcessor.getOversampling() + 1, juce::dontSendNotification);
+    oversamplingSelector.onChange = [this] { audioProcessor.setOversampling(oversamplingSelector.getSelectedId() - 1); };
+    addAndMakeVisible(oversamplingSelector);
 }
 
 NewProjectAudioProcessorEditor::~NewProjectAudioProcessorEditor()
 {
+    audioProcessor.getSampleLibrary().removeChangeListener(this);
     sampleSelector.removeListener(this);
 }
 
@@ -126,20 +221,38 @@ void NewProjectAudioProcessorEditor::resized()
     int width = getWidth();
     int height = getHeight();
 
-    // Position the ComboBox at the top
+    // Position the ComboBoxes at the top, with the steal, quality, curve and
+    // oversampling selectors on the right
     int comboBoxHeight = 30;
-    sampleSelector.setBounds(padding, padding, width - 2 * padding, comboBoxHeight);
-
-    // Position the Cut button below the sampleSelector
+    int stealWidth = 120;
+    int qualityWidth = 90;
+    int curveWidth = 80;
+    int oversamplingWidth = 60;
+    sampleSelector.setBounds(padding, padding, width - 6 * padding - stealWidth - qualityWidth - curveWidth - oversamplingWidth, comboBoxHeight);
+    stealSelector.setBounds(sampleSelector.getRight() + padding, padding, stealWidth, comboBoxHeight);
+    qualitySelector.setBounds(stealSelector.getRight() + padding, padding, qualityWidth, comboBoxHeight);
+    curveSelector.setBounds(qualitySelector.getRight() + padding, padding, curveWidth, comboBoxHeight);
+    oversamplingSelector.setBounds(curveSelector.getRight() + padding, padding, oversamplingWidth, comboBoxHeight);
+
+    // Position the Cut, Bank, Stream, Cache, Lanes, Threads, Compact and
+    // Legato buttons side by side below the sampleSelector
     int buttonHeight = 30;
-    cutButton.setBounds(padding, sampleSelector.getBottom() + componentSpacing, width - 2 * padding, buttonHeight);
+    int buttonWidth = (width - 9 * padding) / 8;
+    cutButton.setBounds(padding, sampleSelector.getBottom() + componentSpacing, buttonWidth, buttonHeight);
+    bankButton.setBounds(2 * padding + buttonWidth, cutButton.getY(), buttonWidth, buttonHeight);
+    streamButton.setBounds(3 * padding + 2 * buttonWidth, cutButton.getY(), buttonWidth, buttonHeight);
+    cacheButton.setBounds(4 * padding + 3 * buttonWidth, cutButton.getY(), buttonWidth, buttonHeight);
+    lanesButton.setBounds(5 * padding + 4 * buttonWidth, cutButton.getY(), buttonWidth, buttonHeight);
+    threadsButton.setBounds(6 * padding + 5 * buttonWidth, cutButton.getY(), buttonWidth, buttonHeight);
+    compactButton.setBounds(7 * padding + 6 * buttonWidth, cutButton.getY(), buttonWidth, buttonHeight);
+    legatoButton.setBounds(8 * padding + 7 * buttonWidth, cutButton.getY(), buttonWidth, buttonHeight);
 
     // Calculate area for sliders
     int slidersAreaY = cutButton.getBottom() + componentSpacing;
     int slidersAreaHeight = height * 0.35f; // 35% of window height for sliders
 
     // Calculate the width for each slider based on the total available width
-    int numSliders = 4;
+    int numSliders = 6;
     int totalSliderPadding = (numSliders + 1) * padding;
     int sliderWidth = (width - totalSliderPadding) / numSliders;
     int sliderHeight = slidersAreaHeight - 2 * padding;
@@ -159,6 +272,12 @@ void NewProjectAudioProcessorEditor::resized()
     releaseSlider.setBounds(4 * padding + 3 * sliderWidth, sliderY, sliderWidth, sliderHeight);
     releaseLabel.setBounds(4 * padding + 3 * sliderWidth, sliderY + sliderHeight, sliderWidth, 20);
 
+    glideSlider.setBounds(5 * padding + 4 * sliderWidth, sliderY, sliderWidth, sliderHeight);
+    glideLabel.setBounds(5 * padding + 4 * sliderWidth, sliderY + sliderHeight, sliderWidth, 20);
+
+    driveSlider.setBounds(6 * padding + 5 * sliderWidth, sliderY, sliderWidth, sliderHeight);
+    driveLabel.setBounds(6 * padding + 5 * sliderWidth, sliderY + sliderHeight, sliderWidth, 20);
+
     // Position the keyboard component at the bottom
     int keyboardY = slidersAreaY + slidersAreaHeight + componentSpacing;
     int keyboardHeight = height - keyboardY - padding;
@@ -177,3 +296,20 @@ void NewProjectAudioProcessorEditor::comboBoxChanged (juce::ComboBox* comboBoxTh
         audioProcessor.loadSample(selectedSample);
     }
 }
+
+void NewProjectAudioProcessorEditor::changeListenerCallback (juce::ChangeBroadcaster* /*source*/)
+{
+    refreshSampleList();
+}
+
+void NewProjectAudioProcessorEditor::refreshSampleList()
+{
+    auto sampleNames = audioProcessor.getSampleNames();
+
+    // IDs start from 1. Show the sample that is playing, or the first one,
+    // which is what the processor loads when nothing has been chosen yet.
+    sampleSelector.clear(juce::dontSendNotification);
+    sampleSelector.addItemList(sampleNames, 1);
+    sampleSelector.setSelectedId(juce::jmax(0, sampleNames.indexOf(audioProcessor.getCurrentSampleName())) + 1,
+                                 juce::dontSendNotification);
+}
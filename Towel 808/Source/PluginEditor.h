@@ -13,7 +13,8 @@
 /**
 */
 class NewProjectAudioProcessorEditor  : public juce::AudioProcessorEditor,
-                                        public juce::ComboBox::Listener
+                                        public juce::ComboBox::Listener,
+                                        private juce::ChangeListener
 {
 public:
     NewProjectAudioProcessorEditor (NewProjectAudioProcessor&);
@@ -27,6 +28,10 @@ public:
     void comboBoxChanged (juce::ComboBox* comboBoxThatHasChanged) override;
 
 private:
+    // Refills the sample list when the library finds new or removed files
+    void changeListenerCallback (juce::ChangeBroadcaster* source) override;
+    void refreshSampleList();
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     NewProjectAudioProcessor& audioProcessor;
@@ -34,6 +39,20 @@ private:
     // ComboBox to select samples
     juce::ComboBox sampleSelector;
 
+    // ComboBox to select the voice stealing policy
+    juce::ComboBox stealSelector;
+
+    // ComboBox to select the resampling quality
+    juce::ComboBox qualitySelector;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> qualityAttachment;
+
+    // ComboBox to select the saturation curve
+    juce::ComboBox curveSelector;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> curveAttachment;
+
+    // ComboBox to select the saturation's oversampling factor
+    juce::ComboBox oversamplingSelector;
+
     // Midi keyboard component
     juce::MidiKeyboardComponent keyboardComponent;
 
@@ -46,16 +65,44 @@ private:
     juce::Label sustainLabel;
     juce::Slider releaseSlider;
     juce::Label releaseLabel;
+    juce::Slider glideSlider;
+    juce::Label glideLabel;
+    juce::Slider driveSlider;
+    juce::Label driveLabel;
 
     // Attachments for sliders
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> attackAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> decayAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> sustainAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> releaseAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> glideAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> driveAttachment;
 
     // ToggleButton for Cut functionality
     juce::ToggleButton cutButton;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> cutButtonAttachment;
 
+    // ToggleButton for mono legato slides
+    juce::ToggleButton legatoButton;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> legatoButtonAttachment;
+
+    // ToggleButton for preloading the whole sample folder
+    juce::ToggleButton bankButton;
+
+    // ToggleButton for streaming samples from disk
+    juce::ToggleButton streamButton;
+
+    // ToggleButton for the pre-pitched note cache
+    juce::ToggleButton cacheButton;
+
+    // ToggleButton for the cross-voice lane engine
+    juce::ToggleButton lanesButton;
+
+    // ToggleButton for rendering voices on worker threads
+    juce::ToggleButton threadsButton;
+
+    // ToggleButton for 16-bit sample storage
+    juce::ToggleButton compactButton;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NewProjectAudioProcessorEditor)
 };
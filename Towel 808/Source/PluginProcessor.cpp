@@ -7,203 +7,33 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
-//==============================================================================
-/*
-  Class definitions for MySamplerSound and MySamplerVoice
-*/
-
-// Custom SamplerSound class to hold sample data and parameters
-class MySamplerSound : public juce::SynthesiserSound
-{
-public:
-    MySamplerSound(const juce::String& soundName,
-                   juce::AudioFormatReader& source,
-                   const juce::BigInteger& notes,
-                   int midiNoteForNormalPitch,
-                   double attackTimeSecs,
-                   double releaseTimeSecs,
-                   double maxSampleLengthSeconds)
-        : name(soundName),
-          midiNotes(notes),
-          midiRootNote(midiNoteForNormalPitch)
-    {
-        if (maxSampleLengthSeconds > 0)
-            length = juce::roundToIntAccurate(source.sampleRate * maxSampleLengthSeconds);
-        else
-            length = (int)source.lengthInSamples;
-
-        data.reset(new juce::AudioBuffer<float>(juce::jmin(2, (int)source.numChannels), length + 4));
-
-        source.read(data.get(), 0, length + 4, 0, true, true);
-
-        params.attack = attackTimeSecs;
-        params.release = releaseTimeSecs;
-
-        sourceSampleRate = source.sampleRate;
-    }
-
-    bool appliesToNote (int midiNoteNumber) override
-    {
-        return midiNotes[midiNoteNumber];
-    }
-
-    bool appliesToChannel (int /*midiChannel*/) override
-    {
-        return true;
-    }
-
-    juce::AudioBuffer<float>* getAudioData() const noexcept
-    {
-        return data.get();
-    }
-
-    const juce::ADSR::Parameters& getADSRParameters() const noexcept
-    {
-        return params;
-    }
-
-    int getMidiRootNote() const noexcept
-    {
-        return midiRootNote;
-    }
-
-    double getSourceSampleRate() const noexcept
-    {
-        return sourceSampleRate;
-    }
-
-private:
-    juce::String name;
-    std::unique_ptr<juce::AudioBuffer<float>> data;
-    juce::BigInteger midiNotes;
-    int midiRootNote;
-    double sourceSampleRate;
-    juce::ADSR::Parameters params;
-    int length;
-};
-
-// Custom SamplerVoice class to handle ADSR and sample playback
-class MySamplerVoice : public juce::SynthesiserVoice
+namespace
 {
-public:
-    MySamplerVoice() {}
-
-    bool canPlaySound (juce::SynthesiserSound* sound) override
-    {
-        return dynamic_cast<MySamplerSound*> (sound) != nullptr;
-    }
-
-    void startNote (int midiNoteNumber, float velocity,
-                    juce::SynthesiserSound* sound, int /*currentPitchWheelPosition*/) override
-    {
-        if (auto* samplerSound = dynamic_cast<MySamplerSound*> (sound))
-        {
-            pitchRatio = std::pow (2.0, (midiNoteNumber - samplerSound->getMidiRootNote()) / 12.0)
-                            * (samplerSound->getSourceSampleRate() / getSampleRate());
+    // "T808", then the version of the layout that follows it. Newer versions
+    // only ever add to the tree, so older builds can still read what they know.
+    constexpr int stateTag = 0x38303854;
+    constexpr int stateVersion = 1;
 
-            sourceSamplePosition = 0.0;
-            lgain = velocity;
-            rgain = velocity;
-
-            adsr.setSampleRate (getSampleRate());
-            adsr.setParameters (adsrParameters);
-            adsr.noteOn();
-
-            // Keep a reference to the audio data
-            soundData = samplerSound->getAudioData();
-        }
-        else
-        {
-            jassertfalse; // This object can only play MySamplerSounds!
-        }
-    }
+    const juce::Identifier stateType("Towel808State");
+    const juce::Identifier sampleType("Sample");
 
-    void stopNote (float /*velocity*/, bool allowTailOff) override
+    bool isSameEnvelope(const juce::ADSR::Parameters& a, const juce::ADSR::Parameters& b)
     {
-        if (allowTailOff)
-        {
-            adsr.noteOff();
-        }
-        else
-        {
-            clearCurrentNote();
-            adsr.reset();
-            soundData = nullptr; // Invalidate the soundData pointer
-        }
+        return a.attack == b.attack && a.decay == b.decay && a.sustain == b.sustain && a.release == b.release;
     }
 
-    void pitchWheelMoved (int /*newValue*/) override {}
-    void controllerMoved (int /*controllerNumber*/, int /*newValue*/) override {}
-
-    void renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override
+    juce::ADSR::Parameters interpolateEnvelope(const juce::ADSR::Parameters& from, const juce::ADSR::Parameters& to, float proportion)
     {
-        if (soundData == nullptr)
-            return;
-
-        const float* const inL = soundData->getReadPointer (0);
-        const float* const inR = soundData->getNumChannels() > 1 ? soundData->getReadPointer (1) : nullptr;
+        auto blend = [proportion] (float a, float b) { return a + proportion * (b - a); };
 
-        auto numSourceSamples = soundData->getNumSamples();
-
-        while (--numSamples >= 0)
-        {
-            // Check if soundData is still valid
-            if (soundData == nullptr)
-                break;
-
-            auto pos = (int) sourceSamplePosition;
-
-            if (pos + 1 >= numSourceSamples)
-            {
-                // Stop the note and exit the loop to prevent out-of-bounds access
-                stopNote (0.0f, false);
-                break;
-            }
-
-            auto alpha = (float) (sourceSamplePosition - pos);
-            auto invAlpha = 1.0f - alpha;
-
-            // Simple linear interpolation
-            float l = (inL[pos] * invAlpha + inL[pos + 1] * alpha);
-            float r = inR != nullptr ? (inR[pos] * invAlpha + inR[pos + 1] * alpha) : l;
-
-            auto envelopeValue = adsr.getNextSample();
-
-            if (envelopeValue <= 0.0f)
-            {
-                clearCurrentNote();
-                soundData = nullptr; // Invalidate the soundData pointer
-                break;
-            }
-
-            outputBuffer.addSample (0, startSample, l * lgain * envelopeValue);
-            outputBuffer.addSample (1, startSample, r * rgain * envelopeValue);
-
-            sourceSamplePosition += pitchRatio;
-
-            ++startSample;
-        }
+        return { blend(from.attack, to.attack),
+                 blend(from.decay, to.decay),
+                 blend(from.sustain, to.sustain),
+                 blend(from.release, to.release) };
     }
-
-    void setADSRParameters(const juce::ADSR::Parameters& params)
-    {
-        adsrParameters = params;
-    }
-
-private:
-    juce::ADSR adsr;
-    juce::ADSR::Parameters adsrParameters;
-
-    double pitchRatio = 0.0;
-    double sourceSamplePosition = 0.0;
-    float lgain = 0.0f, rgain = 0.0f;
-
-    juce::AudioBuffer<float>* soundData = nullptr;
-};
+}
 
 //==============================================================================
-// Now proceed with the rest of your PluginProcessor.cpp code
-
 NewProjectAudioProcessor::NewProjectAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
      : AudioProcessor (BusesProperties()
@@ -225,14 +55,37 @@ NewProjectAudioProcessor::NewProjectAudioProcessor()
 
     // Add voices to the sampler for polyphony
     for (int i = 0; i < numVoices; ++i)
-        sampler.addVoice(new MySamplerVoice());
+    {
+        auto* voice = new MySamplerVoice(sampler.getVoiceLanes(), i);
+        voice->setPrefetcher(&prefetcher);
+        voice->setPitchCache(&pitchCache);
+        sampler.addVoice(voice);
+    }
 
-    // Get the list of sample files
-    samplesDirectory.findChildFiles(sampleFiles, juce::File::findFiles, false, "*.wav");
+    // juce::Synthesiser locks itself on the audio thread every block
+    RealtimeSafety::allowUncontendedLocks(sampler.getLock());
+
+    // The sample list comes from the library's index, so nothing here waits
+    // on the disk; we hear about it when a background check changes the list.
+    // Every instance shares the library's listener list, which only the
+    // message thread may change. Instances made on other threads, like the
+    // renderer's jobs, read the list when they need it instead.
+    if (juce::MessageManager::existsAndIsCurrentThread())
+    {
+        library->addChangeListener(this);
+        listeningToLibrary = true;
+    }
 }
 
 NewProjectAudioProcessor::~NewProjectAudioProcessor()
 {
+    RealtimeSafety::disallowUncontendedLocks(sampler.getLock());
+
+    if (listeningToLibrary)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+        library->removeChangeListener(this);
+    }
 }
 
 //==============================================================================
@@ -258,7 +111,13 @@ bool NewProjectAudioProcessor::isMidiEffect() const
 
 double NewProjectAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // A released note rings on for the release time, unless its sample dies
+    // away first, and the saturator's filters hold it back a little longer
+    auto values = parameters.getValues();
+    auto release = values.cutEnabled ? cutReleaseSeconds : values.envelope.release;
+    auto latency = getSampleRate() > 0.0 ? getLatencySamples() / getSampleRate() : 0.0;
+
+    return juce::jmin((double) release, (double) longestNoteSeconds.load()) + latency;
 }
 
 int NewProjectAudioProcessor::getNumPrograms()
@@ -285,13 +144,23 @@ void NewProjectAudioProcessor::changeProgramName (int /*index*/, const juce::Str
 }
 
 //==============================================================================
-void NewProjectAudioProcessor::prepareToPlay (double sampleRate, int /*samplesPerBlock*/)
+void NewProjectAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     // Set the playback sample rate for the sampler
     sampler.setCurrentPlaybackSampleRate(sampleRate);
+    sampler.setMaximumBlockSize(samplesPerBlock);
+
+    saturator.prepare(sampleRate, samplesPerBlock);
+    setLatencySamples(BusSaturator::getLatencySamples(getOversampling()));
+
+    // The current sample is converted to a new rate in the background; at
+    // the same rate as last time this does nothing
+    sampleLoader.setHostSampleRate(sampleRate);
+
+    // Load a default sample the first time only, so the user's choice survives
+    auto sampleFiles = library->getFiles(samplesDirectory);
 
-    // Optionally load a default sample
-    if (sampleFiles.size() > 0)
+    if (currentSampleName.isEmpty() && sampleFiles.size() > 0)
         loadSample(sampleFiles[0].getFileNameWithoutExtension());
 }
 
@@ -300,6 +169,15 @@ void NewProjectAudioProcessor::releaseResources()
     // Free up any spare memory when playback stops
 }
 
+void NewProjectAudioProcessor::reset()
+{
+    // Cut every voice dead, without a release tail, and land any envelope
+    // glide that was in progress
+    sampler.allNotesOff(0, false);
+    currentParameters = targetParameters;
+    saturator.reset();
+}
+
 // This checks if the layout is supported.
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool NewProjectAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -328,52 +206,119 @@ void NewProjectAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
 {
     juce::ScopedNoDenormals noDenormals;
 
-    // Update keyboard state
-    keyboardState.processNextMidiBuffer(midiMessages, 0, buffer.getNumSamples(), true);
-
-    // Update ADSR parameters
-    juce::ADSR::Parameters adsrParams;
-    adsrParams.attack = apvts.getRawParameterValue("envAttack")->load();
-    adsrParams.decay = apvts.getRawParameterValue("envDecay")->load();
-    adsrParams.sustain = apvts.getRawParameterValue("envSustain")->load();
-    adsrParams.release = apvts.getRawParameterValue("envRelease")->load();
+    // In checked builds, anything below that allocates, locks or blocks is logged
+    RealtimeSafety::ScopedAudioThread realtimeThread;
 
-    // Implement the Cut functionality
-    bool cutEnabled = apvts.getRawParameterValue("cutEnabled")->load() > 0.5f;
+    // Lets the pitch cache know when entries it has unpublished are safe to free
+    pitchCache.audioBlockStarted();
 
-    if (cutEnabled)
+    // Pick up a newly decoded sample, if the loader has published one
+    if (auto newSound = sampleLoader.takePendingSound())
     {
-        // Set a very short release time when Cut is enabled
-        adsrParams.release = 0.01f; // 10 milliseconds release time
+        sampler.setCurrentSound(newSound);
 
-        juce::MidiBuffer::Iterator it(midiMessages);
-        juce::MidiMessage message;
-        int samplePosition;
+        // The lowest note plays the sample slowest, and so for longest
+        longestNoteSeconds = (float) (newSound->getAudibleLengthSeconds() * std::exp2(newSound->getMidiRootNote() / 12.0));
+    }
 
-        while (it.getNextEvent(message, samplePosition))
-        {
-            if (message.isNoteOn())
-            {
-                // Stop all voices before processing this note
-                sampler.allNotesOff(0, true); // Force immediate stop
-                break; // Only need to stop once per block
-            }
-        }
+    // Update keyboard state. The keyboard locks itself, much as the sampler does.
+    {
+        RealtimeSafety::ScopedUncontendedLocksAllowed uncontendedLocksAllowed;
+        keyboardState.processNextMidiBuffer(midiMessages, 0, buffer.getNumSamples(), true);
     }
 
-    // Set ADSR parameters for each voice
-    for (int i = 0; i < sampler.getNumVoices(); ++i)
+    // An idle instance with nothing to play does no more than clear its
+    // output, once the saturator's filters have played out their last tail
+    if (midiMessages.isEmpty() && ! sampler.hasSoundingVoices() && saturator.isIdle())
     {
-        if (auto* voice = dynamic_cast<MySamplerVoice*>(sampler.getVoice(i)))
-        {
-            voice->setADSRParameters(adsrParams);
-        }
+        buffer.clear();
+        return;
+    }
+
+    // Pick up changed parameters; a block where nothing moved costs one atomic load
+    auto version = parameters.getVersion();
+
+    if (version != parameterVersion)
+    {
+        parameterVersion = version;
+        targetParameters = parameters.getValues();
+
+        // Set a very short release time when Cut is enabled
+        if (targetParameters.cutEnabled)
+            targetParameters.envelope.release = cutReleaseSeconds;
+
+        sampler.setEnvelopeCurve((BlockEnvelope::Curve) juce::jlimit(0, 1, targetParameters.envelopeCurve));
+        sampler.setQuality((SampleKernels::Quality) juce::jlimit(0, 2, targetParameters.quality));
+        sampler.setPitchModulation(targetParameters.bendRange, targetParameters.glideSeconds);
+        sampler.setLegatoEnabled(targetParameters.legatoEnabled);
+
+        saturator.setDrive(targetParameters.driveDecibels);
+        saturator.setCurve((BusSaturator::Curve) juce::jlimit(0, 3, targetParameters.clipCurve));
+
+        // Cut puts every note in one choke group, so each new note fades out
+        // whatever was playing from its own sample position
+        for (int note = 0; note < 128; ++note)
+            sampler.setChokeGroup(note, targetParameters.cutEnabled ? 1 : 0);
+
+        // With nothing sounding there is nothing to glide between
+        if (! sampler.hasSoundingVoices())
+            currentParameters = targetParameters;
     }
 
     buffer.clear(); // Clear the buffer before rendering
 
+    auto renderStart = juce::Time::getHighResolutionTicks();
+
     // Render audio from the sampler
-    sampler.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+    renderSampler(buffer, midiMessages);
+    saturator.process(buffer, buffer.getNumSamples());
+
+    shedVoicesIfOverBudget(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - renderStart),
+                           buffer.getNumSamples());
+}
+
+void NewProjectAudioProcessor::renderSampler (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    auto numSamples = buffer.getNumSamples();
+
+    if (isSameEnvelope(currentParameters.envelope, targetParameters.envelope))
+    {
+        sampler.setADSRParameters(currentParameters.envelope);
+        sampler.renderNextBlock(buffer, midiMessages, 0, numSamples);
+        return;
+    }
+
+    // Glide the envelope settings across the block in short steps, so that
+    // automation doesn't jump at the boundaries of large host buffers. Notes
+    // starting mid-block get the settings of the step they start in.
+    for (int start = 0; start < numSamples; start += parameterStepSize)
+    {
+        auto numThisTime = juce::jmin(parameterStepSize, numSamples - start);
+        auto proportion = (float) (start + numThisTime) / (float) numSamples;
+
+        sampler.setADSRParameters(interpolateEnvelope(currentParameters.envelope, targetParameters.envelope, proportion));
+        sampler.renderNextBlock(buffer, midiMessages, start, numThisTime);
+    }
+
+    currentParameters = targetParameters;
+}
+
+void NewProjectAudioProcessor::shedVoicesIfOverBudget (double renderSeconds, int numSamples)
+{
+    auto budget = cpuBudget.load();
+
+    if (budget <= 0.0f || numSamples <= 0 || getSampleRate() <= 0.0)
+        return;
+
+    // Smooth the measurement so one slow block (a page fault, a context
+    // switch) doesn't cost any voices
+    auto load = renderSeconds * getSampleRate() / numSamples;
+    renderLoad += 0.2 * (load - renderLoad);
+
+    // Fade out an eighth of the sounding voices, the least audible first,
+    // and look again next block
+    if (renderLoad > budget)
+        sampler.chokeQuietestVoices(juce::jmax(1, sampler.getNumSoundingVoices() / 8));
 }
 
 //==============================================================================
@@ -390,76 +335,328 @@ juce::AudioProcessorEditor* NewProjectAudioProcessor::createEditor()
 //==============================================================================
 void NewProjectAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // Save your plugin's parameters here
+    juce::ValueTree state(stateType);
+    state.appendChild(apvts.copyState(), nullptr);
+
+    if (currentSampleName.isNotEmpty())
+    {
+        // The root note and gain let another machine play the sample in tune
+        // and at the right level before its library has analysed it
+        auto rootNote = restoredRootNote;
+        auto gain = restoredGain;
+        SampleLibrary::Entry entry;
+
+        if (library->findEntry(currentSampleFile, entry))
+        {
+            rootNote = entry.getRootNote();
+            gain = entry.getNormalisationGain();
+        }
+
+        juce::ValueTree sample(sampleType);
+        sample.setProperty("name", currentSampleName, nullptr);
+        sample.setProperty("path", currentSampleFile.getFullPathName(), nullptr);
+        sample.setProperty("rootNote", rootNote, nullptr);
+        sample.setProperty("gain", gain, nullptr);
+        state.appendChild(sample, nullptr);
+    }
+
     juce::MemoryOutputStream stream(destData, true);
-    apvts.state.writeToStream(stream);
+    stream.writeInt(stateTag);
+    stream.writeInt(stateVersion);
+
+    juce::GZIPCompressorOutputStream compressor(stream);
+    state.writeToStream(compressor);
 }
 
 void NewProjectAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // Restore your plugin's parameters here
-    juce::ValueTree tree = juce::ValueTree::readFromData(data, sizeInBytes);
+    juce::MemoryInputStream stream(data, (size_t) sizeInBytes, false);
+
+    // Older state is the bare parameter tree, with no sample in it
+    if (sizeInBytes < 8 || stream.readInt() != stateTag)
+    {
+        restoreParameters(juce::ValueTree::readFromData(data, (size_t) sizeInBytes));
+        return;
+    }
+
+    stream.readInt(); // Format version; every version so far reads the same way
+
+    juce::GZIPDecompressorInputStream decompressor(stream);
+    auto state = juce::ValueTree::readFromStream(decompressor);
+
+    if (! state.hasType(stateType))
+        return;
+
+    restoreParameters(state.getChildWithName(apvts.state.getType()));
+
+    auto sample = state.getChildWithName(sampleType);
+
+    if (sample.isValid())
+        restoreSample(sample.getProperty("name").toString(),
+                      juce::File(sample.getProperty("path").toString()),
+                      juce::jlimit(0, 127, (int) sample.getProperty("rootNote", 60)),
+                      (float) sample.getProperty("gain", 1.0f));
+}
+
+void NewProjectAudioProcessor::restoreParameters (const juce::ValueTree& tree)
+{
     if (tree.isValid())
     {
-        apvts.state = tree;
+        // A copy, so the state keeps no parent in the tree it came from
+        apvts.replaceState(tree.createCopy());
+        updateLoaderSettings();
+        updateVoiceSettings();
     }
 }
 
-//==============================================================================
-juce::StringArray NewProjectAudioProcessor::getSampleNames() const
+void NewProjectAudioProcessor::restoreSample (const juce::String& sampleName, const juce::File& savedFile,
+                                              int rootNote, float gain)
 {
-    juce::StringArray names;
+    // A sample of the same name in this machine's folder wins over the saved
+    // path, which may be another machine's. Only the index is asked, so
+    // nothing here touches the disk; the loader thread does the reading.
+    auto file = savedFile;
 
-    for (auto& file : sampleFiles)
+    for (auto& candidate : library->getFiles(samplesDirectory))
     {
-        names.add(file.getFileNameWithoutExtension());
+        if (candidate.getFileNameWithoutExtension() == sampleName)
+        {
+            file = candidate;
+            break;
+        }
     }
 
-    return names;
+    restoredRootNote = rootNote;
+    restoredGain = gain;
+    currentSampleName = sampleName;
+    currentSampleFile = file;
+    sampleLoader.loadSample(file, rootNote, gain);
 }
 
-void NewProjectAudioProcessor::loadSample (const juce::String& sampleName)
+//==============================================================================
+juce::StringArray NewProjectAudioProcessor::getSampleNames() const
 {
-    // Stop all voices immediately
-    sampler.allNotesOff(0, true); // Force immediate stop
-
-    // Clear existing sounds
-    sampler.clearSounds();
+    return library->getNames(samplesDirectory);
+}
 
-    // Find the sample file by name
-    for (auto& file : sampleFiles)
+void NewProjectAudioProcessor::loadSample (const juce::String& sampleName)
+{
+    // Find the sample file by name and let the loader thread decode it. The
+    // audio thread swaps it in at the next block; notes that are already
+    // sounding carry on with the previous sample until they finish.
+    for (auto& file : library->getFiles(samplesDirectory))
     {
         if (file.getFileNameWithoutExtension() == sampleName)
         {
-            std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+            sampleLoader.loadSample(file);
+            currentSampleName = sampleName;
+            currentSampleFile = file;
+            break;
+        }
+    }
+}
 
-            if (reader.get() != nullptr)
-            {
-                juce::BigInteger midiNotes;
-                midiNotes.setRange(0, 128, true); // Respond to all MIDI notes
+void NewProjectAudioProcessor::setSamplesDirectory (const juce::File& directory)
+{
+    samplesDirectory = directory;
+    library->refresh(samplesDirectory);
 
-                auto duration = static_cast<float>(reader->lengthInSamples) / reader->sampleRate;
+    // Bank mode preloads from the file list, so it needs the new one
+    updateLoaderSettings();
+}
 
-                // Create a MySamplerSound instance
-                MySamplerSound* sound = new MySamplerSound(
-                    file.getFileNameWithoutExtension(),
-                    *reader,
-                    midiNotes,
-                    60,    // MIDI root note (middle C)
-                    0.0,   // Attack time
-                    0.1,   // Release time
-                    duration
-                );
+bool NewProjectAudioProcessor::hasFinishedLoadingSample() const
+{
+    return sampleLoader.hasFinishedLoading();
+}
 
-                // Add the sound to the sampler
-                sampler.addSound(sound);
+bool NewProjectAudioProcessor::hasSoundingVoices() const
+{
+    return sampler.hasSoundingVoices();
+}
 
-                currentSampleName = sampleName;
-            }
+int NewProjectAudioProcessor::getNumSoundingVoices() const
+{
+    return sampler.getNumSoundingVoices();
+}
 
-            break;
-        }
-    }
+void NewProjectAudioProcessor::setBankModeEnabled (bool shouldBeEnabled)
+{
+    apvts.state.setProperty("bankMode", shouldBeEnabled, nullptr);
+    updateLoaderSettings();
+}
+
+bool NewProjectAudioProcessor::isBankModeEnabled() const
+{
+    return apvts.state.getProperty("bankMode", false);
+}
+
+void NewProjectAudioProcessor::setBankMemoryBudget (int megabytes)
+{
+    apvts.state.setProperty("bankMemoryMB", megabytes, nullptr);
+    updateLoaderSettings();
+}
+
+void NewProjectAudioProcessor::setStreamingEnabled (bool shouldBeEnabled)
+{
+    apvts.state.setProperty("streamMode", shouldBeEnabled, nullptr);
+    updateLoaderSettings();
+}
+
+bool NewProjectAudioProcessor::isStreamingEnabled() const
+{
+    return apvts.state.getProperty("streamMode", false);
+}
+
+void NewProjectAudioProcessor::setStreamingHeadLength (int milliseconds)
+{
+    apvts.state.setProperty("streamHeadMs", milliseconds, nullptr);
+    updateLoaderSettings();
+}
+
+void NewProjectAudioProcessor::setCompactStorageEnabled (bool shouldBeEnabled)
+{
+    apvts.state.setProperty("compactStorage", shouldBeEnabled, nullptr);
+    updateLoaderSettings();
+}
+
+bool NewProjectAudioProcessor::isCompactStorageEnabled() const
+{
+    return apvts.state.getProperty("compactStorage", false);
+}
+
+void NewProjectAudioProcessor::setPitchCacheEnabled (bool shouldBeEnabled)
+{
+    apvts.state.setProperty("pitchCache", shouldBeEnabled, nullptr);
+    updateLoaderSettings();
+}
+
+bool NewProjectAudioProcessor::isPitchCacheEnabled() const
+{
+    return apvts.state.getProperty("pitchCache", false);
+}
+
+void NewProjectAudioProcessor::setPitchCacheMemoryBudget (int megabytes)
+{
+    apvts.state.setProperty("pitchCacheMB", megabytes, nullptr);
+    updateLoaderSettings();
+}
+
+void NewProjectAudioProcessor::setLaneRenderingEnabled (bool shouldBeEnabled)
+{
+    apvts.state.setProperty("laneEngine", shouldBeEnabled, nullptr);
+    updateVoiceSettings();
+}
+
+bool NewProjectAudioProcessor::isLaneRenderingEnabled() const
+{
+    return apvts.state.getProperty("laneEngine", false);
+}
+
+void NewProjectAudioProcessor::setVoiceThreadingEnabled (bool shouldBeEnabled)
+{
+    apvts.state.setProperty("voiceThreads", shouldBeEnabled, nullptr);
+    updateVoiceSettings();
+}
+
+bool NewProjectAudioProcessor::isVoiceThreadingEnabled() const
+{
+    return apvts.state.getProperty("voiceThreads", false);
+}
+
+void NewProjectAudioProcessor::setStealPolicy (int policy)
+{
+    apvts.state.setProperty("stealPolicy", policy, nullptr);
+    updateVoiceSettings();
+}
+
+int NewProjectAudioProcessor::getStealPolicy() const
+{
+    return apvts.state.getProperty("stealPolicy", (int) MySynthesiser::stealOldest);
+}
+
+void NewProjectAudioProcessor::setPolyphonyLimit (int numVoicesToAllow)
+{
+    apvts.state.setProperty("polyphony", numVoicesToAllow, nullptr);
+    updateVoiceSettings();
+}
+
+void NewProjectAudioProcessor::setCpuBudget (int percentOfRealTime)
+{
+    apvts.state.setProperty("cpuBudgetPercent", percentOfRealTime, nullptr);
+    updateVoiceSettings();
+}
+
+void NewProjectAudioProcessor::setNormalisingEnabled (bool shouldBeEnabled)
+{
+    apvts.state.setProperty("normalise", shouldBeEnabled, nullptr);
+    updateVoiceSettings();
+}
+
+bool NewProjectAudioProcessor::isNormalisingEnabled() const
+{
+    return apvts.state.getProperty("normalise", true);
+}
+
+void NewProjectAudioProcessor::setOversampling (int numStages)
+{
+    apvts.state.setProperty("oversampling", numStages, nullptr);
+    updateVoiceSettings();
+}
+
+int NewProjectAudioProcessor::getOversampling() const
+{
+    return juce::jlimit(0, BusSaturator::maxOversamplingStages, (int) apvts.state.getProperty("oversampling", 0));
+}
+
+void NewProjectAudioProcessor::updateVoiceSettings()
+{
+    sampler.setLaneRenderingEnabled(isLaneRenderingEnabled());
+    sampler.setVoiceThreadingEnabled(isVoiceThreadingEnabled());
+    sampler.setStealPolicy((MySynthesiser::StealPolicy) juce::jlimit(0, 2, getStealPolicy()));
+    sampler.setPolyphonyLimit(juce::jlimit(1, numVoices, (int) apvts.state.getProperty("polyphony", numVoices)));
+    sampler.setNormalisingEnabled(isNormalisingEnabled());
+
+    auto budgetPercent = (int) apvts.state.getProperty("cpuBudgetPercent", 0);
+    cpuBudget = juce::jlimit(0, 100, budgetPercent) / 100.0f;
+
+    // Hosts pick up the new latency when it changes, which most do at once
+    saturator.setOversamplingStages(getOversampling());
+    setLatencySamples(BusSaturator::getLatencySamples(getOversampling()));
+}
+
+void NewProjectAudioProcessor::changeListenerCallback (juce::ChangeBroadcaster* /*source*/)
+{
+    // A folder's contents changed. Bank mode preloads from the file list,
+    // and an instance that found nothing to play when it started can now
+    // load its default sample.
+    if (isBankModeEnabled())
+        updateLoaderSettings();
+
+    auto sampleFiles = library->getFiles(samplesDirectory);
+
+    if (currentSampleName.isEmpty() && getSampleRate() > 0.0 && sampleFiles.size() > 0)
+        loadSample(sampleFiles[0].getFileNameWithoutExtension());
+}
+
+void NewProjectAudioProcessor::updateLoaderSettings()
+{
+    auto megabytes = (int) apvts.state.getProperty("bankMemoryMB", defaultBankMemoryMB);
+
+    sampleLoader.setCompactStorage(isCompactStorageEnabled());
+    sampleLoader.setBankMode(isBankModeEnabled(),
+                             (size_t) juce::jmax(0, megabytes) * 1024 * 1024,
+                             library->getFiles(samplesDirectory));
+
+    // The ring buffers must exist before the loader creates a streaming sound
+    if (isStreamingEnabled())
+        prefetcher.prepare();
+
+    auto headMs = (int) apvts.state.getProperty("streamHeadMs", defaultStreamingHeadMs);
+    sampleLoader.setStreamingMode(isStreamingEnabled(), juce::jmax(1, headMs) / 1000.0);
+
+    auto cacheMegabytes = (int) apvts.state.getProperty("pitchCacheMB", defaultPitchCacheMB);
+    pitchCache.setEnabled(isPitchCacheEnabled(), (size_t) juce::jmax(0, cacheMegabytes) * 1024 * 1024);
 }
 
 // Create parameter layout
@@ -472,9 +669,31 @@ juce::AudioProcessorValueTreeState::ParameterLayout NewProjectAudioProcessor::cr
     params.push_back(std::make_unique<juce::AudioParameterFloat>("envSustain", "Sustain", 0.0f, 1.0f, 0.8f));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("envRelease", "Release", 0.01f, 5.0f, 0.5f));
 
+    // Straight envelope segments, or curves that fall away quickly and then
+    // settle like a real 808's decay
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("envCurve", "Envelope Curve",
+                                                                  juce::StringArray { "Linear", "Exponential" }, 0));
+
     // Add the Cut parameter
     params.push_back(std::make_unique<juce::AudioParameterBool>("cutEnabled", "Cut", false));
 
+    // Resampling quality: cheap for tracking, clean for bounces
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("quality", "Quality",
+                                                                  juce::StringArray { "Linear", "Hermite", "Sinc" }, 0));
+
+    // Pitch: how long notes take to slide between pitches, the pitch wheel's
+    // range in semitones, and mono legato for sliding 808s
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("glide", "Glide",
+                                                                 juce::NormalisableRange<float>(0.0f, 2.0f, 0.0f, 0.4f), 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterInt>("bendRange", "Bend Range", 1, 24, 2));
+    params.push_back(std::make_unique<juce::AudioParameterBool>("legato", "Legato", false));
+
+    // Saturation on the summed output: how hard it is driven, and the curve
+    // it is driven into. Off leaves the signal untouched.
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("drive", "Drive", 0.0f, 24.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("clipCurve", "Curve",
+                                                                  juce::StringArray { "Off", "Soft", "Tape", "Hard" }, 0));
+
     return { params.begin(), params.end() };
 }
 
@@ -7,13 +7,20 @@
 #pragma once
 
 #include <JuceHeader.h>
-
-// No forward declarations needed since we'll define classes in the .cpp file
+#include "MySampler.h"
+#include "SampleLoader.h"
+#include "SampleLibrary.h"
+#include "SamplePrefetcher.h"
+#include "PitchCache.h"
+#include "ParameterSnapshot.h"
+#include "BusSaturator.h"
+#include "RealtimeSafety.h"
 
 //==============================================================================
 /**
 */
-class NewProjectAudioProcessor  : public juce::AudioProcessor
+class NewProjectAudioProcessor  : public juce::AudioProcessor,
+                                  private juce::ChangeListener
 {
 public:
     //==============================================================================
@@ -23,6 +30,7 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -50,6 +58,11 @@ public:
     void changeProgramName (int index, const juce::String& newName) override;
 
     //==============================================================================
+    // The state is a short header (a tag and a format version) followed by a
+    // compressed tree holding the parameters, the settings and the current
+    // sample's name, path, root note and gain. Restoring it only queues the
+    // sample on the loader thread, so the host's thread never waits on disk.
+    // State saved before the header existed still loads.
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
@@ -58,6 +71,76 @@ public:
 
     // Method to load a sample by name
     void loadSample (const juce::String& sampleName);
+    const juce::String& getCurrentSampleName() const noexcept      { return currentSampleName; }
+
+    // Looks for samples somewhere other than the user's Music folder. The
+    // folder is indexed before this returns.
+    void setSamplesDirectory (const juce::File& directory);
+    const juce::File& getSamplesDirectory() const noexcept          { return samplesDirectory; }
+
+    // The index of the sample folders, shared by every instance. It
+    // broadcasts a change whenever a folder's contents change.
+    SampleLibrary& getSampleLibrary() const noexcept                { return *library; }
+
+    // True once the sample asked for by the last loadSample call has been
+    // decoded; the next processBlock then plays it
+    bool hasFinishedLoadingSample() const;
+
+    // True while any note is still sounding, including release tails
+    bool hasSoundingVoices() const;
+    int getNumSoundingVoices() const;
+
+    // Bank mode keeps every file in the samples folder decoded in memory so
+    // switching samples never touches the disk
+    void setBankModeEnabled (bool shouldBeEnabled);
+    bool isBankModeEnabled() const;
+    void setBankMemoryBudget (int megabytes);
+
+    // Streaming mode keeps only the start of each sample in memory and reads
+    // the rest from disk while it plays
+    void setStreamingEnabled (bool shouldBeEnabled);
+    bool isStreamingEnabled() const;
+    void setStreamingHeadLength (int milliseconds);
+
+    // Compact storage keeps samples as 16-bit data, and dual-mono files as
+    // one channel, for a half to a quarter of the memory
+    void setCompactStorageEnabled (bool shouldBeEnabled);
+    bool isCompactStorageEnabled() const;
+
+    // The pitch cache renders each note of the current sample in advance on
+    // a background thread, so voices can play it back without resampling
+    void setPitchCacheEnabled (bool shouldBeEnabled);
+    bool isPitchCacheEnabled() const;
+    void setPitchCacheMemoryBudget (int megabytes);
+
+    // The lane engine renders resident voices four at a time across SIMD
+    // lanes, which pays off when many notes are sounding together
+    void setLaneRenderingEnabled (bool shouldBeEnabled);
+    bool isLaneRenderingEnabled() const;
+
+    // Voice threads share the voices of large blocks with a few worker
+    // threads. The output is bit-identical to rendering them one by one.
+    void setVoiceThreadingEnabled (bool shouldBeEnabled);
+    bool isVoiceThreadingEnabled() const;
+
+    // Voice allocation: which note is taken over when the limit is reached,
+    // how many notes may sound at once, and an optional CPU budget (as a
+    // percentage of real time, 0 for none) above which the least audible
+    // voices are faded out
+    void setStealPolicy (int policy);
+    int getStealPolicy() const;
+    void setPolyphonyLimit (int numVoicesToAllow);
+    void setCpuBudget (int percentOfRealTime);
+
+    // Plays each sample at the loudness the library measured for it, so
+    // 808s from different packs come out at the same level
+    void setNormalisingEnabled (bool shouldBeEnabled);
+    bool isNormalisingEnabled() const;
+
+    // Runs the Drive and Curve stage at 1x, 2x or 4x the host rate (0, 1 or
+    // 2). Oversampling delays the output, which is reported to the host.
+    void setOversampling (int numStages);
+    int getOversampling() const;
 
     // AudioProcessorValueTreeState for parameter management
     juce::AudioProcessorValueTreeState apvts;
@@ -68,23 +151,87 @@ public:
 
 private:
     //==============================================================================
+    // Number of voices in the sampler
+    static constexpr int numVoices = 64;
+    static_assert (numVoices <= VoiceLanes::maxLanes, "Every voice needs its own lane");
+
+    // Feeds voices that play streaming sounds; must outlive the voices
+    SamplePrefetcher prefetcher { numVoices };
+
+    // Pre-pitched copies of the current sound; must outlive the voices
+    PitchCache pitchCache;
+
     // Synthesiser for playing samples
-    juce::Synthesiser sampler;
+    MySynthesiser sampler;
 
     // Format manager to handle audio formats
     juce::AudioFormatManager formatManager;
 
+    // Index of the available sample files, shared with other instances
+    juce::SharedResourcePointer<SampleLibrary> library;
+
+    // Decodes samples off the audio and message threads
+    SampleLoader sampleLoader { formatManager, *library };
+
+    // Whether this instance hears about changes to the library's file lists
+    bool listeningToLibrary = false;
+
     // Path to the samples directory
     juce::File samplesDirectory;
 
-    // Available sample files
-    juce::Array<juce::File> sampleFiles;
-
     // Currently loaded sample
     juce::String currentSampleName;
+    juce::File currentSampleFile;
 
-    // Number of voices in the sampler
-    static constexpr int numVoices = 64;
+    // Root note and gain saved with a restored sample, used until this
+    // machine's library has analysed the file
+    int restoredRootNote = 60;
+    float restoredGain = 1.0f;
+
+    // Drive and clipping on the summed output of every voice
+    BusSaturator saturator;
+
+    // Envelope and Cut settings, re-read only when one of them changes
+    ParameterSnapshot parameters { apvts };
+    int parameterVersion = -1;
+    ParameterSnapshot::Values currentParameters, targetParameters;
+
+    // Envelope changes are spread over a block in steps of this many samples
+    static constexpr int parameterStepSize = 32;
+
+    // Default memory budget for bank mode, enough for the bundled 808s
+    static constexpr int defaultBankMemoryMB = 32;
+
+    // Default resident length of each sample in streaming mode
+    static constexpr int defaultStreamingHeadMs = 250;
+
+    // Default memory budget for the pitch cache, a few dozen notes' worth
+    static constexpr int defaultPitchCacheMB = 64;
+
+    void restoreParameters (const juce::ValueTree& tree);
+    void restoreSample (const juce::String& sampleName, const juce::File& savedFile, int rootNote, float gain);
+
+    // Pushes the bank and streaming settings stored in the state to the loader
+    void updateLoaderSettings();
+    void updateVoiceSettings();
+
+    void changeListenerCallback (juce::ChangeBroadcaster* source) override;
+
+    void renderSampler (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
+    void shedVoicesIfOverBudget (double renderSeconds, int numSamples);
+
+    // CPU budget as a proportion of the block's duration, 0 when off, and a
+    // smoothed measurement of the sampler's share of it
+    std::atomic<float> cpuBudget { 0.0f };
+    double renderLoad = 0.0;
+
+    // Release time used while Cut is on
+    static constexpr float cutReleaseSeconds = 0.01f; // 10 milliseconds
+
+    // How long the current sample can sound before it falls silent, played
+    // at the lowest note. Written by the audio thread and read by
+    // getTailLengthSeconds.
+    std::atomic<float> longestNoteSeconds { 0.0f };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NewProjectAudioProcessor)
 };
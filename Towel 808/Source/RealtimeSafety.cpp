@@ -0,0 +1,450 @@
+/*
+  ==============================================================================
+    Debug checker for allocations, locks and blocking calls on the audio thread.
+  ==============================================================================
+*/
+
+#include "RealtimeSafety.h"
+
+#if TOWEL808_RT_CHECKS
+
+#if ! (JUCE_MAC || JUCE_LINUX)
+ #error "TOWEL808_RT_CHECKS is only supported on macOS and Linux"
+#endif
+
+#include <new>
+#include <cstdarg>
+#include <cstddef>
+#include <execinfo.h>
+
+#if JUCE_LINUX && defined (__GLIBC__)
+ #include <dlfcn.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <stdio.h>
+ #include <time.h>
+ #include <unistd.h>
+ #define TOWEL808_RT_HOOK_LIBC 1
+#else
+ #define TOWEL808_RT_HOOK_LIBC 0
+#endif
+
+namespace
+{
+    constexpr int maxViolations = 256;
+    constexpr int maxFrames = 32;
+
+    // Entries are claimed with a fetch_add and published with their flag, so
+    // any number of audio threads can record at once without a lock
+    struct Entry
+    {
+        std::atomic<bool> ready { false };
+        RealtimeSafety::Kind kind = RealtimeSafety::Kind::allocation;
+        int numFrames = 0;
+        void* frames[maxFrames];
+    };
+
+    Entry entries[maxViolations];
+    std::atomic<int> numRecorded { 0 };
+
+    // Plain thread_locals in the executable need no allocation to access,
+    // so they are safe to read from inside malloc
+    thread_local int realtimeDepth = 0;
+    thread_local int uncontendedLocksAllowedDepth = 0;
+    thread_local bool insideHook = false;
+
+    // Critical sections whose uncontended locks aren't recorded. Slots are
+    // claimed with a compare-and-swap, so registering one never locks.
+    constexpr int maxAllowedLocks = 64;
+    std::atomic<const void*> allowedLocks[maxAllowedLocks] {};
+
+    // Stops the hooks reporting the calls they make themselves
+    struct HookGuard
+    {
+        HookGuard() noexcept : wasInside (insideHook)   { insideHook = true; }
+        ~HookGuard() noexcept                           { insideHook = wasInside; }
+
+        bool wasInside;
+    };
+
+    bool shouldRecord() noexcept
+    {
+        return realtimeDepth > 0 && ! insideHook;
+    }
+
+    void record (RealtimeSafety::Kind kind) noexcept
+    {
+        if (! shouldRecord())
+            return;
+
+        HookGuard guard;
+        auto index = numRecorded.fetch_add (1);
+
+        if (index >= maxViolations)
+            return;
+
+        auto& entry = entries[index];
+        entry.kind = kind;
+        entry.numFrames = backtrace (entry.frames, maxFrames);
+        entry.ready.store (true, std::memory_order_release);
+    }
+
+    // The first backtrace() call loads the unwinder, which allocates, so get
+    // that out of the way before any audio thread exists
+    [[maybe_unused]] const bool unwinderLoaded = []
+    {
+        void* frame[1];
+        return backtrace (frame, 1) >= 0;
+    }();
+
+    void* allocate (std::size_t size, std::size_t alignment)
+    {
+        record (RealtimeSafety::Kind::allocation);
+        HookGuard guard;
+
+        void* pointer = nullptr;
+
+        if (alignment <= alignof (std::max_align_t))
+            pointer = std::malloc (size != 0 ? size : 1);
+        else if (posix_memalign (&pointer, alignment, size != 0 ? size : 1) != 0)
+            pointer = nullptr;
+
+        if (pointer == nullptr)
+            throw std::bad_alloc();
+
+        return pointer;
+    }
+
+    void deallocate (void* pointer) noexcept
+    {
+        if (pointer != nullptr)
+            record (RealtimeSafety::Kind::deallocation);
+
+        HookGuard guard;
+        std::free (pointer);
+    }
+}
+
+//==============================================================================
+RealtimeSafety::ScopedAudioThread::ScopedAudioThread() noexcept     { ++realtimeDepth; }
+RealtimeSafety::ScopedAudioThread::~ScopedAudioThread() noexcept    { --realtimeDepth; }
+
+RealtimeSafety::ScopedUncontendedLocksAllowed::ScopedUncontendedLocksAllowed() noexcept     { ++uncontendedLocksAllowedDepth; }
+RealtimeSafety::ScopedUncontendedLocksAllowed::~ScopedUncontendedLocksAllowed() noexcept    { --uncontendedLocksAllowedDepth; }
+
+void RealtimeSafety::allowUncontendedLocks (const juce::CriticalSection& lock) noexcept
+{
+    // With every slot taken the lock is simply always recorded
+    for (auto& slot : allowedLocks)
+    {
+        const void* expected = nullptr;
+
+        if (slot.compare_exchange_strong (expected, &lock))
+            return;
+    }
+}
+
+void RealtimeSafety::disallowUncontendedLocks (const juce::CriticalSection& lock) noexcept
+{
+    for (auto& slot : allowedLocks)
+    {
+        const void* expected = &lock;
+
+        if (slot.compare_exchange_strong (expected, nullptr))
+            return;
+    }
+}
+
+int RealtimeSafety::getNumViolations() noexcept
+{
+    return numRecorded.load();
+}
+
+juce::Array<RealtimeSafety::Violation> RealtimeSafety::getViolations()
+{
+    juce::Array<Violation> violations;
+    auto numEntries = juce::jmin (maxViolations, numRecorded.load());
+
+    for (int i = 0; i < numEntries; ++i)
+    {
+        auto& entry = entries[i];
+
+        if (! entry.ready.load (std::memory_order_acquire))
+            continue;
+
+        juce::String stackTrace;
+
+        if (auto** symbols = backtrace_symbols (entry.frames, entry.numFrames))
+        {
+            for (int frame = 0; frame < entry.numFrames; ++frame)
+                stackTrace << "  " << symbols[frame] << juce::newLine;
+
+            std::free (symbols);
+        }
+
+        violations.add ({ entry.kind, stackTrace });
+    }
+
+    return violations;
+}
+
+void RealtimeSafety::clearViolations() noexcept
+{
+    for (auto& entry : entries)
+        entry.ready = false;
+
+    numRecorded = 0;
+}
+
+//==============================================================================
+void* operator new (std::size_t size)                                      { return allocate (size, 0); }
+void* operator new[] (std::size_t size)                                    { return allocate (size, 0); }
+void* operator new (std::size_t size, std::align_val_t alignment)          { return allocate (size, (std::size_t) alignment); }
+void* operator new[] (std::size_t size, std::align_val_t alignment)        { return allocate (size, (std::size_t) alignment); }
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate (size, 0); } catch (...) { return nullptr; }
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate (size, 0); } catch (...) { return nullptr; }
+}
+
+void operator delete (void* pointer) noexcept                                           { deallocate (pointer); }
+void operator delete[] (void* pointer) noexcept                                         { deallocate (pointer); }
+void operator delete (void* pointer, std::size_t) noexcept                              { deallocate (pointer); }
+void operator delete[] (void* pointer, std::size_t) noexcept                            { deallocate (pointer); }
+void operator delete (void* pointer, std::align_val_t) noexcept                         { deallocate (pointer); }
+void operator delete[] (void* pointer, std::align_val_t) noexcept                       { deallocate (pointer); }
+void operator delete (void* pointer, std::size_t, std::align_val_t) noexcept            { deallocate (pointer); }
+void operator delete[] (void* pointer, std::size_t, std::align_val_t) noexcept          { deallocate (pointer); }
+void operator delete (void* pointer, const std::nothrow_t&) noexcept                    { deallocate (pointer); }
+void operator delete[] (void* pointer, const std::nothrow_t&) noexcept                  { deallocate (pointer); }
+
+//==============================================================================
+#if TOWEL808_RT_HOOK_LIBC
+
+// Definitions in the executable take precedence over the C library's, which
+// the hooks then forward to. glibc exports its allocator under __libc_ names;
+// everything else is looked up once with RTLD_NEXT.
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void __libc_free (void*);
+
+    void* malloc (size_t size) noexcept
+    {
+        record (RealtimeSafety::Kind::allocation);
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t numElements, size_t elementSize) noexcept
+    {
+        record (RealtimeSafety::Kind::allocation);
+        return __libc_calloc (numElements, elementSize);
+    }
+
+    void* realloc (void* pointer, size_t size) noexcept
+    {
+        record (RealtimeSafety::Kind::allocation);
+        return __libc_realloc (pointer, size);
+    }
+
+    void free (void* pointer) noexcept
+    {
+        if (pointer != nullptr)
+            record (RealtimeSafety::Kind::deallocation);
+
+        __libc_free (pointer);
+    }
+}
+
+namespace
+{
+    template <typename Function>
+    Function findNext (Function& cached, const char* name) noexcept
+    {
+        // Racing threads all store the same address, so no lock is needed
+        if (cached == nullptr)
+            cached = reinterpret_cast<Function> (dlsym (RTLD_NEXT, name));
+
+        return cached;
+    }
+
+    // glibc also exports its pre-2.3.2 condition variable under the same
+    // names, and an unversioned lookup can return that one
+    template <typename Function>
+    Function findNextCondition (Function& cached, const char* name) noexcept
+    {
+        if (cached == nullptr)
+        {
+            auto* symbol = dlvsym (RTLD_NEXT, name, "GLIBC_2.3.2");
+            cached = reinterpret_cast<Function> (symbol != nullptr ? symbol : dlsym (RTLD_NEXT, name));
+        }
+
+        return cached;
+    }
+
+    // A juce::CriticalSection is nothing but its pthread mutex here, so the
+    // two share an address
+    static_assert (sizeof (juce::CriticalSection) == sizeof (pthread_mutex_t),
+                   "juce::CriticalSection is expected to wrap a single pthread_mutex_t");
+
+    bool areUncontendedLocksAllowed (const pthread_mutex_t* mutex) noexcept
+    {
+        if (uncontendedLocksAllowedDepth > 0)
+            return true;
+
+        for (auto& slot : allowedLocks)
+            if (slot.load (std::memory_order_acquire) == mutex)
+                return true;
+
+        return false;
+    }
+
+    int (*nextMutexLock) (pthread_mutex_t*) = nullptr;
+    int (*nextCondSignal) (pthread_cond_t*) = nullptr;
+    int (*nextCondBroadcast) (pthread_cond_t*) = nullptr;
+    int (*nextCondWait) (pthread_cond_t*, pthread_mutex_t*) = nullptr;
+    int (*nextCondTimedWait) (pthread_cond_t*, pthread_mutex_t*, const timespec*) = nullptr;
+   #if __GLIBC_PREREQ (2, 30)
+    int (*nextCondClockWait) (pthread_cond_t*, pthread_mutex_t*, clockid_t, const timespec*) = nullptr;
+   #endif
+    int (*nextNanosleep) (const timespec*, timespec*) = nullptr;
+    int (*nextUsleep) (useconds_t) = nullptr;
+    int (*nextOpen) (const char*, int, ...) = nullptr;
+    FILE* (*nextFopen) (const char*, const char*) = nullptr;
+    ssize_t (*nextRead) (int, void*, size_t) = nullptr;
+    ssize_t (*nextWrite) (int, const void*, size_t) = nullptr;
+}
+
+extern "C"
+{
+    int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept
+    {
+        if (shouldRecord())
+        {
+            // An allowed lock can only stall the audio thread when another
+            // thread already holds it
+            if (areUncontendedLocksAllowed (mutex) && pthread_mutex_trylock (mutex) == 0)
+                return 0;
+
+            record (RealtimeSafety::Kind::lock);
+        }
+
+        return findNext (nextMutexLock, "pthread_mutex_lock") (mutex);
+    }
+
+    int pthread_cond_signal (pthread_cond_t* condition) noexcept
+    {
+        record (RealtimeSafety::Kind::conditionVariable);
+        return findNextCondition (nextCondSignal, "pthread_cond_signal") (condition);
+    }
+
+    int pthread_cond_broadcast (pthread_cond_t* condition) noexcept
+    {
+        record (RealtimeSafety::Kind::conditionVariable);
+        return findNextCondition (nextCondBroadcast, "pthread_cond_broadcast") (condition);
+    }
+
+    int pthread_cond_wait (pthread_cond_t* condition, pthread_mutex_t* mutex)
+    {
+        record (RealtimeSafety::Kind::conditionVariable);
+        return findNextCondition (nextCondWait, "pthread_cond_wait") (condition, mutex);
+    }
+
+    int pthread_cond_timedwait (pthread_cond_t* condition, pthread_mutex_t* mutex, const timespec* deadline)
+    {
+        record (RealtimeSafety::Kind::conditionVariable);
+        return findNextCondition (nextCondTimedWait, "pthread_cond_timedwait") (condition, mutex, deadline);
+    }
+
+   #if __GLIBC_PREREQ (2, 30)
+    // What std::condition_variable uses for timed waits on newer systems
+    int pthread_cond_clockwait (pthread_cond_t* condition, pthread_mutex_t* mutex, clockid_t clock, const timespec* deadline)
+    {
+        record (RealtimeSafety::Kind::conditionVariable);
+        return findNextCondition (nextCondClockWait, "pthread_cond_clockwait") (condition, mutex, clock, deadline);
+    }
+   #endif
+
+    int nanosleep (const timespec* duration, timespec* remaining)
+    {
+        record (RealtimeSafety::Kind::sleep);
+        return findNext (nextNanosleep, "nanosleep") (duration, remaining);
+    }
+
+    int usleep (useconds_t microseconds)
+    {
+        record (RealtimeSafety::Kind::sleep);
+        return findNext (nextUsleep, "usleep") (microseconds);
+    }
+
+    int open (const char* path, int flags, ...)
+    {
+        record (RealtimeSafety::Kind::fileAccess);
+
+        mode_t mode = 0;
+
+        if ((flags & O_CREAT) != 0)
+        {
+            va_list args;
+            va_start (args, flags);
+            mode = (mode_t) va_arg (args, int);
+            va_end (args);
+        }
+
+        return findNext (nextOpen, "open") (path, flags, mode);
+    }
+
+    FILE* fopen (const char* path, const char* mode)
+    {
+        record (RealtimeSafety::Kind::fileAccess);
+        return findNext (nextFopen, "fopen") (path, mode);
+    }
+
+    ssize_t read (int fileDescriptor, void* buffer, size_t numBytes)
+    {
+        record (RealtimeSafety::Kind::fileAccess);
+        return findNext (nextRead, "read") (fileDescriptor, buffer, numBytes);
+    }
+
+    ssize_t write (int fileDescriptor, const void* buffer, size_t numBytes)
+    {
+        record (RealtimeSafety::Kind::fileAccess);
+        return findNext (nextWrite, "write") (fileDescriptor, buffer, numBytes);
+    }
+}
+
+#endif // TOWEL808_RT_HOOK_LIBC
+
+#else // TOWEL808_RT_CHECKS
+
+int RealtimeSafety::getNumViolations() noexcept                     { return 0; }
+juce::Array<RealtimeSafety::Violation> RealtimeSafety::getViolations()   { return {}; }
+void RealtimeSafety::clearViolations() noexcept                     {}
+
+void RealtimeSafety::allowUncontendedLocks (const juce::CriticalSection&) noexcept       {}
+void RealtimeSafety::disallowUncontendedLocks (const juce::CriticalSection&) noexcept    {}
+
+#endif // TOWEL808_RT_CHECKS
+
+//==============================================================================
+juce::String RealtimeSafety::getKindName (Kind kind)
+{
+    switch (kind)
+    {
+        case Kind::allocation:          return "allocation";
+        case Kind::deallocation:        return "deallocation";
+        case Kind::lock:                return "lock";
+        case Kind::conditionVariable:   return "condition variable";
+        case Kind::sleep:               return "sleep";
+        case Kind::fileAccess:          return "file access";
+    }
+
+    return {};
+}
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+    Debug checker for allocations, locks and blocking calls on the audio thread.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Builds with this set to 1 replace operator new/delete and, on Linux, wrap
+// malloc, mutex lock, condition variable, sleep and file calls, so anything
+// the audio thread does that can block is logged. Leave it off in release plugin
+// builds: the hooks are process-wide and a host won't expect them.
+#ifndef TOWEL808_RT_CHECKS
+ #define TOWEL808_RT_CHECKS 0
+#endif
+
+//==============================================================================
+/**
+    Records real-time contract violations made by threads that are inside
+    processBlock.
+
+    The processor marks its audio thread with a ScopedAudioThread for the
+    length of each block. While a thread is marked, every allocation,
+    deallocation, mutex lock, condition variable call, sleep or file access
+    it makes is written with a raw stack trace to a fixed-size, lock-free
+    log. Nothing is symbolised until getViolations() is called from an
+    ordinary thread.
+
+    A few locks are taken on the audio thread by design: juce::Synthesiser
+    locks itself every block, and juce::MidiKeyboardState while it merges
+    the on-screen keyboard's notes. Those only stall the audio thread when
+    another thread is holding them, so for them only a contended lock is
+    recorded. The synthesiser's lock is registered with
+    allowUncontendedLocks(); the keyboard's isn't reachable, so its call is
+    wrapped in a ScopedUncontendedLocksAllowed instead.
+
+    Allocations are caught on every platform; the C library hooks are only
+    available on Linux with glibc.
+*/
+struct RealtimeSafety
+{
+    enum class Kind
+    {
+        allocation,
+        deallocation,
+        lock,
+        conditionVariable,
+        sleep,
+        fileAccess
+    };
+
+    struct Violation
+    {
+        Kind kind;
+        juce::String stackTrace;
+    };
+
+    // Marks the calling thread as real-time for the lifetime of the object
+    struct ScopedAudioThread
+    {
+       #if TOWEL808_RT_CHECKS
+        ScopedAudioThread() noexcept;
+        ~ScopedAudioThread() noexcept;
+       #else
+        ScopedAudioThread() noexcept {}
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedAudioThread)
+    };
+
+    // Only records locks the calling thread makes while it waits for another
+    // thread to let go, for the lifetime of the object. Keep the scope to
+    // the one call that takes an allowed lock.
+    struct ScopedUncontendedLocksAllowed
+    {
+       #if TOWEL808_RT_CHECKS
+        ScopedUncontendedLocksAllowed() noexcept;
+        ~ScopedUncontendedLocksAllowed() noexcept;
+       #else
+        ScopedUncontendedLocksAllowed() noexcept {}
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedUncontendedLocksAllowed)
+    };
+
+    // Only records locks of this critical section that have to wait for
+    // another thread. Call disallowUncontendedLocks() before it is deleted.
+    static void allowUncontendedLocks (const juce::CriticalSection& lock) noexcept;
+    static void disallowUncontendedLocks (const juce::CriticalSection& lock) noexcept;
+
+    static constexpr bool isEnabled() noexcept      { return TOWEL808_RT_CHECKS != 0; }
+
+    // Number of violations recorded since the last clear, including any that
+    // didn't fit in the log
+    static int getNumViolations() noexcept;
+
+    // Symbolises the logged violations. Allocates, so never call it on the
+    // audio thread.
+    static juce::Array<Violation> getViolations();
+
+    // Empties the log. Only call this while no audio thread is running.
+    static void clearViolations() noexcept;
+
+    static juce::String getKindName (Kind kind);
+};
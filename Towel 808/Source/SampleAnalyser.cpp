@@ -0,0 +1,303 @@
+/*
+  ==============================================================================
+    Offline pitch and loudness measurement of a sample, fed a chunk at a time.
+  ==============================================================================
+*/
+
+#include "SampleAnalyser.h"
+
+namespace
+{
+    // Range of fundamentals searched for; 808s live at the bottom of it
+    constexpr double lowestPitchHz = 25.0;
+    constexpr double highestPitchHz = 400.0;
+
+    // Rate the pitch search runs at, and the low-pass in front of it
+    constexpr double analysisRate = 4000.0;
+    constexpr double lowPassHz = 800.0;
+
+    // YIN's threshold on the normalised difference; a frame whose best dip
+    // doesn't reach it has no clear period
+    constexpr float yinThreshold = 0.15f;
+
+    // The attack is skipped, and the search stops once the note has decayed
+    // this far below its loudest frame
+    constexpr double attackSeconds = 0.05;
+    constexpr float decayLimit = 0.003f;    // about -50 dB
+    constexpr int maxPitchFrames = 64;
+
+    double decibelsToEnergy (double decibels) noexcept     { return std::pow (10.0, (decibels + 0.691) / 10.0); }
+    double energyToDecibels (double energy) noexcept       { return -0.691 + 10.0 * std::log10 (energy); }
+}
+
+//==============================================================================
+SampleAnalyser::SampleAnalyser (double rate, int channels)
+    : sampleRate (rate),
+      numChannels (juce::jlimit (1, 2, channels)),
+      decimation (juce::jmax (1, (int) (rate / analysisRate))),
+      lowPassCoefficient (1.0 - std::exp (-juce::MathConstants<double>::twoPi * lowPassHz / rate)),
+      stepLength (juce::jmax (1, juce::roundToInt (rate * 0.1)))
+{
+    // BS.1770 K-weighting: a high shelf for the head, then a high-pass. The
+    // analogue prototypes are mapped to this rate so any file rate works.
+    auto k = std::tan (juce::MathConstants<double>::pi * 1681.974450955533 / rate);
+    auto q = 0.7071752369554196;
+    auto vh = std::pow (10.0, 3.999843853973347 / 20.0);
+    auto vb = std::pow (vh, 0.4996667741545416);
+    auto a0 = 1.0 + k / q + k * k;
+
+    Biquad shelfFilter { (vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                         2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+
+    k = std::tan (juce::MathConstants<double>::pi * 38.13547087602444 / rate);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+
+    Biquad highPassFilter { 1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        shelf[channel] = shelfFilter;
+        highPass[channel] = highPassFilter;
+    }
+
+    // Windowed-sinc taps for the points a quarter, half and three quarters
+    // of the way between input frames; phase 0 is the frame itself
+    constexpr int centre = interpolatorTaps / 2;
+
+    for (int phase = 0; phase < oversampling; ++phase)
+    {
+        for (int tap = 0; tap < interpolatorTaps; ++tap)
+        {
+            auto t = tap - centre + (double) phase / oversampling;
+            auto sinc = t == 0.0 ? 1.0 : std::sin (juce::MathConstants<double>::pi * t) / (juce::MathConstants<double>::pi * t);
+            auto window = 0.5 + 0.5 * std::cos (juce::MathConstants<double>::pi * t / (centre + 1));
+
+            interpolator[phase][tap] = (float) (sinc * window);
+        }
+    }
+}
+
+//==============================================================================
+void SampleAnalyser::process (const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const float* channels[2] = { buffer.getReadPointer (0),
+                                 buffer.getReadPointer (numChannels > 1 ? 1 : 0) };
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float frame[2] = { channels[0][i], channels[1][i] };
+
+        // Pitch
+        auto mono = 0.5 * (frame[0] + frame[1]);
+        lowPassState[0] += lowPassCoefficient * (mono - lowPassState[0]);
+        lowPassState[1] += lowPassCoefficient * (lowPassState[0] - lowPassState[1]);
+
+        if (++decimationPhase == decimation)
+        {
+            decimationPhase = 0;
+            auto value = (float) lowPassState[1];
+
+            if (std::abs (value) > decimatedPeak)
+            {
+                decimatedPeak = std::abs (value);
+                decimatedPeakIndex = decimated.size();
+            }
+
+            decimated.add (value);
+        }
+
+        // Loudness
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            auto weighted = highPass[channel].process (shelf[channel].process (frame[channel]));
+            stepEnergy += weighted * weighted;
+        }
+
+        if (++stepPosition == stepLength)
+        {
+            stepEnergies.add (stepEnergy / stepLength);
+            stepEnergy = 0.0;
+            stepPosition = 0;
+        }
+
+        // True peak. Each history is stored twice over so the newest
+        // interpolatorTaps frames are always contiguous.
+        historyPosition = (historyPosition + 1) % interpolatorTaps;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* recent = history[channel];
+            recent[historyPosition] = recent[historyPosition + interpolatorTaps] = frame[channel];
+
+            // recent[newest - tap] is the frame tap steps back
+            auto newest = historyPosition + interpolatorTaps;
+
+            for (int phase = 0; phase < oversampling; ++phase)
+            {
+                float sum = 0.0f;
+
+                for (int tap = 0; tap < interpolatorTaps; ++tap)
+                    sum += interpolator[phase][tap] * recent[newest - tap];
+
+                truePeak = juce::jmax (truePeak, std::abs (sum));
+            }
+        }
+    }
+}
+
+//==============================================================================
+SampleAnalyser::Result SampleAnalyser::getResult() const
+{
+    Result result;
+    result.pitch = findPitch();
+    result.truePeak = truePeak;
+
+    // 400 ms blocks overlapping by 75%, made of four 100 ms steps. Anything
+    // shorter than one block is measured as a whole.
+    juce::Array<double> blocks;
+
+    for (int start = 0; start + 4 <= stepEnergies.size(); ++start)
+        blocks.add ((stepEnergies[start] + stepEnergies[start + 1] + stepEnergies[start + 2] + stepEnergies[start + 3]) / 4.0);
+
+    if (blocks.isEmpty())
+    {
+        double total = stepEnergy;
+
+        for (auto energy : stepEnergies)
+            total += energy * stepLength;
+
+        auto length = stepEnergies.size() * stepLength + stepPosition;
+
+        if (length > 0)
+            blocks.add (total / length);
+    }
+
+    // The absolute gate at -70 LUFS, then the relative gate 10 LU below
+    // the loudness of what passed it
+    auto gatedMean = [&blocks] (double threshold)
+    {
+        double sum = 0.0;
+        int count = 0;
+
+        for (auto energy : blocks)
+        {
+            if (energy > threshold)
+            {
+                sum += energy;
+                ++count;
+            }
+        }
+
+        return count > 0 ? sum / count : 0.0;
+    };
+
+    auto absoluteMean = gatedMean (decibelsToEnergy (-70.0));
+
+    if (absoluteMean > 0.0)
+    {
+        auto relativeMean = gatedMean (decibelsToEnergy (energyToDecibels (absoluteMean) - 10.0));
+
+        if (relativeMean > 0.0)
+            result.loudness = (float) energyToDecibels (relativeMean);
+    }
+
+    return result;
+}
+
+float SampleAnalyser::findPitch() const
+{
+    auto rate = sampleRate / decimation;
+    auto minLag = juce::jmax (2, (int) (rate / highestPitchHz));
+    auto maxLag = (int) std::ceil (rate / lowestPitchHz);
+    auto frameLength = 2 * maxLag;
+    auto hop = frameLength / 2;
+
+    juce::Array<float> periods;
+    auto start = decimatedPeakIndex + (int) (attackSeconds * rate);
+
+    for (; start + frameLength + maxLag <= decimated.size() && periods.size() < maxPitchFrames; start += hop)
+    {
+        auto* frame = decimated.begin() + start;
+
+        if (juce::FloatVectorOperations::findMaximum (frame, frameLength) < decayLimit * decimatedPeak)
+            break;
+
+        auto period = detectPeriod (frame, frameLength, minLag, maxLag);
+
+        if (period > 0.0f)
+            periods.add (period);
+    }
+
+    if (periods.isEmpty())
+        return -1.0f;
+
+    // The median shrugs off the odd octave error and the pitch drop many
+    // 808s have at the start
+    periods.sort();
+    auto frequency = rate / periods[periods.size() / 2];
+
+    return (float) (69.0 + 12.0 * std::log2 (frequency / 440.0));
+}
+
+float SampleAnalyser::detectPeriod (const float* frame, int frameLength, int minLag, int maxLag) const
+{
+    // Difference function, then its cumulative mean normalisation
+    std::vector<float> difference ((size_t) maxLag + 1);
+    difference[0] = 1.0f;
+    double runningSum = 0.0;
+
+    for (int lag = 1; lag <= maxLag; ++lag)
+    {
+        float sum = 0.0f;
+
+        for (int j = 0; j < frameLength; ++j)
+        {
+            auto delta = frame[j] - frame[j + lag];
+            sum += delta * delta;
+        }
+
+        runningSum += sum;
+        difference[(size_t) lag] = runningSum > 0.0 ? (float) (sum * lag / runningSum) : 1.0f;
+    }
+
+    // The first dip below the threshold, followed down to its minimum
+    for (int lag = minLag; lag < maxLag; ++lag)
+    {
+        if (difference[(size_t) lag] >= yinThreshold)
+            continue;
+
+        while (lag + 1 < maxLag && difference[(size_t) lag + 1] < difference[(size_t) lag])
+            ++lag;
+
+        // A parabola through the minimum and its neighbours places it between lags
+        auto before = difference[(size_t) lag - 1];
+        auto at = difference[(size_t) lag];
+        auto after = difference[(size_t) lag + 1];
+        auto curvature = before - 2.0f * at + after;
+
+        return lag + (curvature > 0.0f ? 0.5f * (before - after) / curvature : 0.0f);
+    }
+
+    return -1.0f;
+}
+
+//==============================================================================
+int SampleAnalyser::getRootNote (float pitch) noexcept
+{
+    // Without a clear pitch, middle C keeps the old mapping
+    return pitch < 0.0f ? 60 : juce::jlimit (0, 127, juce::roundToInt (pitch));
+}
+
+float SampleAnalyser::getNormalisationGain (float loudness, float truePeak) noexcept
+{
+    if (loudness <= -70.0f)
+        return 1.0f;
+
+    auto gainDecibels = juce::jlimit (-24.0f, 12.0f, targetLoudness - loudness);
+
+    if (truePeak > 0.0f)
+        gainDecibels = juce::jmin (gainDecibels, truePeakCeiling - juce::Decibels::gainToDecibels (truePeak));
+
+    return juce::Decibels::decibelsToGain (gainDecibels);
+}
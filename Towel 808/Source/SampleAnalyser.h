@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+    Offline pitch and loudness measurement of a sample, fed a chunk at a time.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Measures a whole sample as it is read from disk, without holding it in
+    memory: its fundamental, its integrated loudness and its true peak.
+
+    The fundamental comes from YIN run over a low-passed, decimated mono mix.
+    An 808's fundamental sits well below 200 Hz, so a few kilohertz of
+    bandwidth is plenty and the search costs very little. Estimates are taken
+    through the body of the note, after the attack, and the median is kept.
+
+    Loudness follows ITU-R BS.1770: K-weighting, 400 ms blocks with 75%
+    overlap, and the absolute and relative gates. A mono file counts as two
+    identical channels, because that is how the sampler plays it. The true
+    peak is read from a 4x oversampled copy.
+*/
+class SampleAnalyser
+{
+public:
+    SampleAnalyser (double sampleRate, int numChannels);
+
+    // Feeds the next numSamples frames of the file
+    void process (const juce::AudioBuffer<float>& buffer, int numSamples);
+
+    struct Result
+    {
+        float pitch = -1.0f;        // fundamental as a fractional MIDI note, -1 if none was found
+        float loudness = -100.0f;   // integrated loudness in LUFS
+        float truePeak = 0.0f;      // linear
+    };
+
+    Result getResult() const;
+
+    // MIDI note a sound should be mapped to, given a measured pitch
+    static int getRootNote (float pitch) noexcept;
+
+    // Gain that brings a sample to the target loudness, limited so its true
+    // peak stays below the ceiling and quiet noise isn't blown up
+    static float getNormalisationGain (float loudness, float truePeak) noexcept;
+
+    static constexpr float targetLoudness = -14.0f;
+    static constexpr float truePeakCeiling = -1.0f;     // dBTP
+
+private:
+    struct Biquad
+    {
+        double b0, b1, b2, a1, a2;
+        double z1 = 0.0, z2 = 0.0;
+
+        double process (double x) noexcept
+        {
+            auto y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    float findPitch() const;
+    float detectPeriod (const float* frame, int frameLength, int minLag, int maxLag) const;
+
+    double sampleRate;
+    int numChannels;
+
+    // Pitch: mono mix, low-passed twice and kept every decimation-th sample
+    int decimation;
+    double lowPassCoefficient, lowPassState[2] {};
+    int decimationPhase = 0;
+    juce::Array<float> decimated;
+    float decimatedPeak = 0.0f;
+    int decimatedPeakIndex = 0;
+
+    // Loudness: K-weighted energy of each 100 ms step, summed over channels
+    Biquad shelf[2], highPass[2];
+    int stepLength, stepPosition = 0;
+    double stepEnergy = 0.0;
+    juce::Array<double> stepEnergies;
+
+    // True peak: the last few input frames of each channel for the interpolator
+    static constexpr int oversampling = 4;
+    static constexpr int interpolatorTaps = 12;
+    float interpolator[oversampling][interpolatorTaps];
+    float history[2][2 * interpolatorTaps] {};
+    int historyPosition = 0;
+    float truePeak = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleAnalyser)
+};
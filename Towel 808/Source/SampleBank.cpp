@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+    Preloaded, in-memory bank of decoded samples.
+  ==============================================================================
+*/
+
+#include "SampleBank.h"
+
+//==============================================================================
+void SampleBank::reset (size_t memoryBudgetBytes, bool useCompactStorage,
+                        juce::ReferenceCountedArray<MySamplerSound>& soundsToRetire)
+{
+    const juce::ScopedLock sl (lock);
+    compactStorage = useCompactStorage;
+
+    for (auto& entry : entries)
+        soundsToRetire.add (entry.sound);
+
+    entries.clear();
+    freeRanges.clear();
+    arena = nullptr;
+
+    auto numFloats = memoryBudgetBytes / sizeof (float);
+
+    if (numFloats > 0)
+    {
+        arena = new Arena (numFloats);
+        freeRanges.add ({ 0, numFloats });
+    }
+}
+
+size_t SampleBank::getMemoryBudget() const
+{
+    const juce::ScopedLock sl (lock);
+    return arena != nullptr ? arena->numFloats * sizeof (float) : 0;
+}
+
+bool SampleBank::isEnabled() const
+{
+    const juce::ScopedLock sl (lock);
+    return arena != nullptr;
+}
+
+bool SampleBank::isCompact() const
+{
+    const juce::ScopedLock sl (lock);
+    return compactStorage;
+}
+
+MySamplerSound::Ptr SampleBank::findSound (const juce::File& file)
+{
+    const juce::ScopedLock sl (lock);
+
+    auto index = indexOf (file);
+
+    if (index < 0)
+        return {};
+
+    auto& entry = entries.getReference (index);
+    entry.lastUsed = ++useCounter;
+    return entry.sound;
+}
+
+bool SampleBank::contains (const juce::File& file) const
+{
+    const juce::ScopedLock sl (lock);
+    return indexOf (file) >= 0;
+}
+
+MySamplerSound::Ptr SampleBank::addSample (const juce::File& file, juce::AudioFormatReader& reader,
+                                          int rootNote, float normalisationGain, bool evictIfNeeded)
+{
+    auto numChannels = juce::jmin (2, (int) reader.numChannels);
+    auto numSamples = (int) reader.lengthInSamples;
+
+    if (numChannels <= 0 || numSamples <= 0)
+        return {};
+
+    if (compactStorage)
+        return addCompactSample (file, reader, numChannels, numSamples, rootNote, normalisationGain, evictIfNeeded);
+
+    // Each channel gets its own guard samples on both sides
+    auto channelSize = (size_t) numSamples + 2 * guardSamples;
+    auto size = channelSize * (size_t) numChannels;
+
+    juce::ReferenceCountedObjectPtr<Arena> target;
+    size_t offset = 0;
+
+    if (! reserve (file, size, evictIfNeeded, offset, target))
+        return {};
+
+    // Only the loader thread modifies the bank, so the reserved range can be
+    // filled without holding the lock while we read from disk.
+    float* channels[2] = {};
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        channels[ch] = target->data + offset + (size_t) ch * channelSize + guardSamples;
+
+    juce::FloatVectorOperations::clear (target->data + offset, (int) size);
+
+    juce::AudioBuffer<float> destination (channels, numChannels, numSamples);
+    reader.read (&destination, 0, numSamples, 0, true, true);
+
+    juce::BigInteger midiNotes;
+    midiNotes.setRange (0, 128, true); // Respond to all MIDI notes
+
+    // The trailing guard is exposed to the voice, matching the extra samples
+    // MySamplerSound reads past the end when it decodes a file itself.
+    MySamplerSound::Ptr sound (new MySamplerSound (file.getFileNameWithoutExtension(),
+                                                   channels, numChannels, numSamples + guardSamples,
+                                                   reader.sampleRate,
+                                                   midiNotes,
+                                                   rootNote,
+                                                   target));
+    sound->setNormalisationGain (normalisationGain);
+
+    const juce::ScopedLock sl (lock);
+    entries.add ({ file, offset, size, ++useCounter, sound });
+    return sound;
+}
+
+MySamplerSound::Ptr SampleBank::addCompactSample (const juce::File& file, juce::AudioFormatReader& reader,
+                                                 int numChannels, int numSamples,
+                                                 int rootNote, float normalisationGain, bool evictIfNeeded)
+{
+    // The whole file is decoded before anything is reserved, since its
+    // scale and whether both sides match decide how much room it needs
+    juce::AudioBuffer<float> decoded (numChannels, numSamples);
+    reader.read (&decoded, 0, numSamples, 0, true, true);
+
+    auto layout = MySamplerSound::getCompactLayout (decoded.getArrayOfReadPointers(), numChannels, numSamples);
+
+    // The arena is counted in floats, each holding two 16-bit samples
+    auto channelSize = (size_t) numSamples + 2 * guardSamples;
+    auto size = (channelSize * (size_t) layout.numChannels + 1) / 2;
+
+    juce::ReferenceCountedObjectPtr<Arena> target;
+    size_t offset = 0;
+
+    if (! reserve (file, size, evictIfNeeded, offset, target))
+        return {};
+
+    auto* start = reinterpret_cast<juce::int16*> (target->data + offset);
+    juce::zeromem (start, size * sizeof (float));
+
+    juce::int16* channels[2] = {};
+
+    for (int ch = 0; ch < layout.numChannels; ++ch)
+    {
+        channels[ch] = start + (size_t) ch * channelSize + guardSamples;
+        SampleKernels::convertToInt16 (decoded.getReadPointer (ch), channels[ch], layout.scale, numSamples);
+    }
+
+    juce::BigInteger midiNotes;
+    midiNotes.setRange (0, 128, true); // Respond to all MIDI notes
+
+    MySamplerSound::Ptr sound (new MySamplerSound (file.getFileNameWithoutExtension(),
+                                                   channels, layout.numChannels, numSamples + guardSamples,
+                                                   layout.scale,
+                                                   reader.sampleRate,
+                                                   midiNotes,
+                                                   rootNote,
+                                                   target));
+    sound->setNormalisationGain (normalisationGain);
+
+    const juce::ScopedLock sl (lock);
+    entries.add ({ file, offset, size, ++useCounter, sound });
+    return sound;
+}
+
+//==============================================================================
+bool SampleBank::reserve (const juce::File& file, size_t size, bool evictIfNeeded,
+                          size_t& offset, juce::ReferenceCountedObjectPtr<Arena>& target)
+{
+    const juce::ScopedLock sl (lock);
+
+    if (arena == nullptr || indexOf (file) >= 0)
+        return false;
+
+    while (! allocate (size, offset))
+        if (! evictIfNeeded || ! evictLeastRecentlyUsed())
+            return false;
+
+    target = arena;
+    return true;
+}
+
+bool SampleBank::allocate (size_t size, size_t& offset)
+{
+    for (int i = 0; i < freeRanges.size(); ++i)
+    {
+        auto& range = freeRanges.getReference (i);
+
+        if (range.size >= size)
+        {
+            offset = range.offset;
+            range.offset += size;
+            range.size -= size;
+
+            if (range.size == 0)
+                freeRanges.remove (i);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SampleBank::release (size_t offset, size_t size)
+{
+    // Keep the free list sorted and merge with neighbouring ranges
+    int index = 0;
+
+    while (index < freeRanges.size() && freeRanges.getReference (index).offset < offset)
+        ++index;
+
+    freeRanges.insert (index, { offset, size });
+
+    if (index + 1 < freeRanges.size())
+    {
+        auto& next = freeRanges.getReference (index + 1);
+
+        if (offset + size == next.offset)
+        {
+            freeRanges.getReference (index).size += next.size;
+            freeRanges.remove (index + 1);
+        }
+    }
+
+    if (index > 0)
+    {
+        auto& previous = freeRanges.getReference (index - 1);
+
+        if (previous.offset + previous.size == offset)
+        {
+            previous.size += freeRanges.getReference (index).size;
+            freeRanges.remove (index);
+        }
+    }
+}
+
+bool SampleBank::evictLeastRecentlyUsed()
+{
+    int oldest = -1;
+
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        auto& entry = entries.getReference (i);
+
+        // Anything with more than the bank's own reference is being played or
+        // is about to be, so its memory can't be reused yet.
+        if (entry.sound->getReferenceCount() > 1)
+            continue;
+
+        if (oldest < 0 || entry.lastUsed < entries.getReference (oldest).lastUsed)
+            oldest = i;
+    }
+
+    if (oldest < 0)
+        return false;
+
+    auto& entry = entries.getReference (oldest);
+    release (entry.offset, entry.size);
+    entries.remove (oldest);
+    return true;
+}
+
+int SampleBank::indexOf (const juce::File& file) const
+{
+    for (int i = 0; i < entries.size(); ++i)
+        if (entries.getReference (i).file == file)
+            return i;
+
+    return -1;
+}
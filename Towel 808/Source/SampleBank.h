@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+    Preloaded, in-memory bank of decoded samples.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MySampler.h"
+
+//==============================================================================
+/**
+    Keeps decoded samples resident in one contiguous arena so that switching
+    between them is just a pointer change with no disk I/O.
+
+    Each channel is stored with zeroed guard samples on both sides so the
+    voice's interpolator can read a few samples past either end. When a new
+    sample doesn't fit, the least recently used entries nobody is playing are
+    evicted until it does.
+
+    A compact bank stores 16-bit data instead, with dual-mono files folded to
+    one channel, which fits two to four times as many samples in the same
+    budget.
+
+    The bank is shared by the loader and message threads and guarded by its
+    own lock; it is never touched by the audio thread.
+*/
+class SampleBank
+{
+public:
+    SampleBank() = default;
+
+    static constexpr int guardSamples = 4;
+
+    // Discards the current arena and allocates a new one of the given size,
+    // holding float or compact sounds. Sounds from the old arena are appended
+    // to soundsToRetire so the caller can release them once nothing is
+    // playing them.
+    void reset (size_t memoryBudgetBytes, bool useCompactStorage,
+                juce::ReferenceCountedArray<MySamplerSound>& soundsToRetire);
+
+    // Safe to call from any thread but the audio thread, even while
+    // reset() runs on another
+    size_t getMemoryBudget() const;
+    bool isEnabled() const;
+    bool isCompact() const;
+
+    // Returns the resident sound for this file and marks it as recently used,
+    // or nullptr if the file isn't in the bank.
+    MySamplerSound::Ptr findSound (const juce::File& file);
+
+    bool contains (const juce::File& file) const;
+
+    // Decodes the reader into the arena as a sound with the given root note
+    // and normalisation gain. If evictIfNeeded is true, least recently used
+    // entries are dropped to make room. Returns nullptr if the sample can't fit.
+    MySamplerSound::Ptr addSample (const juce::File& file, juce::AudioFormatReader& reader,
+                                   int rootNote, float normalisationGain, bool evictIfNeeded);
+
+private:
+    struct Arena  : public juce::ReferenceCountedObject
+    {
+        explicit Arena (size_t size) : numFloats (size)  { data.calloc (size); }
+
+        juce::HeapBlock<float> data;
+        const size_t numFloats;
+    };
+
+    struct Entry
+    {
+        juce::File file;
+        size_t offset, size;
+        juce::uint32 lastUsed;
+        MySamplerSound::Ptr sound;
+    };
+
+    struct FreeRange
+    {
+        size_t offset, size;
+    };
+
+    MySamplerSound::Ptr addCompactSample (const juce::File& file, juce::AudioFormatReader& reader,
+                                          int numChannels, int numSamples,
+                                          int rootNote, float normalisationGain, bool evictIfNeeded);
+
+    bool reserve (const juce::File& file, size_t size, bool evictIfNeeded,
+                  size_t& offset, juce::ReferenceCountedObjectPtr<Arena>& target);
+    bool allocate (size_t size, size_t& offset);
+    void release (size_t offset, size_t size);
+    bool evictLeastRecentlyUsed();
+    int indexOf (const juce::File& file) const;
+
+    juce::CriticalSection lock;
+    juce::ReferenceCountedObjectPtr<Arena> arena;
+    bool compactStorage = false;
+    juce::Array<Entry> entries;
+    juce::Array<FreeRange> freeRanges;
+    juce::uint32 useCounter = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleBank)
+};
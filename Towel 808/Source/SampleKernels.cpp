@@ -0,0 +1,452 @@
+/*
+  ==============================================================================
+    Block-based interpolation kernels used by the sampler voices.
+  ==============================================================================
+*/
+
+#include "SampleKernels.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    // Four floats in one register, with just the operations the kernels need.
+    // The scalar fallback keeps every kernel buildable on any target.
+    struct Vec4
+    {
+       #if JUCE_USE_SSE_INTRINSICS
+        __m128 v;
+
+        static Vec4 load (const float* p) noexcept                      { return { _mm_loadu_ps (p) }; }
+        static Vec4 fill (float x) noexcept                             { return { _mm_set1_ps (x) }; }
+        static Vec4 fromValues (float a, float b, float c, float d) noexcept { return { _mm_setr_ps (a, b, c, d) }; }
+        void store (float* p) const noexcept                            { _mm_storeu_ps (p, v); }
+
+        Vec4 operator+ (Vec4 other) const noexcept                      { return { _mm_add_ps (v, other.v) }; }
+        Vec4 operator- (Vec4 other) const noexcept                      { return { _mm_sub_ps (v, other.v) }; }
+        Vec4 operator* (Vec4 other) const noexcept                      { return { _mm_mul_ps (v, other.v) }; }
+
+        float sum() const noexcept
+        {
+            alignas (16) float lanes[4];
+            _mm_store_ps (lanes, v);
+            return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+
+        // Stores the truncated integer parts and returns the fractional parts
+        Vec4 split (int* integers) const noexcept
+        {
+            auto truncated = _mm_cvttps_epi32 (v);
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (integers), truncated);
+            return { _mm_sub_ps (v, _mm_cvtepi32_ps (truncated)) };
+        }
+       #elif JUCE_USE_ARM_NEON
+        float32x4_t v;
+
+        static Vec4 load (const float* p) noexcept                      { return { vld1q_f32 (p) }; }
+        static Vec4 fill (float x) noexcept                             { return { vdupq_n_f32 (x) }; }
+        static Vec4 fromValues (float a, float b, float c, float d) noexcept
+        {
+            const float values[4] = { a, b, c, d };
+            return { vld1q_f32 (values) };
+        }
+        void store (float* p) const noexcept                            { vst1q_f32 (p, v); }
+
+        Vec4 operator+ (Vec4 other) const noexcept                      { return { vaddq_f32 (v, other.v) }; }
+        Vec4 operator- (Vec4 other) const noexcept                      { return { vsubq_f32 (v, other.v) }; }
+        Vec4 operator* (Vec4 other) const noexcept                      { return { vmulq_f32 (v, other.v) }; }
+
+        float sum() const noexcept
+        {
+            auto pairs = vadd_f32 (vget_low_f32 (v), vget_high_f32 (v));
+            return vget_lane_f32 (vpadd_f32 (pairs, pairs), 0);
+        }
+
+        Vec4 split (int* integers) const noexcept
+        {
+            auto truncated = vcvtq_s32_f32 (v);
+            vst1q_s32 (integers, truncated);
+            return { vsubq_f32 (v, vcvtq_f32_s32 (truncated)) };
+        }
+       #else
+        float v[4];
+
+        static Vec4 load (const float* p) noexcept                      { return { { p[0], p[1], p[2], p[3] } }; }
+        static Vec4 fill (float x) noexcept                             { return { { x, x, x, x } }; }
+        static Vec4 fromValues (float a, float b, float c, float d) noexcept { return { { a, b, c, d } }; }
+        void store (float* p) const noexcept                            { for (int i = 0; i < 4; ++i) p[i] = v[i]; }
+
+        Vec4 operator+ (Vec4 other) const noexcept                      { Vec4 r; for (int i = 0; i < 4; ++i) r.v[i] = v[i] + other.v[i]; return r; }
+        Vec4 operator- (Vec4 other) const noexcept                      { Vec4 r; for (int i = 0; i < 4; ++i) r.v[i] = v[i] - other.v[i]; return r; }
+        Vec4 operator* (Vec4 other) const noexcept                      { Vec4 r; for (int i = 0; i < 4; ++i) r.v[i] = v[i] * other.v[i]; return r; }
+
+        float sum() const noexcept                                      { return (v[0] + v[1]) + (v[2] + v[3]); }
+
+        Vec4 split (int* integers) const noexcept
+        {
+            Vec4 r;
+
+            for (int i = 0; i < 4; ++i)
+            {
+                integers[i] = (int) v[i];
+                r.v[i] = v[i] - (float) integers[i];
+            }
+
+            return r;
+        }
+       #endif
+    };
+
+    // a + alpha * (b - a)
+    inline Vec4 lerp (Vec4 a, Vec4 b, Vec4 alpha) noexcept
+    {
+        return a + alpha * (b - a);
+    }
+
+    //==============================================================================
+    // Polyphase windowed-sinc coefficients. Each band is a full table for one
+    // cutoff; the bands step down a quarter octave at a time so a voice
+    // pitched up by up to two octaves still gets a cutoff below its output
+    // Nyquist. Rows hold the taps for one fractional position and are
+    // blended linearly, so 128 phases are plenty.
+    constexpr int sincPhases = 128;
+    constexpr int sincBands = 9;
+    constexpr int sincHalfWidth = SampleKernels::sincTaps / 2;
+
+    struct SincTables
+    {
+        SincTables()
+        {
+            for (int band = 0; band < sincBands; ++band)
+            {
+                // Leave some headroom below Nyquist for the transition band
+                auto cutoff = 0.9 * std::pow (2.0, -band / 4.0);
+
+                for (int phase = 0; phase <= sincPhases; ++phase)
+                {
+                    auto* row = coefficients[band][phase];
+                    auto fraction = phase / (double) sincPhases;
+                    double sum = 0.0;
+
+                    for (int tap = 0; tap < SampleKernels::sincTaps; ++tap)
+                    {
+                        // Tap 0 reads source[index - (sincHalfWidth - 1)]
+                        auto x = (tap - (sincHalfWidth - 1)) - fraction;
+                        auto u = x / sincHalfWidth;
+                        auto window = 0.42 + 0.5 * std::cos (juce::MathConstants<double>::pi * u)
+                                           + 0.08 * std::cos (juce::MathConstants<double>::twoPi * u);
+
+                        auto arg = juce::MathConstants<double>::pi * cutoff * x;
+                        auto value = (std::abs (arg) < 1.0e-9 ? 1.0 : std::sin (arg) / arg) * window;
+
+                        row[tap] = (float) value;
+                        sum += value;
+                    }
+
+                    // Unity gain at DC for every phase
+                    for (int tap = 0; tap < SampleKernels::sincTaps; ++tap)
+                        row[tap] = (float) (row[tap] / sum);
+                }
+            }
+        }
+
+        alignas (16) float coefficients[sincBands][sincPhases + 1][SampleKernels::sincTaps];
+    };
+
+    // Built once when the plugin is loaded, so the audio thread never waits on it
+    const SincTables sincTables;
+
+    int getSincBand (double increment) noexcept
+    {
+        if (increment <= 1.0)
+            return 0;
+
+        return juce::jmin (sincBands - 1, (int) std::ceil (4.0 * std::log2 (increment)));
+    }
+}
+
+//==============================================================================
+int SampleKernels::getLeadingFrames (Quality quality) noexcept
+{
+    switch (quality)
+    {
+        case hermite:   return 1;
+        case sinc:      return sincHalfWidth - 1;
+        case linear:
+        default:        return 0;
+    }
+}
+
+int SampleKernels::getTrailingFrames (Quality quality) noexcept
+{
+    switch (quality)
+    {
+        case hermite:   return 2;
+        case sinc:      return sincHalfWidth;
+        case linear:
+        default:        return 1;
+    }
+}
+
+//==============================================================================
+void SampleKernels::computePositions (double position, double increment,
+                                      int* indices, float* fractions, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto p = position + i * increment;
+        auto index = (int) p;
+
+        indices[i] = index;
+        fractions[i] = (float) (p - index);
+    }
+}
+
+void SampleKernels::interpolateLinear (const float* source, const int* indices, const float* fractions,
+                                       float* dest, int numSamples) noexcept
+{
+    int i = 0;
+
+    // There is no gather before AVX2, so the frame pairs are loaded lane by
+    // lane and the blend itself runs four samples at a time.
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        auto* idx = indices + i;
+
+        auto s0 = Vec4::fromValues (source[idx[0]],     source[idx[1]],     source[idx[2]],     source[idx[3]]);
+        auto s1 = Vec4::fromValues (source[idx[0] + 1], source[idx[1] + 1], source[idx[2] + 1], source[idx[3] + 1]);
+
+        lerp (s0, s1, Vec4::load (fractions + i)).store (dest + i);
+    }
+
+    for (; i < numSamples; ++i)
+    {
+        auto s0 = source[indices[i]];
+        auto s1 = source[indices[i] + 1];
+
+        dest[i] = s0 + fractions[i] * (s1 - s0);
+    }
+}
+
+void SampleKernels::interpolateHermite (const float* source, const int* indices, const float* fractions,
+                                        float* dest, int numSamples) noexcept
+{
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        auto* idx = indices + i;
+
+        auto xm1 = Vec4::fromValues (source[idx[0] - 1], source[idx[1] - 1], source[idx[2] - 1], source[idx[3] - 1]);
+        auto x0  = Vec4::fromValues (source[idx[0]],     source[idx[1]],     source[idx[2]],     source[idx[3]]);
+        auto x1  = Vec4::fromValues (source[idx[0] + 1], source[idx[1] + 1], source[idx[2] + 1], source[idx[3] + 1]);
+        auto x2  = Vec4::fromValues (source[idx[0] + 2], source[idx[1] + 2], source[idx[2] + 2], source[idx[3] + 2]);
+        auto t   = Vec4::load (fractions + i);
+
+        auto half = Vec4::fill (0.5f);
+        auto c1 = half * (x1 - xm1);
+        auto c2 = xm1 - Vec4::fill (2.5f) * x0 + Vec4::fill (2.0f) * x1 - half * x2;
+        auto c3 = half * (x2 - xm1) + Vec4::fill (1.5f) * (x0 - x1);
+
+        (((c3 * t + c2) * t + c1) * t + x0).store (dest + i);
+    }
+
+    for (; i < numSamples; ++i)
+    {
+        auto* s = source + indices[i];
+        auto t = fractions[i];
+
+        auto c1 = 0.5f * (s[1] - s[-1]);
+        auto c2 = s[-1] - 2.5f * s[0] + 2.0f * s[1] - 0.5f * s[2];
+        auto c3 = 0.5f * (s[2] - s[-1]) + 1.5f * (s[0] - s[1]);
+
+        dest[i] = ((c3 * t + c2) * t + c1) * t + s[0];
+    }
+}
+
+void SampleKernels::interpolateSinc (const float* source, const int* indices, const float* fractions,
+                                     float* dest, int numSamples, double increment) noexcept
+{
+    auto& table = sincTables.coefficients[getSincBand (increment)];
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // A fraction that rounded up to 1.0f still uses the last pair of rows
+        auto phase = fractions[i] * (float) sincPhases;
+        auto row = juce::jmin ((int) phase, sincPhases - 1);
+        auto blend = Vec4::fill (phase - (float) row);
+
+        auto* lower = table[row];
+        auto* upper = table[row + 1];
+        auto* s = source + indices[i] - (sincHalfWidth - 1);
+
+        auto sum = Vec4::fill (0.0f);
+
+        for (int tap = 0; tap < sincTaps; tap += 4)
+            sum = sum + lerp (Vec4::load (lower + tap), Vec4::load (upper + tap), blend) * Vec4::load (s + tap);
+
+        dest[i] = sum.sum();
+    }
+}
+
+void SampleKernels::interpolate (Quality quality, const float* source, const int* indices, const float* fractions,
+                                 float* dest, int numSamples, double increment) noexcept
+{
+    switch (quality)
+    {
+        case hermite:   interpolateHermite (source, indices, fractions, dest, numSamples); break;
+        case sinc:      interpolateSinc (source, indices, fractions, dest, numSamples, increment); break;
+        case linear:
+        default:        interpolateLinear (source, indices, fractions, dest, numSamples); break;
+    }
+}
+
+//==============================================================================
+void SampleKernels::convertFromInt16 (const juce::int16* source, float* dest, float scale, int numSamples) noexcept
+{
+    int i = 0;
+
+   #if JUCE_USE_SSE_INTRINSICS
+    auto multiplier = _mm_set1_ps (scale);
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        // Each half is sign-extended by unpacking into the top 16 bits of a
+        // 32-bit lane and shifting it back down
+        auto packed = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i));
+        auto low  = _mm_srai_epi32 (_mm_unpacklo_epi16 (packed, packed), 16);
+        auto high = _mm_srai_epi32 (_mm_unpackhi_epi16 (packed, packed), 16);
+
+        _mm_storeu_ps (dest + i,     _mm_mul_ps (_mm_cvtepi32_ps (low), multiplier));
+        _mm_storeu_ps (dest + i + 4, _mm_mul_ps (_mm_cvtepi32_ps (high), multiplier));
+    }
+   #elif JUCE_USE_ARM_NEON
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        auto packed = vld1q_s16 (source + i);
+
+        vst1q_f32 (dest + i,     vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (packed))), scale));
+        vst1q_f32 (dest + i + 4, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (packed))), scale));
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+        dest[i] = (float) source[i] * scale;
+}
+
+void SampleKernels::convertToInt16 (const float* source, juce::int16* dest, float scale, int numSamples) noexcept
+{
+    // Only run when a sound is stored, so there's no need to vectorise it
+    auto inverse = 1.0f / scale;
+
+    for (int i = 0; i < numSamples; ++i)
+        dest[i] = (juce::int16) juce::jlimit (-32768, 32767, juce::roundToInt (source[i] * inverse));
+}
+
+//==============================================================================
+void SampleKernels::renderLaneGroup (const LaneGroup& group, const float* envelopes, int envelopeStride,
+                                     float* accumulatorL, float* accumulatorR, int numSamples) noexcept
+{
+    auto fraction  = Vec4::load (group.fraction);
+    auto increment = Vec4::load (group.increment);
+    auto gainL     = Vec4::load (group.gainL);
+    auto gainR     = Vec4::load (group.gainR);
+
+    auto* l = group.sourceL;
+    auto* r = group.sourceR;
+
+    alignas (16) int idx[lanesPerGroup];
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // Positions are relative to each lane's chunk start, so they stay
+        // small enough for float precision over a chunk
+        auto alpha = (fraction + increment * Vec4::fill ((float) i)).split (idx);
+        auto envelope = Vec4::load (envelopes + i * envelopeStride);
+
+        auto left  = lerp (Vec4::fromValues (l[0][idx[0]],     l[1][idx[1]],     l[2][idx[2]],     l[3][idx[3]]),
+                           Vec4::fromValues (l[0][idx[0] + 1], l[1][idx[1] + 1], l[2][idx[2] + 1], l[3][idx[3] + 1]),
+                           alpha);
+
+        auto right = lerp (Vec4::fromValues (r[0][idx[0]],     r[1][idx[1]],     r[2][idx[2]],     r[3][idx[3]]),
+                           Vec4::fromValues (r[0][idx[0] + 1], r[1][idx[1] + 1], r[2][idx[2] + 1], r[3][idx[3] + 1]),
+                           alpha);
+
+        auto* accL = accumulatorL + i * lanesPerGroup;
+        auto* accR = accumulatorR + i * lanesPerGroup;
+
+        (Vec4::load (accL) + left  * envelope * gainL).store (accL);
+        (Vec4::load (accR) + right * envelope * gainR).store (accR);
+    }
+}
+
+void SampleKernels::sumLanes (const float* accumulator, float* dest, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto* lanes = accumulator + i * lanesPerGroup;
+        dest[i] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+}
+
+//==============================================================================
+void SampleKernels::fillRamp (float* dest, float start, float step, int numSamples) noexcept
+{
+    auto offsets = Vec4::fromValues (0.0f, 1.0f, 2.0f, 3.0f);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        (Vec4::fill (start) + Vec4::fill (step) * (Vec4::fill ((float) i) + offsets)).store (dest + i);
+
+    for (; i < numSamples; ++i)
+        dest[i] = start + step * (float) i;
+}
+
+void SampleKernels::fillExponential (float* dest, float offset, float scale, float ratio, int numSamples) noexcept
+{
+    // Four consecutive powers, moved on four samples at a time. Callers keep
+    // chunks short, so the rounding this gathers stays far below audibility.
+    auto ratio2 = ratio * ratio;
+    auto powers = Vec4::fromValues (scale, scale * ratio, scale * ratio2, scale * ratio2 * ratio);
+    auto step = Vec4::fill (ratio2 * ratio2);
+    auto base = Vec4::fill (offset);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        (base + powers).store (dest + i);
+        powers = powers * step;
+    }
+
+    alignas (16) float tail[4];
+    powers.store (tail);
+
+    for (int j = 0; i < numSamples; ++i, ++j)
+        dest[i] = offset + tail[j];
+}
+
+//==============================================================================
+float SampleKernels::dotProduct (const float* a, const float* b, int numTaps) noexcept
+{
+    jassert (numTaps % 4 == 0);
+
+    // Two accumulators hide the latency of the adds
+    auto sum0 = Vec4::fill (0.0f);
+    auto sum1 = Vec4::fill (0.0f);
+    int i = 0;
+
+    for (; i + 8 <= numTaps; i += 8)
+    {
+        sum0 = sum0 + Vec4::load (a + i) * Vec4::load (b + i);
+        sum1 = sum1 + Vec4::load (a + i + 4) * Vec4::load (b + i + 4);
+    }
+
+    if (i < numTaps)
+        sum0 = sum0 + Vec4::load (a + i) * Vec4::load (b + i);
+
+    return (sum0 + sum1).sum();
+}
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+    Block-based interpolation kernels used by the sampler voices.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Vectorised building blocks for rendering a voice a block at a time.
+
+    The voice first computes where each output sample falls in the source
+    (an integer frame index plus a fractional part), then runs the interpolator
+    once per channel over those positions. Indices are relative to the start
+    of the span passed in, which keeps them small and lets the caller hand in
+    either resident sample data or a copy out of a streaming ring.
+
+    Three interpolators trade quality for CPU: linear, 4-point cubic Hermite
+    and a 16-tap windowed-sinc read through precomputed polyphase tables.
+    Each reads a few frames either side of the integer position, which the
+    caller has to provide (see getLeadingFrames/getTrailingFrames).
+
+    Compact sounds keep 16-bit data; the conversion kernels widen the frames
+    a chunk reads to float before they are interpolated.
+
+    The lane kernels turn this around for the cross-voice engine: each SIMD
+    lane holds a different voice, so four voices advance together per sample.
+*/
+struct SampleKernels
+{
+    // Interpolation tiers, in the order of the processor's "quality" choices
+    enum Quality
+    {
+        linear = 0,
+        hermite,
+        sinc
+    };
+
+    static constexpr int sincTaps = 16;
+
+    // Frames each tier reads before and after source[index]
+    static int getLeadingFrames (Quality quality) noexcept;
+    static int getTrailingFrames (Quality quality) noexcept;
+
+    // The most any tier reads around one position, leading plus trailing
+    static constexpr int maxLeadingFrames = sincTaps / 2 - 1;
+    static constexpr int maxKernelSpan = sincTaps;
+
+    // Fills indices/fractions with the positions position + i * increment
+    static void computePositions (double position, double increment,
+                                  int* indices, float* fractions, int numSamples) noexcept;
+
+    // dest[i] = linear interpolation of source at indices[i] + fractions[i].
+    // Reads source[indices[i]] and source[indices[i] + 1].
+    static void interpolateLinear (const float* source, const int* indices, const float* fractions,
+                                   float* dest, int numSamples) noexcept;
+
+    // Catmull-Rom cubic through source[indices[i] - 1] .. source[indices[i] + 2]
+    static void interpolateHermite (const float* source, const int* indices, const float* fractions,
+                                    float* dest, int numSamples) noexcept;
+
+    // Windowed-sinc through source[indices[i] - 7] .. source[indices[i] + 8].
+    // The increment picks a table whose cutoff sits below the output's
+    // Nyquist frequency, so pitching up doesn't alias.
+    static void interpolateSinc (const float* source, const int* indices, const float* fractions,
+                                 float* dest, int numSamples, double increment) noexcept;
+
+    // Runs whichever interpolator the quality asks for
+    static void interpolate (Quality quality, const float* source, const int* indices, const float* fractions,
+                             float* dest, int numSamples, double increment) noexcept;
+
+    // dest[i] = source[i] * scale. Widens compact 16-bit sample data back to
+    // float, eight samples per instruction where SIMD is available.
+    static void convertFromInt16 (const juce::int16* source, float* dest, float scale, int numSamples) noexcept;
+
+    // dest[i] = source[i] / scale, rounded to the nearest integer and clipped to 16 bits
+    static void convertToInt16 (const float* source, juce::int16* dest, float scale, int numSamples) noexcept;
+
+    //==============================================================================
+    static constexpr int lanesPerGroup = 4;
+
+    // Four voices rendered side by side. Source pointers are already offset to
+    // each voice's first frame in the chunk; unused lanes point at silence
+    // with a zero increment and gain.
+    struct LaneGroup
+    {
+        const float* sourceL[lanesPerGroup];
+        const float* sourceR[lanesPerGroup];
+        float fraction[lanesPerGroup], increment[lanesPerGroup];
+        float gainL[lanesPerGroup], gainR[lanesPerGroup];
+    };
+
+    // Adds one group's output to the per-lane accumulators. envelopes holds
+    // the group's four envelope values for sample i at envelopes[i * stride];
+    // the accumulators hold four floats per sample.
+    static void renderLaneGroup (const LaneGroup& group, const float* envelopes, int envelopeStride,
+                                 float* accumulatorL, float* accumulatorR, int numSamples) noexcept;
+
+    // dest[i] += the sum of the four lane accumulators for sample i
+    static void sumLanes (const float* accumulator, float* dest, int numSamples) noexcept;
+
+    //==============================================================================
+    // dest[i] = start + step * i, worked out for each sample rather than
+    // accumulated, so a long ramp lands where it should
+    static void fillRamp (float* dest, float start, float step, int numSamples) noexcept;
+
+    // dest[i] = offset + scale * ratio^i. The envelope's exponential
+    // segments are this curve with a fresh scale for every chunk.
+    static void fillExponential (float* dest, float offset, float scale, float ratio, int numSamples) noexcept;
+
+    //==============================================================================
+    // Sum of a[i] * b[i], four products per instruction. The output stage's
+    // half-band filters run one of these per branch and sample, so numTaps
+    // must be a multiple of four.
+    static float dotProduct (const float* a, const float* b, int numTaps) noexcept;
+};
@@ -0,0 +1,322 @@
+/*
+  ==============================================================================
+    Unit tests for SampleKernels.
+  ==============================================================================
+*/
+
+#if JUCE_UNIT_TESTS
+
+#include "SampleKernels.h"
+
+//==============================================================================
+class SampleKernelsTests  : public juce::UnitTest
+{
+public:
+    SampleKernelsTests()  : juce::UnitTest ("SampleKernels", "Towel 808") {}
+
+    void runTest() override
+    {
+        auto source = makeNoise (sourceLength);
+
+        beginTest ("Linear interpolation matches juce::SamplerVoice");
+
+        for (auto semitones : { 0, 7, -12, 19 })
+        {
+            for (auto outputRate : { sourceRate, 48000.0 })
+            {
+                auto expected = renderWithSamplerVoice (source, semitones, outputRate);
+                auto increment = getIncrement (semitones, outputRate);
+
+                expectMatches (renderLinear (source, increment), expected, 1.0e-6f);
+                expectMatches (renderLanes (source, increment), expected, 1.0e-4f);
+            }
+        }
+
+        beginTest ("Hermite matches the Catmull-Rom formula");
+        {
+            Positions positions (getRandom());
+            float output[Positions::numPositions];
+            SampleKernels::interpolateHermite (source.getReadPointer (0), positions.indices, positions.fractions,
+                                               output, Positions::numPositions);
+
+            float worst = 0.0f;
+
+            for (int i = 0; i < Positions::numPositions; ++i)
+            {
+                auto expected = catmullRom (source.getReadPointer (0, positions.indices[i]), positions.fractions[i]);
+                worst = juce::jmax (worst, std::abs (output[i] - (float) expected));
+            }
+
+            expectLessThan (worst, 1.0e-5f);
+        }
+
+        beginTest ("Sinc matches a windowed sinc worked out at each position");
+
+        for (auto increment : { 0.5, 1.0, 1.3, 2.0, 3.7, 8.0 })
+        {
+            Positions positions (getRandom());
+            float output[Positions::numPositions];
+            SampleKernels::interpolateSinc (source.getReadPointer (0), positions.indices, positions.fractions,
+                                            output, Positions::numPositions, increment);
+
+            float worst = 0.0f;
+
+            for (int i = 0; i < Positions::numPositions; ++i)
+            {
+                auto expected = windowedSinc (source.getReadPointer (0, positions.indices[i]), positions.fractions[i], increment);
+                worst = juce::jmax (worst, std::abs (output[i] - (float) expected));
+            }
+
+            // The tables hold 128 phases and blend between them
+            expectLessThan (worst, 1.0e-4f);
+        }
+
+        beginTest ("Every tier passes DC at unity gain");
+
+        for (auto quality : { SampleKernels::linear, SampleKernels::hermite, SampleKernels::sinc })
+        {
+            juce::AudioBuffer<float> dc (1, sourceLength);
+            juce::FloatVectorOperations::fill (dc.getWritePointer (0), 0.7f, sourceLength);
+
+            Positions positions (getRandom());
+            float output[Positions::numPositions];
+            SampleKernels::interpolate (quality, dc.getReadPointer (0), positions.indices, positions.fractions,
+                                        output, Positions::numPositions, 1.0);
+
+            auto range = juce::FloatVectorOperations::findMinAndMax (output, Positions::numPositions);
+            expectWithinAbsoluteError (range.getStart(), 0.7f, 1.0e-5f);
+            expectWithinAbsoluteError (range.getEnd(), 0.7f, 1.0e-5f);
+        }
+
+        beginTest ("Sinc keeps a tone pitched up past Nyquist from aliasing");
+        {
+            // 0.8 of Nyquist an octave up lands at 1.6 of it, which linear
+            // interpolation folds back down to 0.4 at full level
+            expectGreaterThan (getAliasLevel (SampleKernels::linear), -1.0f);
+            expectLessThan (getAliasLevel (SampleKernels::sinc), -70.0f);
+        }
+    }
+
+private:
+    static constexpr double sourceRate = 44100.0;
+    static constexpr int rootNote = 60;
+    static constexpr int sourceLength = 8192;
+    static constexpr int numOutputSamples = 2048;
+
+    // The voices render in chunks of this many samples
+    static constexpr int chunkSize = 64;
+
+    // Random positions spread over the source, clear of both ends
+    struct Positions
+    {
+        explicit Positions (juce::Random random)
+        {
+            auto margin = SampleKernels::maxKernelSpan;
+
+            for (int i = 0; i < numPositions; ++i)
+            {
+                indices[i] = margin + random.nextInt (sourceLength - 2 * margin);
+                fractions[i] = random.nextFloat();
+            }
+        }
+
+        static constexpr int numPositions = 1000;
+
+        int indices[numPositions];
+        float fractions[numPositions];
+    };
+
+    juce::AudioBuffer<float> makeNoise (int numSamples)
+    {
+        auto random = getRandom();
+        juce::AudioBuffer<float> noise (1, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+            noise.setSample (0, i, random.nextFloat() * 2.0f - 1.0f);
+
+        return noise;
+    }
+
+    static double getIncrement (int semitones, double outputRate)
+    {
+        return std::pow (2.0, semitones / 12.0) * sourceRate / outputRate;
+    }
+
+    // The reference: a juce::SamplerVoice moves a double position on by the
+    // increment every sample and blends the frames either side of it
+    static juce::AudioBuffer<float> renderWithSamplerVoice (const juce::AudioBuffer<float>& source,
+                                                           int semitones, double outputRate)
+    {
+        juce::MemoryBlock wavData;
+
+        {
+            // 32-bit WAV is float, so the voice plays exactly the same data
+            juce::WavAudioFormat wav;
+            std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (new juce::MemoryOutputStream (wavData, false),
+                                                                                  sourceRate, 1, 32, {}, 0));
+            writer->writeFromAudioSampleBuffer (source, 0, source.getNumSamples());
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader (juce::WavAudioFormat().createReaderFor (new juce::MemoryInputStream (wavData, false),
+                                                                                                 true));
+        juce::BigInteger notes;
+        notes.setRange (0, 128, true);
+
+        // No attack or release, and the default sustain of 1, so the
+        // envelope stays at full level
+        juce::Synthesiser synth;
+        synth.addVoice (new juce::SamplerVoice());
+        synth.addSound (new juce::SamplerSound ("Noise", *reader, notes, rootNote, 0.0, 0.0, 10.0));
+        synth.setCurrentPlaybackSampleRate (outputRate);
+
+        juce::MidiBuffer midi;
+        midi.addEvent (juce::MidiMessage::noteOn (1, rootNote + semitones, 1.0f), 0);
+
+        juce::AudioBuffer<float> output (1, numOutputSamples);
+        output.clear();
+        synth.renderNextBlock (output, midi, 0, numOutputSamples);
+
+        return output;
+    }
+
+    // How MySamplerVoice renders a resident sound: positions relative to the
+    // first frame of each chunk, then the vectorised blend
+    static juce::AudioBuffer<float> renderLinear (const juce::AudioBuffer<float>& source, double increment)
+    {
+        juce::AudioBuffer<float> output (1, numOutputSamples);
+        int indices[chunkSize];
+        float fractions[chunkSize];
+        double position = 0.0;
+
+        for (int start = 0; start < numOutputSamples; start += chunkSize)
+        {
+            auto numThisTime = juce::jmin (chunkSize, numOutputSamples - start);
+            auto base = (int) position;
+
+            SampleKernels::computePositions (position - base, increment, indices, fractions, numThisTime);
+            SampleKernels::interpolateLinear (source.getReadPointer (0, base), indices, fractions,
+                                              output.getWritePointer (0, start), numThisTime);
+
+            position += numThisTime * increment;
+        }
+
+        return output;
+    }
+
+    // The lane engine's path for the same voice, in lane 0 of a group whose
+    // other lanes are silent. Its positions are floats within a chunk.
+    static juce::AudioBuffer<float> renderLanes (const juce::AudioBuffer<float>& source, double increment)
+    {
+        constexpr auto lanes = SampleKernels::lanesPerGroup;
+
+        juce::AudioBuffer<float> output (1, numOutputSamples);
+        output.clear();
+
+        float silence[4] {};
+        float envelopes[chunkSize * lanes], accumulatorL[chunkSize * lanes], accumulatorR[chunkSize * lanes];
+        juce::FloatVectorOperations::fill (envelopes, 1.0f, chunkSize * lanes);
+        double position = 0.0;
+
+        for (int start = 0; start < numOutputSamples; start += chunkSize)
+        {
+            auto numThisTime = juce::jmin (chunkSize, numOutputSamples - start);
+            auto base = (int) position;
+
+            SampleKernels::LaneGroup group;
+
+            for (int j = 0; j < lanes; ++j)
+            {
+                group.sourceL[j] = group.sourceR[j] = silence;
+                group.fraction[j] = group.increment[j] = group.gainL[j] = group.gainR[j] = 0.0f;
+            }
+
+            group.sourceL[0] = group.sourceR[0] = source.getReadPointer (0, base);
+            group.fraction[0] = (float) (position - base);
+            group.increment[0] = (float) increment;
+            group.gainL[0] = group.gainR[0] = 1.0f;
+
+            juce::FloatVectorOperations::clear (accumulatorL, numThisTime * lanes);
+            juce::FloatVectorOperations::clear (accumulatorR, numThisTime * lanes);
+
+            SampleKernels::renderLaneGroup (group, envelopes, lanes, accumulatorL, accumulatorR, numThisTime);
+            SampleKernels::sumLanes (accumulatorL, output.getWritePointer (0, start), numThisTime);
+
+            position += numThisTime * increment;
+        }
+
+        return output;
+    }
+
+    // The cubic through frames -1 to 2, in its textbook form
+    static double catmullRom (const float* s, double t)
+    {
+        return 0.5 * (2.0 * s[0]
+                      + (s[1] - s[-1]) * t
+                      + (2.0 * s[-1] - 5.0 * s[0] + 4.0 * s[1] - s[2]) * t * t
+                      + (3.0 * s[0] - s[-1] - 3.0 * s[1] + s[2]) * t * t * t);
+    }
+
+    // The 16 taps around the position, from the Blackman-windowed sinc at the
+    // cutoff SampleKernels picks for this increment, scaled to unity gain at DC
+    static double windowedSinc (const float* s, double fraction, double increment)
+    {
+        auto band = increment <= 1.0 ? 0 : juce::jmin (8, (int) std::ceil (4.0 * std::log2 (increment)));
+        auto cutoff = 0.9 * std::pow (2.0, -band / 4.0);
+        auto halfWidth = SampleKernels::sincTaps / 2;
+        double sum = 0.0, gain = 0.0;
+
+        for (int offset = 1 - halfWidth; offset <= halfWidth; ++offset)
+        {
+            auto x = offset - fraction;
+            auto window = 0.42 + 0.5 * std::cos (juce::MathConstants<double>::pi * x / halfWidth)
+                               + 0.08 * std::cos (juce::MathConstants<double>::twoPi * x / halfWidth);
+            auto tap = window * (x == 0.0 ? 1.0 : std::sin (juce::MathConstants<double>::pi * cutoff * x)
+                                                  / (juce::MathConstants<double>::pi * cutoff * x));
+            sum += tap * s[offset];
+            gain += tap;
+        }
+
+        return sum / gain;
+    }
+
+    // Level, in dB relative to the source, of a 0.8-Nyquist tone played an
+    // octave up
+    static float getAliasLevel (SampleKernels::Quality quality)
+    {
+        constexpr int numSamples = 1024;
+        constexpr double increment = 2.0;
+        auto margin = SampleKernels::maxKernelSpan;
+
+        juce::AudioBuffer<float> tone (1, (int) (numSamples * increment) + 2 * margin);
+
+        for (int i = 0; i < tone.getNumSamples(); ++i)
+            tone.setSample (0, i, (float) std::sin (0.8 * juce::MathConstants<double>::pi * i));
+
+        int indices[numSamples];
+        float fractions[numSamples], output[numSamples];
+        SampleKernels::computePositions (0.0, increment, indices, fractions, numSamples);
+        SampleKernels::interpolate (quality, tone.getReadPointer (0, margin), indices, fractions, output, numSamples, increment);
+
+        double power = 0.0;
+
+        for (auto sample : output)
+            power += (double) sample * sample;
+
+        // A full-scale sine has a mean power of 1/2
+        return (float) (10.0 * std::log10 (juce::jmax (1.0e-20, 2.0 * power / numSamples)));
+    }
+
+    void expectMatches (const juce::AudioBuffer<float>& actual, const juce::AudioBuffer<float>& expected, float tolerance)
+    {
+        float worst = 0.0f;
+
+        for (int i = 0; i < numOutputSamples; ++i)
+            worst = juce::jmax (worst, std::abs (actual.getSample (0, i) - expected.getSample (0, i)));
+
+        expectLessThan (worst, tolerance);
+    }
+};
+
+static SampleKernelsTests sampleKernelsTests;
+
+#endif
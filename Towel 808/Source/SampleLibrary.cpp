@@ -0,0 +1,387 @@
+/*
+  ==============================================================================
+    Persistent index of the sample folders, shared by every plugin instance.
+  ==============================================================================
+*/
+
+#include "SampleLibrary.h"
+
+namespace
+{
+    // Bump when the stored fields change; an index of any other version is ignored
+    constexpr int indexVersion = 2;
+
+    const juce::Identifier indexType ("SampleLibraryIndex");
+    const juce::Identifier directoryType ("Directory");
+    const juce::Identifier sampleType ("Sample");
+}
+
+//==============================================================================
+SampleLibrary::SampleLibrary()
+    : juce::Thread ("Towel 808 Sample Library")
+{
+    formatManager.registerBasicFormats();
+    loadIndex();
+    startThread();
+}
+
+SampleLibrary::~SampleLibrary()
+{
+    stopThread (4000);
+}
+
+//==============================================================================
+juce::Array<juce::File> SampleLibrary::getFiles (const juce::File& directory)
+{
+    bool shouldCheck;
+    juce::Array<juce::File> files;
+
+    {
+        const juce::ScopedLock sl (lock);
+        auto& index = getIndex (directory);
+        files = index.files;
+        shouldCheck = ! (index.checked || index.queued);
+        index.queued = true;
+    }
+
+    if (shouldCheck)
+        notify();
+
+    return files;
+}
+
+juce::StringArray SampleLibrary::getNames (const juce::File& directory)
+{
+    bool shouldCheck;
+    juce::StringArray names;
+
+    {
+        const juce::ScopedLock sl (lock);
+        auto& index = getIndex (directory);
+        names = index.names;
+        shouldCheck = ! (index.checked || index.queued);
+        index.queued = true;
+    }
+
+    if (shouldCheck)
+        notify();
+
+    return names;
+}
+
+bool SampleLibrary::findEntry (const juce::File& file, Entry& result) const
+{
+    const juce::ScopedLock sl (lock);
+
+    for (auto* index : directories)
+    {
+        if (! file.isAChildOf (index->directory))
+            continue;
+
+        for (auto& entry : index->entries)
+        {
+            if (entry.file == file)
+            {
+                result = entry;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void SampleLibrary::refresh (const juce::File& directory)
+{
+    const juce::ScopedLock cl (checkLock);
+
+    {
+        const juce::ScopedLock sl (lock);
+        getIndex (directory).checked = false;
+    }
+
+    check (directory);
+}
+
+//==============================================================================
+void SampleLibrary::run()
+{
+    while (! threadShouldExit())
+    {
+        juce::File next;
+
+        {
+            const juce::ScopedLock sl (lock);
+
+            for (auto* index : directories)
+            {
+                if (index->queued && ! index->checked)
+                {
+                    next = index->directory;
+                    break;
+                }
+            }
+        }
+
+        if (next == juce::File())
+            wait (-1);
+        else
+            check (next);
+    }
+}
+
+SampleLibrary::DirectoryIndex& SampleLibrary::getIndex (const juce::File& directory)
+{
+    for (auto* index : directories)
+        if (index->directory == directory)
+            return *index;
+
+    auto* index = directories.add (new DirectoryIndex());
+    index->directory = directory;
+    return *index;
+}
+
+void SampleLibrary::check (const juce::File& directory)
+{
+    const juce::ScopedLock cl (checkLock);
+    juce::Array<Entry> previous;
+
+    {
+        const juce::ScopedLock sl (lock);
+        auto& index = getIndex (directory);
+
+        if (index.checked)
+            return;
+
+        previous = index.entries;
+    }
+
+    // Listing the folder and reading each file's size and date is all it
+    // takes to find out what is still valid
+    juce::Array<juce::File> found;
+
+    if (directory.isDirectory())
+        directory.findChildFiles (found, juce::File::findFiles, false, "*.wav");
+
+    found.sort();
+
+    juce::Array<Entry> entries;
+    bool changed = found.size() != previous.size();
+
+    for (auto& file : found)
+    {
+        if (threadShouldExit())
+            return;
+
+        Entry entry;
+        entry.file = file;
+        entry.modificationTime = file.getLastModificationTime().toMilliseconds();
+        entry.fileSize = file.getSize();
+
+        auto* existing = std::find_if (previous.begin(), previous.end(),
+                                       [&file] (const Entry& e) { return e.file == file; });
+
+        if (existing != previous.end()
+             && existing->modificationTime == entry.modificationTime
+             && existing->fileSize == entry.fileSize)
+        {
+            entry = *existing;
+        }
+        else
+        {
+            changed = true;
+
+            // A file that can't be read is left out, and tried again next time
+            if (! analyse (file, entry))
+                continue;
+        }
+
+        entries.add (entry);
+    }
+
+    {
+        const juce::ScopedLock sl (lock);
+        auto& index = getIndex (directory);
+        index.entries = entries;
+        index.files.clearQuick();
+        index.names.clearQuick();
+
+        for (auto& entry : entries)
+        {
+            index.files.add (entry.file);
+            index.names.add (entry.file.getFileNameWithoutExtension());
+        }
+
+        index.checked = true;
+        index.queued = false;
+    }
+
+    if (changed)
+    {
+        saveIndex();
+        sendChangeMessage();
+    }
+}
+
+bool SampleLibrary::analyse (const juce::File& file, Entry& entry)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return false;
+
+    entry.format = reader->getFormatName();
+    entry.lengthInSamples = reader->lengthInSamples;
+    entry.sampleRate = reader->sampleRate;
+    entry.numChannels = (int) reader->numChannels;
+
+    // Measured over the channels the sampler plays
+    constexpr int chunkSize = 32768;
+    auto numChannels = juce::jmin (2, entry.numChannels);
+    juce::AudioBuffer<float> buffer (numChannels, chunkSize);
+    SampleAnalyser analyser (reader->sampleRate, numChannels);
+
+    entry.waveform.clearQuick();
+    entry.waveform.insertMultiple (0, 0.0f, waveformPoints);
+    double sumOfSquares = 0.0;
+
+    for (juce::int64 start = 0; start < entry.lengthInSamples; start += chunkSize)
+    {
+        auto numThisTime = (int) juce::jmin ((juce::int64) chunkSize, entry.lengthInSamples - start);
+        reader->read (&buffer, 0, numThisTime, start, true, true);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = buffer.getReadPointer (channel);
+
+            for (int i = 0; i < numThisTime; ++i)
+            {
+                auto point = (int) ((start + i) * waveformPoints / entry.lengthInSamples);
+                auto& level = entry.waveform.getReference (point);
+                level = juce::jmax (level, std::abs (samples[i]));
+                sumOfSquares += (double) samples[i] * samples[i];
+            }
+        }
+
+        analyser.process (buffer, numThisTime);
+    }
+
+    auto result = analyser.getResult();
+    entry.pitch = result.pitch;
+    entry.loudness = result.loudness;
+    entry.truePeak = result.truePeak;
+
+    entry.peak = juce::FloatVectorOperations::findMaximum (entry.waveform.getRawDataPointer(), waveformPoints);
+    entry.rms = (float) std::sqrt (sumOfSquares / ((double) entry.lengthInSamples * numChannels));
+    return true;
+}
+
+//==============================================================================
+juce::File SampleLibrary::getIndexFile()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+             .getChildFile ("Towel 808")
+             .getChildFile ("Library Index.bin");
+}
+
+void SampleLibrary::loadIndex()
+{
+    juce::FileInputStream stream (getIndexFile());
+
+    if (! stream.openedOk())
+        return;
+
+    auto tree = juce::ValueTree::readFromStream (stream);
+
+    if (! tree.hasType (indexType) || (int) tree.getProperty ("version") != indexVersion)
+        return;
+
+    const juce::ScopedLock sl (lock);
+
+    for (auto directoryTree : tree)
+    {
+        auto& index = getIndex (juce::File (directoryTree.getProperty ("path").toString()));
+
+        for (auto sampleTree : directoryTree)
+        {
+            Entry entry;
+            entry.file = index.directory.getChildFile (sampleTree.getProperty ("name").toString());
+            entry.modificationTime = sampleTree.getProperty ("modified");
+            entry.fileSize = sampleTree.getProperty ("size");
+            entry.format = sampleTree.getProperty ("format").toString();
+            entry.lengthInSamples = sampleTree.getProperty ("length");
+            entry.sampleRate = sampleTree.getProperty ("rate");
+            entry.numChannels = sampleTree.getProperty ("channels");
+            entry.peak = sampleTree.getProperty ("peak");
+            entry.rms = sampleTree.getProperty ("rms");
+            entry.pitch = sampleTree.getProperty ("pitch");
+            entry.loudness = sampleTree.getProperty ("loudness");
+            entry.truePeak = sampleTree.getProperty ("truePeak");
+
+            if (auto* waveform = sampleTree.getProperty ("waveform").getBinaryData())
+                entry.waveform.addArray (static_cast<const float*> (waveform->getData()),
+                                         (int) (waveform->getSize() / sizeof (float)));
+
+            index.entries.add (entry);
+            index.files.add (entry.file);
+            index.names.add (entry.file.getFileNameWithoutExtension());
+        }
+    }
+}
+
+void SampleLibrary::saveIndex()
+{
+    juce::ValueTree tree (indexType);
+    tree.setProperty ("version", indexVersion, nullptr);
+
+    {
+        const juce::ScopedLock sl (lock);
+
+        for (auto* index : directories)
+        {
+            juce::ValueTree directoryTree (directoryType);
+            directoryTree.setProperty ("path", index->directory.getFullPathName(), nullptr);
+
+            for (auto& entry : index->entries)
+            {
+                juce::ValueTree sampleTree (sampleType);
+                sampleTree.setProperty ("name", entry.file.getFileName(), nullptr);
+                sampleTree.setProperty ("modified", entry.modificationTime, nullptr);
+                sampleTree.setProperty ("size", entry.fileSize, nullptr);
+                sampleTree.setProperty ("format", entry.format, nullptr);
+                sampleTree.setProperty ("length", entry.lengthInSamples, nullptr);
+                sampleTree.setProperty ("rate", entry.sampleRate, nullptr);
+                sampleTree.setProperty ("channels", entry.numChannels, nullptr);
+                sampleTree.setProperty ("peak", entry.peak, nullptr);
+                sampleTree.setProperty ("rms", entry.rms, nullptr);
+                sampleTree.setProperty ("pitch", entry.pitch, nullptr);
+                sampleTree.setProperty ("loudness", entry.loudness, nullptr);
+                sampleTree.setProperty ("truePeak", entry.truePeak, nullptr);
+                sampleTree.setProperty ("waveform", juce::MemoryBlock (entry.waveform.begin(),
+                                                                        (size_t) entry.waveform.size() * sizeof (float)),
+                                        nullptr);
+                directoryTree.appendChild (sampleTree, nullptr);
+            }
+
+            tree.appendChild (directoryTree, nullptr);
+        }
+    }
+
+    // Written to a temporary file and moved into place, so another process
+    // reading the index never sees half of it
+    auto file = getIndexFile();
+    file.getParentDirectory().createDirectory();
+
+    juce::TemporaryFile temporary (file);
+
+    {
+        juce::FileOutputStream stream (temporary.getFile());
+
+        if (! stream.openedOk())
+            return;
+
+        tree.writeToStream (stream);
+    }
+
+    temporary.overwriteTargetFileWithTemporary();
+}
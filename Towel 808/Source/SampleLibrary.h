@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+    Persistent index of the sample folders, shared by every plugin instance.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleAnalyser.h"
+
+//==============================================================================
+/**
+    Knows which samples are in a folder, and their format, length, rate,
+    channels, levels, pitch, loudness and a waveform overview, without
+    opening any of them.
+
+    The index lives in one file in the user's application data folder and is
+    read once per process; every instance shares it through a
+    SharedResourcePointer. Asking about a folder answers from the index at
+    once and queues the folder to be checked in the background. Only files
+    whose size or modification time has changed since they were indexed are
+    opened again. When a check changes anything, the index is written back
+    and listeners are told on the message thread.
+*/
+class SampleLibrary  : private juce::Thread,
+                       public juce::ChangeBroadcaster
+{
+public:
+    SampleLibrary();
+    ~SampleLibrary() override;
+
+    static constexpr int waveformPoints = 128;
+
+    struct Entry
+    {
+        juce::File file;
+        juce::int64 modificationTime = 0, fileSize = 0;
+        juce::String format;
+        juce::int64 lengthInSamples = 0;
+        double sampleRate = 0.0;
+        int numChannels = 0;
+        float peak = 0.0f, rms = 0.0f;
+
+        // Measured by SampleAnalyser: pitch as a fractional MIDI note (-1 if
+        // it has none), loudness in LUFS and the linear true peak
+        float pitch = -1.0f, loudness = -100.0f, truePeak = 0.0f;
+
+        // Peak level of each of waveformPoints equal slices of the file
+        juce::Array<float> waveform;
+
+        int getRootNote() const noexcept                { return SampleAnalyser::getRootNote (pitch); }
+        float getNormalisationGain() const noexcept     { return SampleAnalyser::getNormalisationGain (loudness, truePeak); }
+    };
+
+    // The folder's samples as last indexed, sorted by name. Never touches
+    // the disk; the folder is checked in the background if it hasn't been
+    // since the index was loaded.
+    juce::Array<juce::File> getFiles (const juce::File& directory);
+    juce::StringArray getNames (const juce::File& directory);
+
+    // Returns false if the file isn't in the index
+    bool findEntry (const juce::File& file, Entry& result) const;
+
+    // Brings a folder's index up to date on the calling thread, for callers
+    // that need the list before they carry on
+    void refresh (const juce::File& directory);
+
+private:
+    struct DirectoryIndex
+    {
+        juce::File directory;
+        juce::Array<Entry> entries;
+        juce::Array<juce::File> files;
+        juce::StringArray names;
+        bool checked = false, queued = false;
+    };
+
+    void run() override;
+
+    DirectoryIndex& getIndex (const juce::File& directory);
+    void check (const juce::File& directory);
+    bool analyse (const juce::File& file, Entry& entry);
+
+    void loadIndex();
+    void saveIndex();
+    static juce::File getIndexFile();
+
+    juce::AudioFormatManager formatManager;
+
+    juce::CriticalSection lock;
+    juce::OwnedArray<DirectoryIndex> directories;
+
+    // Only one folder is checked at a time, by whichever thread asks first
+    juce::CriticalSection checkLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleLibrary)
+};
@@ -0,0 +1,401 @@
+/*
+  ==============================================================================
+    Background thread that decodes samples and hands them to the audio thread.
+  ==============================================================================
+*/
+
+#include "SampleLoader.h"
+
+//==============================================================================
+SampleLoader::SampleLoader (juce::AudioFormatManager& formatManagerToUse, SampleLibrary& libraryToUse)
+    : juce::Thread ("Towel 808 Sample Loader"),
+      formatManager (formatManagerToUse),
+      library (libraryToUse)
+{
+    startThread();
+}
+
+SampleLoader::~SampleLoader()
+{
+    stopThread (4000);
+
+    // Drop the reference the pending slot was holding for the audio thread
+    if (auto* sound = pendingSound.exchange (nullptr))
+        sound->decReferenceCount();
+}
+
+//==============================================================================
+void SampleLoader::loadSample (const juce::File& file, int fallbackRootNote, float fallbackGain)
+{
+    auto sampleRate = hostSampleRate.load();
+
+    {
+        const juce::ScopedLock sl (requestLock);
+        auto serial = ++latestSerial;
+        currentFile = file;
+        currentRootNote = fallbackRootNote;
+        currentGain = fallbackGain;
+
+        // A copy at the host rate, or a bank sample that doesn't need
+        // converting, only needs a pointer change. Streaming sounds are never
+        // shared, so they always go to the loader thread. The cache is only
+        // asked about a version of the file the library has seen, since
+        // checking the file itself would mean touching the disk here.
+        if (! streamingEnabled || bank.isEnabled())
+        {
+            MySamplerSound::Ptr sound;
+            SampleLibrary::Entry analysis;
+
+            if (library.findEntry (file, analysis))
+                sound = rateCache->findSound (file, { analysis.modificationTime, analysis.fileSize },
+                                              sampleRate, compactStorage);
+
+            // The bank may still be in the old format until the loader rebuilds it
+            if (sound == nullptr)
+                if (auto banked = bank.findSound (file))
+                    if (! needsConverting (*banked, sampleRate) && banked->isCompact() == compactStorage)
+                        sound = banked;
+
+            if (sound != nullptr)
+            {
+                requestedFile = juce::File();
+                publish (sound.get());
+                finishedSerial = serial;
+                return;
+            }
+        }
+
+        requestedFile = file;
+        requestedSerial = serial;
+    }
+
+    notify();
+}
+
+void SampleLoader::setHostSampleRate (double sampleRate)
+{
+    if (hostSampleRate.exchange (sampleRate) == sampleRate)
+        return;
+
+    juce::File file;
+    int rootNote;
+    float gain;
+
+    {
+        const juce::ScopedLock sl (requestLock);
+        file = currentFile;
+        rootNote = currentRootNote;
+        gain = currentGain;
+    }
+
+    if (file != juce::File())
+        loadSample (file, rootNote, gain);
+}
+
+void SampleLoader::setBankMode (bool enabled, size_t memoryBudgetBytes, const juce::Array<juce::File>& files)
+{
+    {
+        const juce::ScopedLock sl (requestLock);
+        requestedBankSettings = { enabled, memoryBudgetBytes, files, compactStorage };
+        bankSettingsChanged = true;
+    }
+
+    notify();
+}
+
+void SampleLoader::setCompactStorage (bool enabled)
+{
+    juce::File file;
+    int rootNote;
+    float gain;
+
+    {
+        const juce::ScopedLock sl (requestLock);
+
+        if (compactStorage == enabled)
+            return;
+
+        compactStorage = enabled;
+        requestedBankSettings.compact = enabled;
+        bankSettingsChanged = true;
+        file = currentFile;
+        rootNote = currentRootNote;
+        gain = currentGain;
+    }
+
+    // The current sample is reloaded in the new format
+    if (file != juce::File())
+        loadSample (file, rootNote, gain);
+    else
+        notify();
+}
+
+void SampleLoader::setStreamingMode (bool enabled, double headLengthSeconds)
+{
+    const juce::ScopedLock sl (requestLock);
+    streamingEnabled = enabled;
+    streamingHeadLength = headLengthSeconds;
+}
+
+MySamplerSound::Ptr SampleLoader::takePendingSound() noexcept
+{
+    MySamplerSound::Ptr sound (pendingSound.exchange (nullptr));
+
+    // The slot's reference now belongs to us. The loader's list or the bank
+    // still holds another one, so this can never be the last release.
+    if (sound != nullptr)
+        sound->decReferenceCountWithoutDeleting();
+
+    return sound;
+}
+
+bool SampleLoader::hasFinishedLoading() const noexcept
+{
+    return finishedSerial.load() == latestSerial.load();
+}
+
+//==============================================================================
+void SampleLoader::run()
+{
+    while (! threadShouldExit())
+    {
+        applyBankSettings();
+        decodeRequestedFile();
+        releaseUnusedSounds();
+
+        // Keep filling the bank without sleeping, one file per pass, so a
+        // user's selection never waits behind the whole preload.
+        if (preloadNextBankFile())
+            continue;
+
+        wait (500);
+    }
+}
+
+void SampleLoader::applyBankSettings()
+{
+    {
+        const juce::ScopedLock sl (requestLock);
+
+        if (! bankSettingsChanged)
+            return;
+
+        bankSettings = requestedBankSettings;
+        bankSettingsChanged = false;
+    }
+
+    // Whatever was in the old arena is retired like any other sound, so it
+    // is only freed once no voice is still playing it.
+    bank.reset (bankSettings.enabled ? bankSettings.memoryBudget : 0, bankSettings.compact, loadedSounds);
+    nextFileToPreload = 0;
+}
+
+void SampleLoader::decodeRequestedFile()
+{
+    juce::File file;
+    bool streaming, compact;
+    double headLength;
+    int serial, rootNote;
+    float gain;
+
+    {
+        const juce::ScopedLock sl (requestLock);
+        std::swap (file, requestedFile);
+        streaming = streamingEnabled;
+        headLength = streamingHeadLength;
+        compact = compactStorage;
+        serial = requestedSerial;
+        rootNote = currentRootNote;
+        gain = currentGain;
+    }
+
+    if (file == juce::File())
+        return;
+
+    // However this request ends, it counts as dealt with once we return. A
+    // newer request has already moved latestSerial on, so this can't mark
+    // that one finished early.
+    struct MarkFinished
+    {
+        ~MarkFinished()     { if (finished.load() < serial) finished = serial; }
+        std::atomic<int>& finished;
+        int serial;
+    } markFinished { finishedSerial, serial };
+
+    juce::BigInteger midiNotes;
+    midiNotes.setRange (0, 128, true); // Respond to all MIDI notes
+
+    SampleLibrary::Entry analysis;
+
+    if (library.findEntry (file, analysis))
+    {
+        rootNote = analysis.getRootNote();
+        gain = analysis.getNormalisationGain();
+    }
+
+    if (streaming && ! bank.isEnabled())
+    {
+        if (auto streamingReader = createStreamingReader (file))
+        {
+            auto* sound = loadedSounds.add (new MySamplerSound (file.getFileNameWithoutExtension(),
+                                                                std::move (streamingReader),
+                                                                midiNotes,
+                                                                rootNote,
+                                                                headLength));
+            sound->setNormalisationGain (gain);
+            sound->measureStreamingLoudness (analysis.waveform);
+            publishIfLatest (sound, serial);
+        }
+
+        return;
+    }
+
+    auto sampleRate = hostSampleRate.load();
+    auto version = SampleRateCache::FileVersion::of (file);
+
+    // A bank sample only gets here when it needs converting
+    MySamplerSound::Ptr sound (bank.findSound (file));
+
+    if (sound == nullptr)
+    {
+        // Another instance may already have this version at the host rate
+        if (auto shared = rateCache->findSound (file, version, sampleRate, compact))
+        {
+            publishIfLatest (shared.get(), serial);
+            return;
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+        if (reader == nullptr)
+            return;
+
+        // In bank mode the selection is allowed to evict older entries
+        if (bank.isEnabled())
+            sound = bank.addSample (file, *reader, rootNote, gain, true);
+
+        // ...or decoded it at the file's own rate
+        if (sound == nullptr)
+            sound = rateCache->findSound (file, version, reader->sampleRate, compact);
+
+        if (sound == nullptr)
+        {
+            auto duration = static_cast<double> (reader->lengthInSamples) / reader->sampleRate;
+
+            sound = new MySamplerSound (file.getFileNameWithoutExtension(),
+                                        *reader,
+                                        midiNotes,
+                                        rootNote,
+                                        0.0,   // Attack time
+                                        0.1,   // Release time
+                                        duration);
+            sound->setNormalisationGain (gain);
+
+            if (compact)
+                sound->makeCompact();
+
+            // One that doesn't fit in the cache stays private to this loader
+            if (auto shared = rateCache->addDecodedSound (file, version, sound.get()))
+                sound = shared;
+            else
+                loadedSounds.add (sound);
+        }
+    }
+
+    // Voices can play the file at its own rate straight away; the converted
+    // copy replaces it as soon as it is ready. One that doesn't fit in the
+    // cache is simply played at the file's rate.
+    if (needsConverting (*sound, sampleRate))
+    {
+        publishIfLatest (sound.get(), serial);
+
+        if (auto converted = rateCache->addSound (file, version, *sound, sampleRate))
+            sound = converted;
+    }
+
+    publishIfLatest (sound.get(), serial);
+}
+
+bool SampleLoader::preloadNextBankFile()
+{
+    if (! bank.isEnabled())
+        return false;
+
+    while (nextFileToPreload < bankSettings.files.size())
+    {
+        auto file = bankSettings.files[nextFileToPreload++];
+
+        if (bank.contains (file))
+            continue;
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+        if (reader == nullptr)
+            continue;
+
+        SampleLibrary::Entry analysis;
+        library.findEntry (file, analysis);
+
+        // Preloading never evicts; once the budget is full, the remaining
+        // files are only decoded into the bank when they're selected.
+        if (bank.addSample (file, *reader, analysis.getRootNote(), analysis.getNormalisationGain(), false) == nullptr)
+            nextFileToPreload = bankSettings.files.size();
+
+        return true;
+    }
+
+    return false;
+}
+
+std::unique_ptr<juce::AudioFormatReader> SampleLoader::createStreamingReader (const juce::File& file)
+{
+    // Memory-mapped readers let the prefetcher read straight from the page
+    // cache; formats that can't be mapped fall back to a normal stream reader.
+    if (auto* format = formatManager.findFormatForFileExtension (file.getFileExtension()))
+    {
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader (format->createMemoryMappedReader (file));
+
+        if (mappedReader != nullptr && mappedReader->mapEntireFile())
+            return mappedReader;
+    }
+
+    return std::unique_ptr<juce::AudioFormatReader> (formatManager.createReaderFor (file));
+}
+
+void SampleLoader::publish (MySamplerSound* sound)
+{
+    // This reference belongs to the pending slot until the audio thread takes it
+    sound->incReferenceCount();
+
+    // If the audio thread never picked up the previous sound, it is simply
+    // superseded; its reference is dropped and the list releases it later.
+    if (auto* superseded = pendingSound.exchange (sound))
+        superseded->decReferenceCount();
+}
+
+void SampleLoader::publishIfLatest (MySamplerSound* sound, int serial)
+{
+    // Holding the lock keeps a newer selection published by loadSample from
+    // being overwritten by this older one
+    const juce::ScopedLock sl (requestLock);
+
+    if (latestSerial.load() == serial)
+        publish (sound);
+}
+
+bool SampleLoader::needsConverting (const MySamplerSound& sound, double sampleRate) noexcept
+{
+    return sampleRate > 0.0 && ! sound.isStreaming() && sound.getSourceSampleRate() != sampleRate;
+}
+
+void SampleLoader::releaseUnusedSounds()
+{
+    // A count of one means only this list still refers to the sound: it is
+    // neither pending, nor installed in the synth, nor held by a sounding voice.
+    for (int i = loadedSounds.size(); --i >= 0;)
+        if (loadedSounds.getObjectPointerUnchecked (i)->getReferenceCount() == 1)
+            loadedSounds.remove (i);
+
+    // Shared copies go once the last instance using them lets go
+    rateCache->releaseUnusedSounds();
+}
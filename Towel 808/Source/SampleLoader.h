@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+    Background thread that decodes samples and hands them to the audio thread.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MySampler.h"
+#include "SampleBank.h"
+#include "SampleLibrary.h"
+#include "SampleRateCache.h"
+
+//==============================================================================
+/**
+    Decodes sample files on its own thread so neither the message thread nor
+    the audio thread ever waits on disk I/O or a large allocation.
+
+    A finished sound is published through a single atomic slot which the audio
+    thread empties at the start of a block. Every sound the loader creates stays
+    in its list until nothing else references it, so the final release (and the
+    buffer deallocation) always happens on the loader thread.
+
+    Decoded and converted sounds go into the process-wide rate cache, so
+    instances that select the same file play the same buffer. Those are
+    owned by the cache rather than by this loader's list.
+
+    Each sound gets the root note and normalisation gain the library measured
+    for its file; one the library hasn't analysed yet gets the fallbacks
+    passed to loadSample, by default middle C at unity gain.
+*/
+class SampleLoader  : private juce::Thread
+{
+public:
+    SampleLoader (juce::AudioFormatManager& formatManagerToUse, SampleLibrary& libraryToUse);
+    ~SampleLoader() override;
+
+    // Queues a file to be decoded. Only the most recent request is kept, so
+    // scrolling quickly through the sample list doesn't build up a backlog.
+    // If the file is already resident at the host rate, in this loader's bank
+    // or decoded by another instance, it is published immediately. The
+    // fallback root note and gain are used if the library hasn't analysed
+    // the file yet.
+    void loadSample (const juce::File& file, int fallbackRootNote = 60, float fallbackGain = 1.0f);
+
+    // Resident sounds are converted to this rate once, in the background, so
+    // voices can play them without resampling. A new rate reloads the current
+    // file; calling it again with the same rate does nothing.
+    void setHostSampleRate (double sampleRate);
+
+    // Enables or disables bank mode. When enabled, every file in the list is
+    // decoded into the bank in the background until the budget is used up.
+    void setBankMode (bool enabled, size_t memoryBudgetBytes, const juce::Array<juce::File>& files);
+
+    // Enables or disables streaming. Streaming sounds keep only their first
+    // headLengthSeconds in memory; bank mode takes precedence when both are on.
+    void setStreamingMode (bool enabled, double headLengthSeconds);
+
+    // Enables or disables compact storage: samples decoded from then on keep
+    // 16-bit data, and dual-mono files a single channel. The bank is rebuilt
+    // in the new format. Streaming heads always stay float.
+    void setCompactStorage (bool enabled);
+
+    // Called by the audio thread once per block. Returns the newest decoded
+    // sound, or nullptr if nothing new has arrived since the last call.
+    MySamplerSound::Ptr takePendingSound() noexcept;
+
+    // True once the most recent loadSample call has been dealt with, either
+    // by publishing its sound or by failing to read the file. Offline renders
+    // wait on this so their first block always plays the requested sample.
+    bool hasFinishedLoading() const noexcept;
+
+private:
+    void run() override;
+
+    void applyBankSettings();
+    void decodeRequestedFile();
+    bool preloadNextBankFile();
+    std::unique_ptr<juce::AudioFormatReader> createStreamingReader (const juce::File& file);
+    void publish (MySamplerSound* sound);
+    void publishIfLatest (MySamplerSound* sound, int serial);
+    static bool needsConverting (const MySamplerSound& sound, double sampleRate) noexcept;
+    void releaseUnusedSounds();
+
+    juce::AudioFormatManager& formatManager;
+    SampleLibrary& library;
+
+    juce::CriticalSection requestLock;
+    juce::File requestedFile, currentFile;
+    int requestedSerial = 0;
+
+    // Fallbacks for the current file, kept for when it is reloaded
+    int currentRootNote = 60;
+    float currentGain = 1.0f;
+
+    // Serials of the latest loadSample call and of the latest one dealt with
+    std::atomic<int> latestSerial { 0 }, finishedSerial { 0 };
+
+    struct BankSettings
+    {
+        bool enabled = false;
+        size_t memoryBudget = 0;
+        juce::Array<juce::File> files;
+        bool compact = false;
+    };
+
+    BankSettings requestedBankSettings, bankSettings;
+    bool bankSettingsChanged = false;
+    int nextFileToPreload = 0;
+
+    SampleBank bank;
+    juce::SharedResourcePointer<SampleRateCache> rateCache;
+    std::atomic<double> hostSampleRate { 0.0 };
+
+    bool streamingEnabled = false;
+    double streamingHeadLength = 0.25;
+    bool compactStorage = false;
+
+    // Holds one reference on behalf of the audio thread until it is taken
+    std::atomic<MySamplerSound*> pendingSound { nullptr };
+
+    // Every sound created by this loader; only touched on the loader thread
+    juce::ReferenceCountedArray<MySamplerSound> loadedSounds;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleLoader)
+};
@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+    Unit tests for SampleLoader.
+  ==============================================================================
+*/
+
+#if JUCE_UNIT_TESTS
+
+#include "SampleLoader.h"
+
+namespace
+{
+    // Holds back every read from the files it opens until it is released, so
+    // a test can keep a decode on the loader thread for as long as it likes
+    struct ReadGate
+    {
+        ReadGate()                  { open.signal(); }
+
+        void close()                { open.reset(); }
+        void release()              { open.signal(); }
+
+        juce::WaitableEvent open { true };
+        std::atomic<int> numReadersOpened { 0 };
+    };
+
+    class GatedReader  : public juce::AudioFormatReader
+    {
+    public:
+        GatedReader (juce::AudioFormatReader* sourceToWrap, ReadGate& gateToUse)
+            : juce::AudioFormatReader (nullptr, sourceToWrap->getFormatName()),
+              source (sourceToWrap),
+              gate (gateToUse)
+        {
+            sampleRate = source->sampleRate;
+            bitsPerSample = source->bitsPerSample;
+            lengthInSamples = source->lengthInSamples;
+            numChannels = source->numChannels;
+            usesFloatingPointData = source->usesFloatingPointData;
+        }
+
+        bool readSamples (int** destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                          juce::int64 startSampleInFile, int numSamples) override
+        {
+            gate.open.wait();
+            return source->readSamples (destChannels, numDestChannels, startOffsetInDestBuffer,
+                                        startSampleInFile, numSamples);
+        }
+
+    private:
+        std::unique_ptr<juce::AudioFormatReader> source;
+        ReadGate& gate;
+    };
+
+    // WAV data in files with a ".gated" extension, read through a GatedReader
+    class GatedFormat  : public juce::AudioFormat
+    {
+    public:
+        explicit GatedFormat (ReadGate& gateToUse)
+            : juce::AudioFormat ("Gated WAV", ".gated"),
+              gate (gateToUse)
+        {
+        }
+
+        juce::Array<int> getPossibleSampleRates() override  { return wav.getPossibleSampleRates(); }
+        juce::Array<int> getPossibleBitDepths() override    { return wav.getPossibleBitDepths(); }
+        bool canDoStereo() override                         { return true; }
+        bool canDoMono() override                           { return true; }
+
+        juce::AudioFormatReader* createReaderFor (juce::InputStream* stream, bool deleteStreamIfOpeningFails) override
+        {
+            auto* reader = wav.createReaderFor (stream, deleteStreamIfOpeningFails);
+
+            if (reader == nullptr)
+                return nullptr;
+
+            ++gate.numReadersOpened;
+            return new GatedReader (reader, gate);
+        }
+
+        using juce::AudioFormat::createWriterFor;
+
+        juce::AudioFormatWriter* createWriterFor (juce::OutputStream*, double, unsigned int, int,
+                                                  const juce::StringPairArray&, int) override
+        {
+            return nullptr;
+        }
+
+    private:
+        juce::WavAudioFormat wav;
+        ReadGate& gate;
+    };
+}
+
+//==============================================================================
+class SampleLoaderTests  : public juce::UnitTest
+{
+public:
+    SampleLoaderTests()  : juce::UnitTest ("SampleLoader", "Towel 808") {}
+
+    void runTest() override
+    {
+        beginTest ("An older decode never replaces a newer selection");
+
+        auto directory = juce::File::getSpecialLocation (juce::File::tempDirectory)
+                             .getNonexistentChildFile ("Towel 808 Tests", {}, false);
+        directory.createDirectory();
+
+        auto selected = directory.getChildFile ("Selected.wav");
+        auto slow = directory.getChildFile ("Slow.gated");
+        auto marker = directory.getChildFile ("Marker.gated");
+
+        for (auto& file : { selected, slow, marker })
+            writeTone (file);
+
+        {
+            ReadGate gate;
+            juce::AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+            formatManager.registerFormat (new GatedFormat (gate), false);
+
+            SampleLibrary library;
+            SampleLoader loader (formatManager, library);
+
+            // Once the selected file is in the bank, at a rate that needs no
+            // converting, selecting it again is published by loadSample itself
+            loader.setBankMode (true, bankBudget, { selected });
+            loader.loadSample (selected);
+            expect (waitFor ([&] { return loader.hasFinishedLoading(); }));
+            expect (isSound (loader.takePendingSound(), "Selected"));
+
+            // The slow file's decode is stuck on the loader thread while the
+            // selected file is chosen again through the fast path
+            gate.close();
+            loader.loadSample (slow);
+            expect (waitFor ([&] { return gate.numReadersOpened.load() == 1; }));
+
+            loader.loadSample (selected);
+            expect (loader.hasFinishedLoading());
+
+            // The loader only opens the marker file to preload it after it
+            // has finished with the slow one
+            loader.setBankMode (true, bankBudget, { selected, marker });
+            gate.release();
+            expect (waitFor ([&] { return gate.numReadersOpened.load() == 2; }));
+
+            expect (loader.hasFinishedLoading());
+            expect (isSound (loader.takePendingSound(), "Selected"));
+            expect (loader.takePendingSound() == nullptr);
+        }
+
+        directory.deleteRecursively();
+    }
+
+private:
+    static constexpr size_t bankBudget = 16 * 1024 * 1024;
+
+    static void writeTone (const juce::File& file)
+    {
+        juce::AudioBuffer<float> tone (1, 4410);
+
+        for (int i = 0; i < tone.getNumSamples(); ++i)
+            tone.setSample (0, i, 0.5f * std::sin (0.05f * (float) i));
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (file.createOutputStream().release(),
+                                                                              44100.0, 1, 16, {}, 0));
+
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer (tone, 0, tone.getNumSamples());
+    }
+
+    static bool isSound (const MySamplerSound::Ptr& sound, const juce::String& name)
+    {
+        return sound != nullptr && sound->getName() == name;
+    }
+
+    static bool waitFor (std::function<bool()> condition)
+    {
+        for (auto timeout = juce::Time::getMillisecondCounter() + 10000; ! condition();)
+        {
+            if (juce::Time::getMillisecondCounter() > timeout)
+                return false;
+
+            juce::Thread::sleep (1);
+        }
+
+        return true;
+    }
+};
+
+static SampleLoaderTests sampleLoaderTests;
+
+#endif
@@ -0,0 +1,243 @@
+/*
+  ==============================================================================
+    Background prefetching of streamed samples into per-voice ring buffers.
+  ==============================================================================
+*/
+
+#include "SamplePrefetcher.h"
+
+//==============================================================================
+SamplePrefetcher::SamplePrefetcher (int numStreams)
+    : juce::Thread ("Towel 808 Prefetcher")
+{
+    for (int i = 0; i < numStreams; ++i)
+        streams.add (new Stream());
+}
+
+SamplePrefetcher::~SamplePrefetcher()
+{
+    // The thread sleeps on its own event rather than the juce::Thread one
+    signalThreadShouldExit();
+    wakeUp.signal();
+    stopThread (4000);
+
+    // Drop any references still sitting in unprocessed start commands
+    int start1, size1, start2, size2;
+    commandFifo.prepareToRead (commandFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)  commands[start1 + i].sound->decReferenceCount();
+    for (int i = 0; i < size2; ++i)  commands[start2 + i].sound->decReferenceCount();
+
+    commandFifo.finishedRead (size1 + size2);
+}
+
+void SamplePrefetcher::prepare()
+{
+    if (prepared.load())
+        return;
+
+    for (auto* stream : streams)
+        stream->ring.setSize (2, ringSize);
+
+    prepared = true;
+    startThread();
+}
+
+//==============================================================================
+bool SamplePrefetcher::startStream (int index, MySamplerSound* sound, juce::int64 startFrame) noexcept
+{
+    auto& stream = *streams.getUnchecked (index);
+
+    // Whatever happens, the previous stream for this voice is finished with
+    stream.releasedSerial.store (stream.serial);
+
+    if (commandFifo.getFreeSpace() == 0)
+        return false;
+
+    // The command holds its own reference until the prefetch thread adopts it
+    sound->incReferenceCount();
+
+    int start1, size1, start2, size2;
+    commandFifo.prepareToWrite (1, start1, size1, start2, size2);
+    commands[size1 > 0 ? start1 : start2] = { index, ++stream.serial, sound, startFrame };
+    commandFifo.finishedWrite (1);
+
+    stream.firstFrame = startFrame;
+    wakeUp.signal();
+    return true;
+}
+
+void SamplePrefetcher::stopStream (int index) noexcept
+{
+    auto& stream = *streams.getUnchecked (index);
+    stream.releasedSerial.store (stream.serial);
+
+    // Lets the thread drop its reference to the sound straight away
+    wakeUp.signal();
+}
+
+bool SamplePrefetcher::readFrames (int index, juce::int64 firstFrame, int numFrames, float* left, float* right) const noexcept
+{
+    auto& stream = *streams.getUnchecked (index);
+
+    if (stream.acknowledgedSerial.load (std::memory_order_acquire) != stream.serial)
+        return false;
+
+    auto offset = firstFrame - stream.firstFrame;
+    auto numReady = stream.fifo.getNumReady();
+
+    if (offset < 0 || offset + numFrames > numReady)
+        return false;
+
+    int start1, size1, start2, size2;
+    stream.fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+    // The requested frames may wrap around the end of the ring
+    auto start = (start1 + (int) offset) % ringSize;
+    auto numBeforeWrap = juce::jmin (numFrames, ringSize - start);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        auto* dest = ch == 0 ? left : right;
+        auto* ring = stream.ring.getReadPointer (ch);
+
+        juce::FloatVectorOperations::copy (dest, ring + start, numBeforeWrap);
+
+        if (numBeforeWrap < numFrames)
+            juce::FloatVectorOperations::copy (dest + numBeforeWrap, ring, numFrames - numBeforeWrap);
+    }
+
+    return true;
+}
+
+void SamplePrefetcher::discardBefore (int index, juce::int64 frame) noexcept
+{
+    auto& stream = *streams.getUnchecked (index);
+
+    if (stream.acknowledgedSerial.load (std::memory_order_acquire) != stream.serial)
+        return;
+
+    // If the voice has run ahead of the prefetcher we can only drop what has
+    // arrived; the rest is dropped as it comes in on later blocks.
+    auto numToDiscard = (int) juce::jmin ((juce::int64) stream.fifo.getNumReady(), frame - stream.firstFrame);
+
+    if (numToDiscard > 0)
+    {
+        stream.fifo.finishedRead (numToDiscard);
+        stream.firstFrame += numToDiscard;
+    }
+}
+
+//==============================================================================
+void SamplePrefetcher::run()
+{
+    while (! threadShouldExit())
+    {
+        handleCommands();
+
+        // A voice that freed a lot of its ring while we were reading needs
+        // topping up again before we sleep
+        if (fillStreams())
+            continue;
+
+        // Every ring is nearly full. Voices don't wake us as they read, so
+        // look again shortly while anything is streaming; otherwise sleep
+        // until a voice starts a stream.
+        wakeUp.wait (isStreaming() ? refillIntervalMs : -1);
+    }
+}
+
+void SamplePrefetcher::handleCommands()
+{
+    int start1, size1, start2, size2;
+    commandFifo.prepareToRead (commandFifo.getNumReady(), start1, size1, start2, size2);
+
+    auto handle = [this] (const Command& command)
+    {
+        auto& stream = *streams.getUnchecked (command.index);
+
+        stream.sound = command.sound;
+        command.sound->decReferenceCount();   // adopted by stream.sound above
+
+        stream.fifo.reset();
+        stream.nextFrame = command.startFrame;
+        stream.endFrame = command.sound->getTotalNumSamples();
+        stream.activeSerial = command.serial;
+
+        stream.acknowledgedSerial.store (command.serial, std::memory_order_release);
+    };
+
+    for (int i = 0; i < size1; ++i)  handle (commands[start1 + i]);
+    for (int i = 0; i < size2; ++i)  handle (commands[start2 + i]);
+
+    commandFifo.finishedRead (size1 + size2);
+}
+
+bool SamplePrefetcher::fillStreams()
+{
+    bool anyNeedsMore = false;
+
+    for (auto* stream : streams)
+    {
+        if (stream->sound == nullptr)
+            continue;
+
+        if (stream->releasedSerial.load() == stream->activeSerial)
+        {
+            // Releasing here means the last reference can only ever be
+            // dropped on this thread or the loader's, never the audio thread
+            stream->sound = nullptr;
+            continue;
+        }
+
+        auto numFree = stream->fifo.getFreeSpace();
+        auto numToRead = (int) juce::jmin ((juce::int64) numFree, stream->endFrame - stream->nextFrame);
+
+        // Waits until there is room for a large read, unless this one
+        // finishes the file
+        if (numToRead <= 0 || (numFree < refillThreshold && numToRead == numFree))
+            continue;
+
+        auto* reader = stream->sound->getStreamingReader();
+        auto numChannels = juce::jmin (2, (int) reader->numChannels);
+
+        int start1, size1, start2, size2;
+        stream->fifo.prepareToWrite (numToRead, start1, size1, start2, size2);
+
+        auto readInto = [&] (int start, int size)
+        {
+            if (size <= 0)
+                return;
+
+            float* channels[2] = { stream->ring.getWritePointer (0, start),
+                                   stream->ring.getWritePointer (1, start) };
+
+            juce::AudioBuffer<float> destination (channels, numChannels, size);
+            reader->read (&destination, 0, size, stream->nextFrame, true, true);
+
+            if (numChannels == 1)
+                juce::FloatVectorOperations::copy (channels[1], channels[0], size);
+
+            stream->nextFrame += size;
+        };
+
+        readInto (start1, size1);
+        readInto (start2, size2);
+
+        stream->fifo.finishedWrite (size1 + size2);
+
+        anyNeedsMore = anyNeedsMore || (stream->fifo.getFreeSpace() >= refillThreshold
+                                          && stream->nextFrame < stream->endFrame);
+    }
+
+    return anyNeedsMore;
+}
+
+bool SamplePrefetcher::isStreaming() const noexcept
+{
+    for (auto* stream : streams)
+        if (stream->sound != nullptr)
+            return true;
+
+    return false;
+}
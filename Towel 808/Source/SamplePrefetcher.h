@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+    Background prefetching of streamed samples into per-voice ring buffers.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MySampler.h"
+#include "AudioThreadEvent.h"
+
+//==============================================================================
+/**
+    Feeds voices that play streaming sounds. Each voice owns one stream (a ring
+    buffer indexed by its voice number); the prefetch thread keeps the rings
+    topped up from the sound's reader while the voice plays the resident head.
+
+    The audio thread starts a stream by posting a command through a lock-free
+    FIFO and then ignores the ring until the prefetch thread acknowledges that
+    command, so the two sides never touch a ring while it is being reset.
+
+    Voices wake the thread through an AudioThreadEvent when they start or
+    stop a stream, which never takes a lock. They don't wake it as they read:
+    while anything is streaming the thread looks at the rings every few
+    milliseconds, and with nothing streaming it sleeps until a voice starts.
+    It isn't started at all until streaming is first switched on.
+*/
+class SamplePrefetcher  : private juce::Thread
+{
+public:
+    explicit SamplePrefetcher (int numStreams);
+    ~SamplePrefetcher() override;
+
+    // Number of source frames each voice can buffer ahead of its read position
+    static constexpr int ringSize = 16384;
+
+    // A ring is topped up once this much of it is free, so each read from
+    // the disk is a large one and the ring never gets near running dry
+    static constexpr int refillThreshold = ringSize / 4;
+
+    // How often the thread looks at the rings while anything is streaming.
+    // A ring at the threshold still holds 16 ms for a voice playing four
+    // octaves above its root at 48 kHz.
+    static constexpr int refillIntervalMs = 2;
+
+    // Allocates the ring buffers and starts the thread. Must be called on the
+    // message thread before any streaming sound is created.
+    void prepare();
+    bool isPrepared() const noexcept    { return prepared.load(); }
+
+    //==============================================================================
+    // The functions below are called by the voice that owns the stream.
+
+    // Starts streaming the sound from the given frame onwards. Returns false if
+    // the command queue is full, in which case the voice only plays the head.
+    bool startStream (int index, MySamplerSound* sound, juce::int64 startFrame) noexcept;
+
+    // Tells the prefetch thread this voice no longer needs its stream
+    void stopStream (int index) noexcept;
+
+    // Copies numFrames frames starting at firstFrame out of the ring. Returns
+    // false, leaving the destinations untouched, if they haven't all arrived.
+    bool readFrames (int index, juce::int64 firstFrame, int numFrames, float* left, float* right) const noexcept;
+
+    // Frees the ring space used by frames before `frame`
+    void discardBefore (int index, juce::int64 frame) noexcept;
+
+private:
+    struct Stream
+    {
+        juce::AudioBuffer<float> ring;
+        juce::AbstractFifo fifo { ringSize };
+        std::atomic<int> acknowledgedSerial { 0 }, releasedSerial { 0 };
+
+        // Audio thread only
+        int serial = 0;
+        juce::int64 firstFrame = 0;
+
+        // Prefetch thread only
+        MySamplerSound::Ptr sound;
+        int activeSerial = 0;
+        juce::int64 nextFrame = 0, endFrame = 0;
+    };
+
+    struct Command
+    {
+        int index, serial;
+        MySamplerSound* sound;
+        juce::int64 startFrame;
+    };
+
+    void run() override;
+    void handleCommands();
+
+    // Tops up every ring. Returns true if one still has enough room to
+    // need another pass straight away.
+    bool fillStreams();
+    bool isStreaming() const noexcept;
+
+    juce::OwnedArray<Stream> streams;
+    std::atomic<bool> prepared { false };
+    AudioThreadEvent wakeUp;
+
+    static constexpr int maxCommands = 256;
+    juce::AbstractFifo commandFifo { maxCommands };
+    Command commands[maxCommands];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplePrefetcher)
+};
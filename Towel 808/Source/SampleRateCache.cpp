@@ -0,0 +1,284 @@
+/*
+  ==============================================================================
+    Decoded copies of each sample, shared by every plugin instance, at the
+    file's own rate or converted once to a host's sample rate.
+  ==============================================================================
+*/
+
+#include "SampleRateCache.h"
+#include "SampleBank.h"
+
+namespace
+{
+    // Zero crossings on each side of the kernel, and the Kaiser window's
+    // shape: together about 100 dB of stopband rejection with a transition
+    // band of a tenth of the output's Nyquist frequency
+    constexpr int zeroCrossings = 64;
+    constexpr double kaiserBeta = 10.0;
+    constexpr double passband = 0.95;
+
+    // The kernel is tabulated this finely per zero crossing and read with
+    // linear interpolation, which keeps the table error below -120 dB
+    constexpr int tableResolution = 2048;
+
+    double besselI0 (double x) noexcept
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; term > sum * 1.0e-12; ++k)
+        {
+            auto factor = x / (2.0 * k);
+            term *= factor * factor;
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    // Windowed sinc sampled from 0 to zeroCrossings, in units of zero crossings
+    struct KernelTable
+    {
+        KernelTable()
+        {
+            auto windowScale = 1.0 / besselI0 (kaiserBeta);
+
+            for (int i = 0; i < size; ++i)
+            {
+                auto x = (double) i / tableResolution;
+                auto u = juce::jmin (1.0, x / zeroCrossings);
+                auto arg = juce::MathConstants<double>::pi * x;
+
+                values[i] = (float) ((x == 0.0 ? 1.0 : std::sin (arg) / arg)
+                                       * besselI0 (kaiserBeta * std::sqrt (1.0 - u * u)) * windowScale);
+            }
+        }
+
+        // One spare entry past the last zero crossing for the interpolation
+        static constexpr int size = zeroCrossings * tableResolution + 2;
+        float values[size];
+    };
+
+    // Built once when the plugin is loaded
+    const KernelTable kernelTable;
+}
+
+//==============================================================================
+SampleRateCache::FileVersion SampleRateCache::FileVersion::of (const juce::File& file)
+{
+    return { file.getLastModificationTime().toMilliseconds(), file.getSize() };
+}
+
+//==============================================================================
+MySamplerSound::Ptr SampleRateCache::findSound (const juce::File& file, const FileVersion& version,
+                                                double sampleRate, bool compact)
+{
+    const juce::ScopedLock sl (lock);
+
+    auto index = indexOf (file, version, sampleRate, compact);
+
+    if (index < 0)
+        return {};
+
+    auto& entry = entries.getReference (index);
+    entry.lastUsed = ++useCounter;
+    return entry.sound;
+}
+
+MySamplerSound::Ptr SampleRateCache::addDecodedSound (const juce::File& file, const FileVersion& version,
+                                                      MySamplerSound* sound)
+{
+    return keep (file, version, sound);
+}
+
+MySamplerSound::Ptr SampleRateCache::addSound (const juce::File& file, const FileVersion& version,
+                                               const MySamplerSound& sound, double sampleRate)
+{
+    if (auto existing = findSound (file, version, sampleRate, sound.isCompact()))
+        return existing;
+
+    // A compact sound is widened to float for converting, and the copy is
+    // made compact again
+    juce::AudioBuffer<float> decoded;
+    auto* source = sound.getAudioData();
+
+    if (source == nullptr)
+    {
+        decoded.setSize (sound.getNumResidentChannels(), sound.getNumResidentSamples());
+
+        for (int ch = 0; ch < decoded.getNumChannels(); ++ch)
+            sound.readResidentFrames (ch, 0, decoded.getNumSamples(), decoded.getWritePointer (ch));
+
+        source = &decoded;
+    }
+
+    // The lock isn't held while converting, so another instance's loader
+    // may finish the same copy first; keep() then hands back theirs
+    MySamplerSound::Ptr converted (new MySamplerSound (sound,
+                                                       convert (*source, sound.getSourceSampleRate(), sampleRate),
+                                                       sampleRate));
+
+    return keep (file, version, converted.get());
+}
+
+MySamplerSound::Ptr SampleRateCache::keep (const juce::File& file, const FileVersion& version, MySamplerSound* sound)
+{
+    auto sampleRate = sound->getSourceSampleRate();
+    auto size = sound->getResidentSizeInBytes();
+
+    const juce::ScopedLock sl (lock);
+
+    auto index = indexOf (file, version, sampleRate, sound->isCompact());
+
+    if (index >= 0)
+    {
+        auto& entry = entries.getReference (index);
+        entry.lastUsed = ++useCounter;
+        return entry.sound;
+    }
+
+    removeOtherVersions (file, version);
+
+    if (! makeRoomFor (size))
+        return {};
+
+    entries.add ({ file, version, sampleRate, size, ++useCounter, sound });
+    bytesUsed += size;
+    return sound;
+}
+
+//==============================================================================
+juce::AudioBuffer<float> SampleRateCache::convert (const juce::AudioBuffer<float>& source,
+                                                   double sourceSampleRate, double targetSampleRate)
+{
+    auto& table = kernelTable.values;
+    auto numChannels = source.getNumChannels();
+    auto numSourceFrames = source.getNumSamples();
+
+    // Source frames per output frame. Going down in rate, the cutoff follows
+    // the new Nyquist frequency and the kernel widens to match.
+    auto ratio = sourceSampleRate / targetSampleRate;
+    auto cutoff = passband * juce::jmin (1.0, 1.0 / ratio);
+    auto halfWidth = zeroCrossings / cutoff;
+
+    auto numFrames = (int) std::ceil (numSourceFrames / ratio);
+
+    // Voices read a few frames past the end, as they do with decoded data
+    juce::AudioBuffer<float> result (numChannels, numFrames + SampleBank::guardSamples);
+    result.clear();
+
+    std::vector<double> weights ((size_t) (2.0 * halfWidth) + 2);
+
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        auto centre = frame * ratio;
+        auto first = juce::jmax (0, (int) std::ceil (centre - halfWidth));
+        auto last = juce::jmin (numSourceFrames - 1, (int) std::floor (centre + halfWidth));
+        auto numTaps = last - first + 1;
+
+        if (numTaps <= 0)
+            continue;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            auto position = std::abs (first + tap - centre) * cutoff * tableResolution;
+            auto index = (int) position;
+            auto fraction = position - index;
+
+            weights[(size_t) tap] = index + 1 < KernelTable::size
+                                      ? cutoff * (table[index] + fraction * (table[index + 1] - table[index]))
+                                      : 0.0;
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* input = source.getReadPointer (channel, first);
+            double sum = 0.0;
+
+            for (int tap = 0; tap < numTaps; ++tap)
+                sum += weights[(size_t) tap] * input[tap];
+
+            result.setSample (channel, frame, (float) sum);
+        }
+    }
+
+    return result;
+}
+
+void SampleRateCache::releaseUnusedSounds()
+{
+    const juce::ScopedLock sl (lock);
+
+    // Every other holder takes its reference under this lock in findSound()
+    // or keep(), so a count of one can't go up while we look at it
+    for (int i = entries.size(); --i >= 0;)
+    {
+        auto& entry = entries.getReference (i);
+
+        if (entry.sound->getReferenceCount() == 1)
+        {
+            bytesUsed -= entry.size;
+            entries.remove (i);
+        }
+    }
+}
+
+//==============================================================================
+bool SampleRateCache::makeRoomFor (size_t size)
+{
+    while (bytesUsed + size > memoryBudgetBytes)
+    {
+        int oldest = -1;
+
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            auto& entry = entries.getReference (i);
+
+            // Anything with more than the cache's own reference is being
+            // played or is about to be
+            if (entry.sound->getReferenceCount() > 1)
+                continue;
+
+            if (oldest < 0 || entry.lastUsed < entries.getReference (oldest).lastUsed)
+                oldest = i;
+        }
+
+        if (oldest < 0)
+            return false;
+
+        bytesUsed -= entries.getReference (oldest).size;
+        entries.remove (oldest);
+    }
+
+    return true;
+}
+
+void SampleRateCache::removeOtherVersions (const juce::File& file, const FileVersion& version)
+{
+    // Copies of an older version are never handed out again, so they go as
+    // soon as nothing is playing them
+    for (int i = entries.size(); --i >= 0;)
+    {
+        auto& entry = entries.getReference (i);
+
+        if (entry.file == file && ! (entry.version == version) && entry.sound->getReferenceCount() == 1)
+        {
+            bytesUsed -= entry.size;
+            entries.remove (i);
+        }
+    }
+}
+
+int SampleRateCache::indexOf (const juce::File& file, const FileVersion& version,
+                              double sampleRate, bool compact) const
+{
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        auto& entry = entries.getReference (i);
+
+        if (entry.file == file && entry.version == version
+             && entry.sampleRate == sampleRate && entry.sound->isCompact() == compact)
+            return i;
+    }
+
+    return -1;
+}
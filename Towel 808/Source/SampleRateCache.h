@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+    Decoded copies of each sample, shared by every plugin instance, at the
+    file's own rate or converted once to a host's sample rate.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MySampler.h"
+
+//==============================================================================
+/**
+    Holds resident sounds keyed by file, version of the file and rate. Plain
+    decodes are kept at the file's rate so every instance that selects the
+    file shares one buffer instead of decoding its own. Copies converted to a
+    host sample rate let a voice playing its root note read the data frame
+    for frame instead of resampling it on every note.
+
+    Conversion is done offline with a long Kaiser-windowed sinc, far cleaner
+    than anything a voice could afford per sample.
+
+    A copy stays only as long as some instance uses it: once the cache holds
+    the last reference, the next releaseUnusedSounds() pass frees it. The
+    memory budget caps what can be shared at once; a sound that doesn't fit
+    stays private to the loader that made it.
+
+    There is one cache per process, held through a SharedResourcePointer by
+    every loader, and guarded by its own lock. A sound is never changed once
+    it is in the cache, so any number of audio threads can play it without
+    locking. The cache keeps a reference to everything in it, which means the
+    last release of a sound always happens here, on a loader thread.
+*/
+class SampleRateCache
+{
+public:
+    SampleRateCache() = default;
+
+    static constexpr size_t memoryBudgetBytes = 128 * 1024 * 1024;
+
+    // Tells apart the contents a file had at different times, so a sample
+    // that is edited on disk isn't served from an old copy
+    struct FileVersion
+    {
+        juce::int64 modificationTime = 0, size = 0;
+
+        static FileVersion of (const juce::File& file);
+
+        bool operator== (const FileVersion& other) const noexcept
+        {
+            return modificationTime == other.modificationTime && size == other.size;
+        }
+    };
+
+    // Returns the copy of this version of the file at this rate, stored
+    // compactly or not, and marks it as recently used. Returns nullptr if
+    // there isn't one yet.
+    MySamplerSound::Ptr findSound (const juce::File& file, const FileVersion& version,
+                                   double sampleRate, bool compact);
+
+    // Keeps a sound decoded at the file's own rate for other instances to
+    // share. Returns the copy already there if another instance got in
+    // first, the sound itself, or nullptr if it can't fit.
+    MySamplerSound::Ptr addDecodedSound (const juce::File& file, const FileVersion& version,
+                                         MySamplerSound* sound);
+
+    // Converts a resident sound to the given rate and keeps the result, in
+    // the sound's own storage format.
+    // Returns nullptr if it can't fit. Slow; only call this on a loader thread.
+    MySamplerSound::Ptr addSound (const juce::File& file, const FileVersion& version,
+                                  const MySamplerSound& sound, double sampleRate);
+
+    // Frees every copy that no instance is using any more. Called by each
+    // loader on its own thread, alongside releasing its own unused sounds.
+    void releaseUnusedSounds();
+
+    // Band-limited conversion of a whole buffer from one rate to another
+    static juce::AudioBuffer<float> convert (const juce::AudioBuffer<float>& source,
+                                             double sourceSampleRate, double targetSampleRate);
+
+private:
+    struct Entry
+    {
+        juce::File file;
+        FileVersion version;
+        double sampleRate;
+        size_t size;
+        juce::uint32 lastUsed;
+        MySamplerSound::Ptr sound;
+    };
+
+    MySamplerSound::Ptr keep (const juce::File& file, const FileVersion& version, MySamplerSound* sound);
+    bool makeRoomFor (size_t size);
+    void removeOtherVersions (const juce::File& file, const FileVersion& version);
+    int indexOf (const juce::File& file, const FileVersion& version, double sampleRate, bool compact) const;
+
+    juce::CriticalSection lock;
+    juce::Array<Entry> entries;
+    size_t bytesUsed = 0;
+    juce::uint32 useCounter = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleRateCache)
+};
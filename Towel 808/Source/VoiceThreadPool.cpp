@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+    Pre-spawned worker threads that share one block's voices with the caller.
+  ==============================================================================
+*/
+
+#include "VoiceThreadPool.h"
+#include "RealtimeSafety.h"
+#include "AudioThreadEvent.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#endif
+
+namespace
+{
+    // How many times the caller checks on items still running on workers
+    // before it starts giving its time slice away
+    constexpr int maxSpins = 2000;
+
+    // Tells the core this is a spin-wait, which saves power and lets a
+    // hyperthreaded sibling run
+    inline void pauseWhileSpinning() noexcept
+    {
+       #if JUCE_USE_SSE_INTRINSICS
+        _mm_pause();
+       #elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+}
+
+//==============================================================================
+class VoiceThreadPool::Worker  : public juce::Thread
+{
+public:
+    explicit Worker (VoiceThreadPool& poolToServe)
+        : juce::Thread ("Towel 808 Voice Worker"),
+          pool (poolToServe)
+    {
+        startThread (8);
+    }
+
+    ~Worker() override
+    {
+        // The worker sleeps on its own event, so stopThread() can't wake it
+        signalThreadShouldExit();
+        wake();
+        stopThread (4000);
+    }
+
+    // Called on the audio thread, so this mustn't lock as notify() does
+    void wake() noexcept    { wakeUp.signal(); }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            // Asleep until the next job, however long that takes
+            wakeUp.wait (-1);
+
+            if (threadShouldExit())
+                break;
+
+            // A wake-up left over from a job that has already been finished
+            // finds nothing to claim and goes straight back to sleep
+            RealtimeSafety::ScopedAudioThread realtimeThread;
+            pool.workOn ((juce::uint32) (pool.claim.load (std::memory_order_acquire) >> 32));
+        }
+    }
+
+private:
+    VoiceThreadPool& pool;
+    AudioThreadEvent wakeUp;
+};
+
+//==============================================================================
+VoiceThreadPool::VoiceThreadPool()
+{
+    auto numWorkers = juce::jlimit (1, maxWorkers, juce::SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add (new Worker (*this));
+}
+
+VoiceThreadPool::~VoiceThreadPool()
+{
+    workers.clear();
+}
+
+bool VoiceThreadPool::tryRun (Task newTask, void* newContext, int newNumItems) noexcept
+{
+    if (newNumItems <= 0)
+        return true;
+
+    if (inUse.exchange (true, std::memory_order_acquire))
+        return false;
+
+    // The previous job has fully finished, so nothing reads these until the
+    // new serial below is published
+    task.store (newTask, std::memory_order_relaxed);
+    context.store (newContext, std::memory_order_relaxed);
+    numItems.store (newNumItems, std::memory_order_relaxed);
+    numDone.store (0, std::memory_order_relaxed);
+
+    ++serial;
+    claim.store ((juce::uint64) serial << 32, std::memory_order_release);
+
+    // One worker fewer than items: the caller takes the first one itself
+    for (int i = 0; i < juce::jmin (workers.size(), newNumItems - 1); ++i)
+        workers.getUnchecked (i)->wake();
+
+    workOn (serial);
+
+    // Whatever is left is already running on a worker that is awake and
+    // busy with it, so the wait is short: spin on it for a while, then let
+    // other threads have the core
+    for (int spins = 0; numDone.load (std::memory_order_acquire) < newNumItems; ++spins)
+    {
+        if (spins < maxSpins)
+            pauseWhileSpinning();
+        else
+            juce::Thread::yield();
+    }
+
+    inUse.store (false, std::memory_order_release);
+    return true;
+}
+
+void VoiceThreadPool::workOn (juce::uint32 jobSerial) noexcept
+{
+    int index;
+
+    while (claimItem (jobSerial, index))
+    {
+        task.load (std::memory_order_relaxed) (context.load (std::memory_order_relaxed), index);
+        numDone.fetch_add (1, std::memory_order_release);
+    }
+}
+
+bool VoiceThreadPool::claimItem (juce::uint32 jobSerial, int& index) noexcept
+{
+    auto current = claim.load (std::memory_order_acquire);
+
+    for (;;)
+    {
+        if ((juce::uint32) (current >> 32) != jobSerial)
+            return false;
+
+        auto next = (int) (current & 0xffffffff);
+
+        // numItems may already belong to a newer job, but then the exchange
+        // below fails on the serial, so a wrong answer here is harmless
+        if (next >= numItems.load (std::memory_order_relaxed))
+            return false;
+
+        if (claim.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel))
+        {
+            index = next;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+    Pre-spawned worker threads that share one block's voices with the caller.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A fixed set of worker threads that help the audio thread through a list
+    of independent items, such as the voices of one block.
+
+    The caller publishes a job by storing a new serial in a single atomic,
+    wakes the workers, then claims items alongside them until none are left
+    and waits for the ones still in flight. Claiming is a compare-and-swap on
+    that atomic (job serial in the top half, next item in the bottom), so a
+    worker that wakes up late can never take an item from a newer job.
+
+    Between jobs the workers sleep on an AudioThreadEvent, so an idle pool
+    costs no CPU at all. Waking them is the caller's only system call, a
+    semaphore post that never locks or allocates, and if no worker turns up
+    in time the caller simply does every item itself.
+
+    There is one pool per process, held through a SharedResourcePointer by
+    every synthesiser that has voice threading switched on. One job runs at a
+    time: a caller that finds the pool busy with another instance's block
+    renders its own block serially instead of waiting.
+*/
+class VoiceThreadPool
+{
+public:
+    using Task = void (*) (void* context, int index);
+
+    // One worker per spare core, up to maxWorkers
+    VoiceThreadPool();
+    ~VoiceThreadPool();
+
+    static constexpr int maxWorkers = 3;
+
+    int getNumWorkers() const noexcept      { return workers.size(); }
+
+    // Runs task (context, i) once for every i in [0, numItems), on the
+    // workers and the calling thread, and returns true when all have
+    // finished. Returns false without running anything if another thread
+    // is using the pool.
+    bool tryRun (Task task, void* context, int numItems) noexcept;
+
+private:
+    class Worker;
+
+    void workOn (juce::uint32 serial) noexcept;
+    bool claimItem (juce::uint32 serial, int& index) noexcept;
+
+    juce::OwnedArray<Worker> workers;
+
+    std::atomic<bool> inUse { false };
+    std::atomic<juce::uint64> claim { 0 };
+    std::atomic<int> numDone { 0 };
+    std::atomic<int> numItems { 0 };
+    std::atomic<Task> task { nullptr };
+    std::atomic<void*> context { nullptr };
+
+    // Only touched by the thread that holds inUse
+    juce::uint32 serial = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VoiceThreadPool)
+};
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+    Command-line entry point for the Towel 808 unit tests.
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+namespace
+{
+    const char* const options =
+        "  --seed <n>              Seed for the tests' random data (default: a new one each run)\n";
+
+    void runTests (const juce::ArgumentList& args)
+    {
+        auto seed = args.containsOption ("--seed") ? args.getValueForOption ("--seed").getLargeIntValue()
+                                                   : juce::Random::getSystemRandom().nextInt64();
+
+        // Only the plugin's own tests; JUCE's are compiled in as well
+        juce::UnitTestRunner runner;
+        runner.setAssertOnFailure (false);
+        runner.runTestsInCategory ("Towel 808", seed);
+
+        int numFailures = 0;
+
+        for (int i = 0; i < runner.getNumResults(); ++i)
+            numFailures += runner.getResult (i)->failures;
+
+        if (numFailures > 0)
+            juce::ConsoleApplication::fail (juce::String (numFailures) + " test(s) failed with --seed "
+                                            + juce::String (seed));
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The loader and library start threads that expect JUCE to be initialised
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand ("--help|-h", "Towel 808 unit tests", false);
+
+    app.addDefaultCommand ({ "run",
+                             "[options]",
+                             "Runs every Towel 808 unit test and fails if any of them do",
+                             options,
+                             runTests });
+
+    return app.findAndRunCommand (argc, argv);
+}